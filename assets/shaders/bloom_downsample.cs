@@ -0,0 +1,84 @@
+#version 460 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D input_map;
+uniform int input_level;
+uniform bool first_level; // reads the bright target, and weighs down single bright texels so they don't flicker
+
+layout (r11f_g11f_b10f, binding = 0) uniform writeonly image2D output_map;
+
+// every output texel reads the input texels from 2 before to 3 after its own two
+// so the group's 8x8 outputs share one 20x20 block of input, loaded once
+#define TILE_SIZE 8
+#define BORDER 2
+#define INPUT_TILE_SIZE (TILE_SIZE * 2 + BORDER * 2)
+
+shared vec3 input_tile[INPUT_TILE_SIZE][INPUT_TILE_SIZE];
+
+// the average of the 2x2 input texels starting at the offset from the output texel's first, what a bilinear tap between them would read
+vec3 box(ivec2 local_texel, ivec2 offset)
+{
+    ivec2 p = local_texel * 2 + BORDER + offset;
+    return (input_tile[p.y][p.x] + input_tile[p.y][p.x + 1] + input_tile[p.y + 1][p.x] + input_tile[p.y + 1][p.x + 1]) * 0.25;
+}
+
+float karis_weight(vec3 color)
+{
+    return 1.0 / (1.0 + dot(color, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+void main()
+{
+    // load the block, clamped to the edge of the input
+    ivec2 input_size = textureSize(input_map, input_level);
+    ivec2 input_origin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE * 2 - BORDER;
+    for (uint i = gl_LocalInvocationIndex; i < INPUT_TILE_SIZE * INPUT_TILE_SIZE; i += TILE_SIZE * TILE_SIZE)
+    {
+        ivec2 p = ivec2(i % INPUT_TILE_SIZE, i / INPUT_TILE_SIZE);
+        ivec2 texel = clamp(input_origin + p, ivec2(0), input_size - 1);
+        input_tile[p.y][p.x] = texelFetch(input_map, texel, input_level).rgb;
+    }
+    barrier();
+
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, imageSize(output_map))))
+    {
+        return;
+    }
+
+    // 13 taps as five overlapping 4x4 boxes, the inner one weighted as much as the four corner ones together
+    ivec2 local_texel = ivec2(gl_LocalInvocationID.xy);
+    vec3 a = box(local_texel, ivec2(-2, -2));
+    vec3 b = box(local_texel, ivec2(0, -2));
+    vec3 c = box(local_texel, ivec2(2, -2));
+    vec3 d = box(local_texel, ivec2(-2, 0));
+    vec3 e = box(local_texel, ivec2(0, 0));
+    vec3 f = box(local_texel, ivec2(2, 0));
+    vec3 g = box(local_texel, ivec2(-2, 2));
+    vec3 h = box(local_texel, ivec2(0, 2));
+    vec3 i = box(local_texel, ivec2(2, 2));
+    vec3 j = box(local_texel, ivec2(-1, -1));
+    vec3 k = box(local_texel, ivec2(1, -1));
+    vec3 l = box(local_texel, ivec2(-1, 1));
+    vec3 m = box(local_texel, ivec2(1, 1));
+
+    vec3 groups[5] = vec3[](
+        (j + k + l + m) * 0.25,
+        (a + b + d + e) * 0.25,
+        (b + c + e + f) * 0.25,
+        (d + e + g + h) * 0.25,
+        (e + f + h + i) * 0.25);
+    float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+
+    vec3 color = vec3(0.0);
+    float weight_sum = 0.0;
+    for (int group = 0; group < 5; group++)
+    {
+        float weight = first_level ? weights[group] * karis_weight(groups[group]) : weights[group];
+        color += groups[group] * weight;
+        weight_sum += weight;
+    }
+
+    imageStore(output_map, texel, vec4(color / weight_sum, 1.0));
+}
@@ -0,0 +1,37 @@
+#version 460 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the smaller level, filtered
+uniform sampler2D input_map;
+uniform int input_level;
+
+// the level being upsampled onto, it keeps its own downsampled value and adds the one below it
+layout (r11f_g11f_b10f, binding = 0) uniform image2D output_map;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 output_size = imageSize(output_map);
+    if (any(greaterThanEqual(texel, output_size)))
+    {
+        return;
+    }
+
+    // 3x3 tent over the smaller level, a texel of it apart, every tap is bilinear
+    // neighbouring taps read the same few texels, so the texture cache serves them without shared memory
+    vec2 uv = (vec2(texel) + 0.5) / vec2(output_size);
+    vec2 offset = 1.0 / vec2(textureSize(input_map, input_level));
+    vec3 color = textureLod(input_map, uv, input_level).rgb * 4.0;
+    color += textureLod(input_map, uv + vec2(-offset.x, 0.0), input_level).rgb * 2.0;
+    color += textureLod(input_map, uv + vec2(offset.x, 0.0), input_level).rgb * 2.0;
+    color += textureLod(input_map, uv + vec2(0.0, -offset.y), input_level).rgb * 2.0;
+    color += textureLod(input_map, uv + vec2(0.0, offset.y), input_level).rgb * 2.0;
+    color += textureLod(input_map, uv + vec2(-offset.x, -offset.y), input_level).rgb;
+    color += textureLod(input_map, uv + vec2(offset.x, -offset.y), input_level).rgb;
+    color += textureLod(input_map, uv + vec2(-offset.x, offset.y), input_level).rgb;
+    color += textureLod(input_map, uv + vec2(offset.x, offset.y), input_level).rgb;
+    color /= 16.0;
+
+    imageStore(output_map, texel, vec4(imageLoad(output_map, texel).rgb + color, 1.0));
+}
@@ -0,0 +1,106 @@
+#version 460 core
+
+#include "glsl/clusters.glsl"
+#include "glsl/lights.glsl"
+#include "glsl/view.glsl"
+
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 16) writeonly buffer Clusters
+{
+    Cluster clusters[];
+};
+
+layout (std430, binding = 17) writeonly buffer ClusterLightIndices
+{
+    uint cluster_light_indices[];
+};
+
+uniform mat4 view_matrix;
+uniform mat4 inverse_projection;
+
+// view space position on the near plane under an ndc position
+vec3 unproject(vec2 ndc)
+{
+    vec4 position = inverse_projection * vec4(ndc, -1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+bool intersects(vec3 center, float radius, vec3 aabb_min, vec3 aabb_max)
+{
+    vec3 offset = center - clamp(center, aabb_min, aabb_max);
+    return dot(offset, offset) <= radius * radius;
+}
+
+void main()
+{
+    uint cluster_index = gl_GlobalInvocationID.x;
+    if (cluster_index >= NUM_CLUSTERS)
+    {
+        return;
+    }
+
+    uvec3 cluster = uvec3(
+        cluster_index % CLUSTER_GRID_X,
+        (cluster_index / CLUSTER_GRID_X) % CLUSTER_GRID_Y,
+        cluster_index / (CLUSTER_GRID_X * CLUSTER_GRID_Y));
+
+    // the tile's corners on the near plane, slid along their view rays to the slice's depths
+    vec2 tile_min = vec2(cluster.xy) / vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y) * 2.0 - 1.0;
+    vec2 tile_max = vec2(cluster.xy + 1) / vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y) * 2.0 - 1.0;
+    vec3 corners[4] = vec3[](
+        unproject(tile_min),
+        unproject(vec2(tile_max.x, tile_min.y)),
+        unproject(vec2(tile_min.x, tile_max.y)),
+        unproject(tile_max));
+    float slice_near = calc_slice_depth(cluster.z, view.near_plane, view.far_plane);
+    float slice_far = calc_slice_depth(cluster.z + 1, view.near_plane, view.far_plane);
+
+    vec3 aabb_min = vec3(1e30);
+    vec3 aabb_max = vec3(-1e30);
+    for (int i = 0; i < 4; i++)
+    {
+        vec3 slice_near_corner = corners[i] * (slice_near / -corners[i].z);
+        vec3 slice_far_corner = corners[i] * (slice_far / -corners[i].z);
+        aabb_min = min(aabb_min, min(slice_near_corner, slice_far_corner));
+        aabb_max = max(aabb_max, max(slice_near_corner, slice_far_corner));
+    }
+
+    // lights with shadows are still drawn one at a time with their shadow map
+    uint first = cluster_index * MAX_LIGHTS_PER_CLUSTER;
+    uint count = 0;
+    for (uint i = 0; i < num_point_lights && count < MAX_LIGHTS_PER_CLUSTER; i++)
+    {
+        if (point_lights[i].casts_shadows != 0)
+        {
+            continue;
+        }
+
+        vec3 center = (view_matrix * vec4(point_lights[i].position, 1.0)).xyz;
+        if (intersects(center, point_lights[i].radius, aabb_min, aabb_max))
+        {
+            cluster_light_indices[first + count] = i;
+            count++;
+        }
+    }
+    uint point_count = count;
+
+    // the cone fits in the sphere around its apex
+    for (uint i = 0; i < num_spot_lights && count < MAX_LIGHTS_PER_CLUSTER; i++)
+    {
+        if (spot_lights[i].casts_shadows != 0)
+        {
+            continue;
+        }
+
+        vec3 center = (view_matrix * vec4(spot_lights[i].position, 1.0)).xyz;
+        if (intersects(center, spot_lights[i].radius, aabb_min, aabb_max))
+        {
+            cluster_light_indices[first + count] = i;
+            count++;
+        }
+    }
+
+    clusters[cluster_index].point_count = point_count;
+    clusters[cluster_index].spot_count = count - point_count;
+}
@@ -1,14 +1,15 @@
 #version 460 core
 
-layout (location = 0) in vec3 position;
+#include "glsl/view.glsl"
 
-uniform mat4 mvp;
+layout (location = 0) in vec3 position;
 
 uniform mat4 model;
-uniform vec4 clipping_plane;
 
 void main()
 {
-    gl_Position = mvp * vec4(position, 1.0);
-	gl_ClipDistance[0] = dot(model * vec4(position, 1.0), clipping_plane);
+    vec4 world_position = model * vec4(position, 1.0);
+
+    gl_Position = view.view_projection * world_position;
+	gl_ClipDistance[0] = dot(world_position, view.clipping_plane);
 }
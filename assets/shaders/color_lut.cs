@@ -0,0 +1,29 @@
+#version 460 core
+
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+// bakes the color grading into a lut, indexed and filled with gamma corrected colors
+layout (rgba8, binding = 0) uniform writeonly image3D lut;
+
+uniform float contrast;
+uniform float saturation;
+uniform vec3 color_filter;
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 lut_size = imageSize(lut);
+    if (any(greaterThanEqual(texel, lut_size)))
+    {
+        return;
+    }
+
+    vec3 color = vec3(texel) / vec3(lut_size - 1);
+
+    color *= color_filter;
+    color = (color - 0.5) * contrast + 0.5;
+    float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    color = mix(vec3(luminance), color, saturation);
+
+    imageStore(lut, texel, vec4(clamp(color, 0.0, 1.0), 1.0));
+}
@@ -0,0 +1,44 @@
+#version 460 core
+
+#include "glsl/cull_commands.glsl"
+#include "glsl/draws.glsl"
+
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 6) readonly buffer Commands
+{
+    DrawCommand commands[];
+};
+
+layout (std430, binding = 9) writeonly buffer CulledCommands
+{
+    DrawCommand culled_commands[];
+};
+
+layout (std430, binding = 10) writeonly buffer CulledDraws
+{
+    Draw culled_draws[];
+};
+
+// how many commands each batch kept, read by glMultiDrawElementsIndirectCount
+layout (std430, binding = 11) buffer DrawCounts
+{
+    uint draw_counts[];
+};
+
+uniform uint command_count;
+
+void main()
+{
+    uint command = gl_GlobalInvocationID.x;
+    if (command >= command_count || commands[command].instance_count == 0)
+    {
+        return;
+    }
+
+    // commands keep their batch, but not their order within it
+    CullCommand cull_command = cull_commands[command];
+    uint index = cull_command.batch_first_command + atomicAdd(draw_counts[cull_command.batch], 1);
+    culled_commands[index] = commands[command];
+    culled_draws[index] = draws[command];
+}
@@ -0,0 +1,151 @@
+#version 460 core
+
+#include "glsl/cull_commands.glsl"
+
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 0) readonly buffer InstanceModels
+{
+    mat4 instance_models[];
+};
+
+// every instance a command could draw, in the ranges its base_instance points at
+layout (std430, binding = 3) readonly buffer CandidateInstances
+{
+    uint candidate_instances[];
+};
+
+// the command each candidate belongs to
+layout (std430, binding = 4) readonly buffer CandidateCommands
+{
+    uint candidate_commands[];
+};
+
+layout (std430, binding = 6) buffer Commands
+{
+    DrawCommand commands[];
+};
+
+layout (std430, binding = 7) writeonly buffer VisibleInstances
+{
+    uint visible_instances[];
+};
+
+// candidates the first occlusion phase hid, for the second phase to retest
+layout (std430, binding = 12) buffer OccludedCandidates
+{
+    uint occluded_candidates[];
+};
+
+uniform uint candidate_count;
+uniform vec4 frustum_planes[6];
+
+// see liminal::gpu_cull
+uniform uint occlusion_phase;
+uniform mat4 occlusion_view_projection;
+uniform sampler2D hi_z_map;
+
+bool intersects_frustum(vec3 center, vec3 extents)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        float distance = dot(frustum_planes[i].xyz, center) + frustum_planes[i].w;
+        float radius = dot(abs(frustum_planes[i].xyz), extents);
+        if (distance + radius < 0.0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_occluded(vec3 center, vec3 extents)
+{
+    // screen rectangle and closest depth of the box
+    vec2 uv_min = vec2(1.0);
+    vec2 uv_max = vec2(0.0);
+    float depth = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = center + extents * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip_position = occlusion_view_projection * vec4(corner, 1.0);
+
+        // boxes reaching behind the camera can't be projected
+        if (clip_position.w <= 0.0)
+        {
+            return false;
+        }
+
+        vec3 ndc = clip_position.xyz / clip_position.w;
+        uv_min = min(uv_min, ndc.xy * 0.5 + 0.5);
+        uv_max = max(uv_max, ndc.xy * 0.5 + 0.5);
+        depth = min(depth, ndc.z * 0.5 + 0.5);
+    }
+
+    // pick the level where the rectangle spans at most two texels each way, so four reads cover it
+    ivec2 size = textureSize(hi_z_map, 0);
+    ivec2 texel_min = clamp(ivec2(clamp(uv_min, 0.0, 1.0) * vec2(size)), ivec2(0), size - 1);
+    ivec2 texel_max = clamp(ivec2(clamp(uv_max, 0.0, 1.0) * vec2(size)), ivec2(0), size - 1);
+    ivec2 span = texel_max - texel_min + 1;
+    int level = min(int(ceil(log2(float(max(span.x, span.y))))), textureQueryLevels(hi_z_map) - 1);
+
+    // texels at each level cover two of the level below, the last one also any odd leftover
+    ivec2 level_size = textureSize(hi_z_map, level);
+    texel_min = min(texel_min >> level, level_size - 1);
+    texel_max = min(texel_max >> level, level_size - 1);
+    float occluder_depth = max(
+        max(texelFetch(hi_z_map, texel_min, level).r, texelFetch(hi_z_map, ivec2(texel_max.x, texel_min.y), level).r),
+        max(texelFetch(hi_z_map, ivec2(texel_min.x, texel_max.y), level).r, texelFetch(hi_z_map, texel_max, level).r));
+
+    return depth > occluder_depth;
+}
+
+void main()
+{
+    uint candidate = gl_GlobalInvocationID.x;
+    if (candidate >= candidate_count)
+    {
+        return;
+    }
+
+    if (occlusion_phase == 1)
+    {
+        occluded_candidates[candidate] = 0;
+    }
+    else if (occlusion_phase == 2 && occluded_candidates[candidate] == 0)
+    {
+        return;
+    }
+
+    uint command = candidate_commands[candidate];
+    if (command == NO_CULL_COMMAND)
+    {
+        return;
+    }
+    uint instance = candidate_instances[candidate];
+
+    // transform the mesh's box into world space, same as liminal::aabb::transform
+    mat4 model = instance_models[instance];
+    vec3 local_center = (cull_commands[command].aabb_min.xyz + cull_commands[command].aabb_max.xyz) * 0.5;
+    vec3 local_extents = (cull_commands[command].aabb_max.xyz - cull_commands[command].aabb_min.xyz) * 0.5;
+    vec3 center = (model * vec4(local_center, 1.0)).xyz;
+    vec3 extents = mat3(abs(model[0].xyz), abs(model[1].xyz), abs(model[2].xyz)) * local_extents;
+
+    if (!intersects_frustum(center, extents))
+    {
+        return;
+    }
+
+    if (occlusion_phase != 0 && is_occluded(center, extents))
+    {
+        if (occlusion_phase == 1)
+        {
+            occluded_candidates[candidate] = 1;
+        }
+        return;
+    }
+
+    // survivors are packed at the start of the command's own range
+    uint index = atomicAdd(commands[command].instance_count, 1);
+    visible_instances[commands[command].base_instance + index] = instance;
+}
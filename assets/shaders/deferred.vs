@@ -1,5 +1,7 @@
 #version 460 core
 
+#include "glsl/view.glsl"
+
 layout (location = 0) in vec2 position;
 layout (location = 1) in vec2 uv;
 
@@ -10,7 +12,7 @@ out struct Vertex
 
 void main()
 {    
-    vertex.uv = uv;
+    vertex.uv = uv * view.gbuffer_scale;
 
     gl_Position = vec4(position, 0.0, 1.0);
 }
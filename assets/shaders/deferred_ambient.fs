@@ -1,6 +1,8 @@
 #version 460 core
 
 #include "glsl/fresnel_schlick.glsl"
+#include "glsl/gbuffer.glsl"
+#include "glsl/view.glsl"
 
 in struct Vertex
 {
@@ -10,21 +12,6 @@ in struct Vertex
 layout (location = 0) out vec4 frag_color;
 layout (location = 1) out vec4 bright_color;
 
-uniform struct Camera
-{
-    mat4 projection;
-    mat4 view;
-    vec3 position;
-} camera;
-
-uniform struct Geometry
-{
-    sampler2D position_map;
-    sampler2D normal_map;
-    sampler2D albedo_map;
-    sampler2D material_map;
-} geometry;
-
 uniform struct Skybox
 {
     samplerCube irradiance_cubemap;
@@ -35,8 +22,8 @@ uniform sampler2D brdf_map;
 
 void main()
 {
-    vec3 position = texture(geometry.position_map, vertex.uv).rgb;
-    vec3 normal = texture(geometry.normal_map, vertex.uv).rgb;
+    vec3 position = read_position(vertex.uv);
+    vec3 normal = read_normal(vertex.uv);
     vec3 albedo = texture(geometry.albedo_map, vertex.uv).rgb;
     float metallic = texture(geometry.material_map, vertex.uv).r;
     float roughness = texture(geometry.material_map, vertex.uv).g;
@@ -44,7 +31,7 @@ void main()
     float height = texture(geometry.material_map, vertex.uv).a;
 
     vec3 n = normalize(normal);
-    vec3 v = normalize(camera.position - position);
+    vec3 v = normalize(view.position - position);
     vec3 r = reflect(-v, n);
 
     vec3 f0 = vec3(0.04);
@@ -0,0 +1,119 @@
+#version 460 core
+
+#include "glsl/clusters.glsl"
+#include "glsl/distribution_ggx.glsl"
+#include "glsl/fresnel_schlick.glsl"
+#include "glsl/gbuffer.glsl"
+#include "glsl/geometry_smith.glsl"
+#include "glsl/math.glsl"
+#include "glsl/lights.glsl"
+#include "glsl/view.glsl"
+
+in struct Vertex
+{
+    vec2 uv;
+} vertex;
+
+layout (location = 0) out vec4 frag_color;
+layout (location = 1) out vec4 bright_color;
+
+layout (std430, binding = 16) readonly buffer Clusters
+{
+    Cluster clusters[];
+};
+
+layout (std430, binding = 17) readonly buffer ClusterLightIndices
+{
+    uint cluster_light_indices[];
+};
+
+// the camera the clusters were built for
+uniform mat4 view_matrix;
+uniform vec2 screen_size;
+
+vec3 calc_light(vec3 n, vec3 v, vec3 l, vec3 radiance, vec3 albedo, float metallic, float roughness, float ao)
+{
+    vec3 f0 = vec3(0.04);
+    f0 = mix(f0, albedo, metallic);
+
+    vec3 h = normalize(v + l);
+
+    float ndf = distribution_ggx(n, h, roughness);
+    float g = geometry_smith(n, v, l, roughness);
+    vec3 f = fresnel_schlick(clamp(dot(h, v), 0.0, 1.0), f0);
+
+    vec3 numerator = ndf * g * f;
+    float denominator = 4 * max(dot(n, v), 0.0) * max(dot(n, l), 0.0);
+    vec3 specular = numerator / max(denominator, 0.001);
+
+    vec3 ks = f;
+    vec3 kd = vec3(1.0) - ks;
+    kd *= 1.0 - metallic;
+    float n_dot_l = max(dot(n, l), 0.0);
+    return (kd * albedo / PI + specular) * radiance * n_dot_l * ao;
+}
+
+void main()
+{
+    vec3 position = read_position(vertex.uv);
+    vec3 normal = read_normal(vertex.uv);
+    vec3 albedo = texture(geometry.albedo_map, vertex.uv).rgb;
+    float metallic = texture(geometry.material_map, vertex.uv).r;
+    float roughness = texture(geometry.material_map, vertex.uv).g;
+    float ao = texture(geometry.material_map, vertex.uv).b;
+
+    vec3 n = normalize(normal);
+    vec3 v = normalize(view.position - position);
+
+    float view_depth = -(view_matrix * vec4(position, 1.0)).z;
+    uint cluster_index = find_cluster(gl_FragCoord.xy, screen_size, view_depth, view.near_plane, view.far_plane);
+    Cluster cluster = clusters[cluster_index];
+    uint first = cluster_index * MAX_LIGHTS_PER_CLUSTER;
+
+    // clusters are conservative, lights past their radius add nothing anyway
+    vec3 color = vec3(0.0);
+    for (uint i = 0; i < cluster.point_count; i++)
+    {
+        uint light_index = cluster_light_indices[first + i];
+        vec3 light_position = point_lights[light_index].position;
+        float distance = length(light_position - position);
+        if (distance > point_lights[light_index].radius)
+        {
+            continue;
+        }
+
+        vec3 l = (light_position - position) / distance;
+        vec3 radiance = point_lights[light_index].color * calc_attenuation(distance, point_lights[light_index].radius);
+        color += calc_light(n, v, l, radiance, albedo, metallic, roughness, ao);
+    }
+
+    for (uint i = cluster.point_count; i < cluster.point_count + cluster.spot_count; i++)
+    {
+        uint light_index = cluster_light_indices[first + i];
+        vec3 light_position = spot_lights[light_index].position;
+        float distance = length(light_position - position);
+        if (distance > spot_lights[light_index].radius)
+        {
+            continue;
+        }
+
+        vec3 l = (light_position - position) / distance;
+        float theta = dot(l, normalize(-spot_lights[light_index].direction));
+        float epsilon = spot_lights[light_index].inner_cutoff - spot_lights[light_index].outer_cutoff;
+        float intensity = clamp((theta - spot_lights[light_index].outer_cutoff) / epsilon, 0.0, 1.0);
+        vec3 radiance = spot_lights[light_index].color * intensity * calc_attenuation(distance, spot_lights[light_index].radius);
+        color += calc_light(n, v, l, radiance, albedo, metallic, roughness, ao);
+    }
+
+    frag_color = vec4(color, 1.0);
+
+    float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    if (brightness > 1.0)
+    {
+        bright_color = vec4(color, 1.0);
+    }
+    else
+    {
+        bright_color = vec4(0.0, 0.0, 0.0, 1.0);
+    }
+}
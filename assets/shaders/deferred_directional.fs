@@ -2,8 +2,11 @@
 
 #include "glsl/distribution_ggx.glsl"
 #include "glsl/fresnel_schlick.glsl"
+#include "glsl/gbuffer.glsl"
 #include "glsl/geometry_smith.glsl"
 #include "glsl/math.glsl"
+#include "glsl/lights.glsl"
+#include "glsl/view.glsl"
 
 in struct Vertex
 {
@@ -13,39 +16,26 @@ in struct Vertex
 layout (location = 0) out vec4 frag_color;
 layout (location = 1) out vec4 bright_color;
 
-uniform struct Camera
-{
-    vec3 position;
-} camera;
-
-uniform struct Geometry
-{
-    sampler2D position_map;
-    sampler2D normal_map;
-    sampler2D albedo_map;
-    sampler2D material_map;
-} geometry;
+// the light being drawn, in the lights block
+uniform uint light_index;
+uniform bool shadows = true; // off for passes that skip shadows, like water reflections
 
-uniform struct Light
-{
-    vec3 direction;
-    vec3 color;
-    sampler2D depth_map;
-    mat4 transformation_matrix;
-} light;
+uniform sampler2DArray light_depth_map;
 
 void main()
 {
-    vec3 position = texture(geometry.position_map, vertex.uv).rgb;
-    vec3 normal = texture(geometry.normal_map, vertex.uv).rgb;
+    vec3 position = read_position(vertex.uv);
+    vec3 normal = read_normal(vertex.uv);
     vec3 albedo = texture(geometry.albedo_map, vertex.uv).rgb;
     float metallic = texture(geometry.material_map, vertex.uv).r;
     float roughness = texture(geometry.material_map, vertex.uv).g;
     float ao = texture(geometry.material_map, vertex.uv).b;
     float height = texture(geometry.material_map, vertex.uv).a;
 
+    DirectionalLight light = directional_lights[light_index];
+
     vec3 n = normalize(normal);
-    vec3 v = normalize(camera.position - position);
+    vec3 v = normalize(view.position - position);
 
     vec3 f0 = vec3(0.04);
     f0 = mix(f0, albedo, metallic);
@@ -68,22 +58,36 @@ void main()
     float n_dot_l = max(dot(n, l), 0.0);
     vec3 color = (kd * albedo / PI + specular) * radiance * n_dot_l * ao;
    
-    vec4 light_space_position = light.transformation_matrix * vec4(position, 1.0);
-    vec3 light_space_proj_coords = (light_space_position.xyz / light_space_position.w) * 0.5 + 0.5;
-    float current_depth = light_space_proj_coords.z;
-    float bias = max(0.005 * (1.0 - dot(n, l)), 0.005);
+    // the first cascade that covers the position with room for the filter, the cascades are ordered nearest first
+    vec2 texel_size = 1.0 / textureSize(light_depth_map, 0).xy;
     float shadow = 0.0;
-    vec2 texel_size = 1.0 / textureSize(light.depth_map, 0);
-    for (int x = -1; x <= 1; x++)
+    if (shadows)
     {
-        for (int y = -1; y <= 1; y++)
+        for (int cascade = 0; cascade < NUM_CASCADES; cascade++)
         {
-            float pcf_depth = texture(light.depth_map, light_space_proj_coords.xy + vec2(x, y) * texel_size).r;
-            shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
+            vec4 light_space_position = light.transformation_matrices[cascade] * vec4(position, 1.0);
+            vec3 light_space_proj_coords = (light_space_position.xyz / light_space_position.w) * 0.5 + 0.5;
+            vec3 margin = vec3(texel_size * 2.0, 0.0);
+            if (any(lessThan(light_space_proj_coords, margin)) || any(greaterThan(light_space_proj_coords, 1.0 - margin)))
+            {
+                continue;
+            }
+
+            // every cascade has the same depth range in texels, so the same bias in texels suits all of them
+            float current_depth = light_space_proj_coords.z;
+            float bias = texel_size.x * mix(4.0, 1.0, n_dot_l);
+            for (int x = -1; x <= 1; x++)
+            {
+                for (int y = -1; y <= 1; y++)
+                {
+                    float pcf_depth = texture(light_depth_map, vec3(light_space_proj_coords.xy + vec2(x, y) * texel_size, cascade)).r;
+                    shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
+                }
+            }
+            shadow /= 9.0;
+            break;
         }
     }
-    shadow /= 9.0;
-    if (light_space_proj_coords.z > 1.0) shadow = 0.0;
     color = (1.0 - shadow) * color;
 
     frag_color = vec4(color, 1.0);
@@ -2,8 +2,11 @@
 
 #include "glsl/distribution_ggx.glsl"
 #include "glsl/fresnel_schlick.glsl"
+#include "glsl/gbuffer.glsl"
 #include "glsl/geometry_smith.glsl"
 #include "glsl/math.glsl"
+#include "glsl/lights.glsl"
+#include "glsl/view.glsl"
 
 in struct Vertex
 {
@@ -13,26 +16,11 @@ in struct Vertex
 layout (location = 0) out vec4 frag_color;
 layout (location = 1) out vec4 bright_color;
 
-uniform struct Camera
-{
-    vec3 position;
-} camera;
-
-uniform struct Geometry
-{
-    sampler2D position_map;
-    sampler2D normal_map;
-    sampler2D albedo_map;
-    sampler2D material_map;
-} geometry;
+// the light being drawn, in the lights block
+uniform uint light_index;
+uniform bool shadows = true; // off for passes that skip shadows, like water reflections
 
-uniform struct Light
-{
-    float far_plane;
-    vec3 position;
-    vec3 color;
-    samplerCube depth_cubemap;
-} light;
+uniform sampler2D shadow_atlas;
 
 const vec3 grid_sampling_disk[20] = vec3[]
 (
@@ -43,27 +31,56 @@ const vec3 grid_sampling_disk[20] = vec3[]
     vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
 );
 
+// the face a direction from the light falls on, in the order of the light's transformation matrices
+uint calc_cube_face(vec3 direction)
+{
+    vec3 magnitude = abs(direction);
+    if (magnitude.x >= magnitude.y && magnitude.x >= magnitude.z)
+    {
+        return direction.x >= 0.0 ? 0u : 1u;
+    }
+    if (magnitude.y >= magnitude.z)
+    {
+        return direction.y >= 0.0 ? 2u : 3u;
+    }
+    return direction.z >= 0.0 ? 4u : 5u;
+}
+
+// distance to the closest occluder in a direction from the light, as a fraction of the radius
+float sample_cube_shadow(vec3 direction, vec2 texel_size)
+{
+    uint face = calc_cube_face(direction);
+    vec4 light_space_position = point_lights[light_index].transformation_matrices[face] * vec4(point_lights[light_index].position + direction, 1.0);
+    vec2 uv = (light_space_position.xy / light_space_position.w) * 0.5 + 0.5;
+    return texture(shadow_atlas, calc_shadow_atlas_uv(point_lights[light_index].shadow_tiles[face], uv, texel_size)).r;
+}
+
 void main()
 {
-    vec3 position = texture(geometry.position_map, vertex.uv).rgb;
-    vec3 normal = texture(geometry.normal_map, vertex.uv).rgb;
+    vec3 position = read_position(vertex.uv);
+    vec3 normal = read_normal(vertex.uv);
     vec3 albedo = texture(geometry.albedo_map, vertex.uv).rgb;
     float metallic = texture(geometry.material_map, vertex.uv).r;
     float roughness = texture(geometry.material_map, vertex.uv).g;
     float ao = texture(geometry.material_map, vertex.uv).b;
     float height = texture(geometry.material_map, vertex.uv).a;
 
+    // the shadow matrices aren't needed here, so don't copy the whole light
+    vec3 light_position = point_lights[light_index].position;
+    vec3 light_color = point_lights[light_index].color;
+    float light_radius = point_lights[light_index].radius;
+
     vec3 n = normalize(normal);
-    vec3 v = normalize(camera.position - position);
+    vec3 v = normalize(view.position - position);
 
     vec3 f0 = vec3(0.04);
     f0 = mix(f0, albedo, metallic);
 
-    vec3 l = normalize(light.position - position);
+    vec3 l = normalize(light_position - position);
     vec3 h = normalize(v + l);
-    float distance = length(light.position - position);
-    float attenuation = 1.0 / (distance * distance);
-    vec3 radiance = light.color * attenuation;
+    float distance = length(light_position - position);
+    float attenuation = calc_attenuation(distance, light_radius);
+    vec3 radiance = light_color * attenuation;
 
     float ndf = distribution_ggx(n, h, roughness);
     float g = geometry_smith(n, v, l, roughness);
@@ -79,23 +96,27 @@ void main()
     float n_dot_l = max(dot(n, l), 0.0);
     vec3 color = (kd * albedo / PI + specular) * radiance * n_dot_l * ao;
     
-    vec3 frag_to_light = position - light.position;
+    vec3 frag_to_light = position - light_position;
     float current_depth = length(frag_to_light);
     float shadow = 0.0;
     float bias = 0.15;
     int samples = 20;
-    float view_distance = length(camera.position - position);
-    float disk_radius = (1.0 + (view_distance / light.far_plane)) / 25.0;
-    for (int i = 0; i < samples; i++)
+    vec2 texel_size = 1.0 / textureSize(shadow_atlas, 0);
+    float view_distance = length(view.position - position);
+    float disk_radius = (1.0 + (view_distance / light_radius)) / 25.0;
+    if (shadows)
     {
-        float closest_depth = texture(light.depth_cubemap, frag_to_light + grid_sampling_disk[i] * disk_radius).r;
-        closest_depth *= light.far_plane;
-        if (current_depth - bias > closest_depth)
+        for (int i = 0; i < samples; i++)
         {
-            shadow += 1.0;
+            float closest_depth = sample_cube_shadow(frag_to_light + grid_sampling_disk[i] * disk_radius, texel_size);
+            closest_depth *= light_radius;
+            if (current_depth - bias > closest_depth)
+            {
+                shadow += 1.0;
+            }
         }
+        shadow /= float(samples);
     }
-    shadow /= float(samples);
     color = (1.0 - shadow) * color;
 
     frag_color = vec4(color, 1.0);
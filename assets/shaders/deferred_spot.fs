@@ -2,8 +2,11 @@
 
 #include "glsl/distribution_ggx.glsl"
 #include "glsl/fresnel_schlick.glsl"
+#include "glsl/gbuffer.glsl"
 #include "glsl/geometry_smith.glsl"
 #include "glsl/math.glsl"
+#include "glsl/lights.glsl"
+#include "glsl/view.glsl"
 
 in struct Vertex
 {
@@ -13,42 +16,26 @@ in struct Vertex
 layout (location = 0) out vec4 frag_color;
 layout (location = 1) out vec4 bright_color;
 
-uniform struct Camera
-{
-    vec3 position;
-} camera;
+// the light being drawn, in the lights block
+uniform uint light_index;
+uniform bool shadows = true; // off for passes that skip shadows, like water reflections
 
-uniform struct Geometry
-{
-    sampler2D position_map;
-    sampler2D normal_map;
-    sampler2D albedo_map;
-    sampler2D material_map;
-} geometry;
-
-uniform struct Light
-{
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float inner_cutoff;
-    float outer_cutoff;
-    sampler2D depth_map;
-    mat4 transformation_matrix;
-} light;
+uniform sampler2D shadow_atlas;
 
 void main()
 {
-    vec3 position = texture(geometry.position_map, vertex.uv).rgb;
-    vec3 normal = texture(geometry.normal_map, vertex.uv).rgb;
+    vec3 position = read_position(vertex.uv);
+    vec3 normal = read_normal(vertex.uv);
     vec3 albedo = texture(geometry.albedo_map, vertex.uv).rgb;
     float metallic = texture(geometry.material_map, vertex.uv).r;
     float roughness = texture(geometry.material_map, vertex.uv).g;
     float ao = texture(geometry.material_map, vertex.uv).b;
     float height = texture(geometry.material_map, vertex.uv).a;
 
+    SpotLight light = spot_lights[light_index];
+
     vec3 n = normalize(normal);
-    vec3 v = normalize(camera.position - position);
+    vec3 v = normalize(view.position - position);
 
     vec3 f0 = vec3(0.04);
     f0 = mix(f0, albedo, metallic);
@@ -56,7 +43,7 @@ void main()
     vec3 l = normalize(light.position - position);
     vec3 h = normalize(v + l);
     float distance = length(light.position - position);
-    float attenuation = 1.0 / (distance * distance);
+    float attenuation = calc_attenuation(distance, light.radius);
     vec3 light_direction = normalize(light.position - position);
     float theta = dot(light_direction, normalize(-light.direction));
     float epsilon = light.inner_cutoff - light.outer_cutoff;
@@ -82,17 +69,23 @@ void main()
     float current_depth = light_space_proj_coords.z;
     float bias = max(0.005 * (1.0 - dot(n, l)), 0.005);
     float shadow = 0.0;
-    vec2 texel_size = 1.0 / textureSize(light.depth_map, 0);
-    for (int x = -1; x <= 1; x++)
+    vec2 texel_size = 1.0 / textureSize(shadow_atlas, 0);
+    if (shadows)
     {
-        for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
         {
-            float pcf_depth = texture(light.depth_map, light_space_proj_coords.xy + vec2(x, y) * texel_size).r;
-            shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
+            for (int y = -1; y <= 1; y++)
+            {
+                // offsets are a texel of the atlas, which is smaller than a texel of the tile's own uv
+                vec2 uv = light_space_proj_coords.xy + vec2(x, y) * texel_size / light.shadow_tile.z;
+                float pcf_depth = texture(shadow_atlas, calc_shadow_atlas_uv(light.shadow_tile, uv, texel_size)).r;
+                shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
+            }
         }
+        shadow /= 9.0;
+        // outside the tile nothing was drawn, the atlas has no border to fall back on
+        if (light_space_proj_coords.z > 1.0 || any(lessThan(light_space_proj_coords.xy, vec2(0.0))) || any(greaterThan(light_space_proj_coords.xy, vec2(1.0)))) shadow = 0.0;
     }
-    shadow /= 9.0;
-    if (light_space_proj_coords.z > 1.0) shadow = 0.0;
     color = (1.0 - shadow) * color;
 
     frag_color = vec4(color, 1.0);
@@ -0,0 +1,45 @@
+#version 460 core
+
+layout (local_size_x = 16, local_size_y = 16) in;
+
+uniform sampler2D depth_map;
+
+// nearest and farthest depth drawn, as bits, which order the same as the floats since depth is never negative
+layout (std430, binding = 18) buffer DepthBounds
+{
+    uint min_depth;
+    uint max_depth;
+};
+
+shared uint group_min_depth;
+shared uint group_max_depth;
+
+void main()
+{
+    if (gl_LocalInvocationIndex == 0)
+    {
+        group_min_depth = 0xffffffffu;
+        group_max_depth = 0u;
+    }
+    barrier();
+
+    // nothing was drawn where the depth is still cleared to the far plane
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (all(lessThan(texel, textureSize(depth_map, 0))))
+    {
+        float depth = texelFetch(depth_map, texel, 0).r;
+        if (depth < 1.0)
+        {
+            atomicMin(group_min_depth, floatBitsToUint(depth));
+            atomicMax(group_max_depth, floatBitsToUint(depth));
+        }
+    }
+    barrier();
+
+    // one global atomic per group
+    if (gl_LocalInvocationIndex == 0)
+    {
+        atomicMin(min_depth, group_min_depth);
+        atomicMax(max_depth, group_max_depth);
+    }
+}
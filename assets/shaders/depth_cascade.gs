@@ -0,0 +1,25 @@
+#version 460 core
+
+#include "glsl/lights.glsl"
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec4 vertex_position[];
+flat in uint vertex_cascade[];
+
+// the directional light being drawn, in the lights block
+uniform uint light_index;
+
+// only used where the vertex shader can't pick the layer itself
+void main()
+{
+    uint cascade = vertex_cascade[0];
+    gl_Layer = int(cascade);
+    for (int i = 0; i < 3; i++)
+    {
+        gl_Position = directional_lights[light_index].transformation_matrices[cascade] * vertex_position[i];
+        EmitVertex();
+    }
+    EndPrimitive();
+}
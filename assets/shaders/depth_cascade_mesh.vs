@@ -0,0 +1,31 @@
+#version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+
+#include "glsl/instance_models.glsl"
+#include "glsl/lights.glsl"
+
+layout (location = 0) in vec3 position;
+
+// the directional light being drawn, in the lights block
+uniform uint light_index;
+
+#ifndef GL_ARB_shader_viewport_layer_array
+out vec4 vertex_position;
+flat out uint vertex_cascade;
+#endif
+
+// each instance is drawn into the layer of one cascade
+void main()
+{
+    vec4 world_position = get_instance_model() * vec4(position, 1.0);
+    uint cascade = get_instance_view();
+
+#ifdef GL_ARB_shader_viewport_layer_array
+    gl_Layer = int(cascade);
+    gl_Position = directional_lights[light_index].transformation_matrices[cascade] * world_position;
+#else
+    // the geometry shader picks the layer instead
+    vertex_position = world_position;
+    vertex_cascade = cascade;
+#endif
+}
@@ -0,0 +1,42 @@
+#version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+
+#include "glsl/instance_models.glsl"
+#include "glsl/lights.glsl"
+#include "glsl/skinned_mesh_constants.glsl"
+
+layout (location = 0) in vec3 position;
+layout (location = 5) in uint bone_ids[NUM_BONES_PER_VERTEX];
+layout (location = 6) in float bone_weights[NUM_BONES_PER_VERTEX];
+
+uniform mat4 bone_transformations[MAX_BONE_TRANSFORMATIONS];
+
+// the directional light being drawn, in the lights block
+uniform uint light_index;
+
+#ifndef GL_ARB_shader_viewport_layer_array
+out vec4 vertex_position;
+flat out uint vertex_cascade;
+#endif
+
+// each instance is drawn into the layer of one cascade
+void main()
+{
+    mat4 bone_transformation = mat4(0.0);
+    for (int i = 0; i < NUM_BONES_PER_VERTEX; i++)
+    {
+        bone_transformation += bone_transformations[bone_ids[i]] * bone_weights[i];
+    }
+
+    vec4 world_position = get_instance_model() * bone_transformation * vec4(position, 1.0);
+    uint cascade = get_instance_view();
+
+#ifdef GL_ARB_shader_viewport_layer_array
+    gl_Layer = int(cascade);
+    gl_Position = directional_lights[light_index].transformation_matrices[cascade] * world_position;
+#else
+    // the geometry shader picks the layer instead
+    vertex_position = world_position;
+    vertex_cascade = cascade;
+#endif
+}
@@ -1,15 +1,13 @@
 #version 460 core
 
+#include "glsl/lights.glsl"
+
 in vec4 frag_position;
 
-uniform struct Light
-{
-    float far_plane;
-    vec3 position;
-    mat4 transformation_matrices[6];
-} light;
+// the point light being drawn, in the lights block
+uniform uint light_index;
 
 void main()
 {
-    gl_FragDepth = length(frag_position.xyz - light.position) / light.far_plane;
+    gl_FragDepth = length(frag_position.xyz - point_lights[light_index].position) / point_lights[light_index].radius;
 }
@@ -1,28 +1,29 @@
 #version 460 core
 
+#include "glsl/lights.glsl"
+
 layout (triangles) in;
-layout (triangle_strip, max_vertices = 18) out;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec4 vertex_position[];
+flat in uint vertex_face[];
 
 out vec4 frag_position;
 
-uniform struct Light
-{
-    float far_plane;
-    vec3 position;
-    mat4 transformation_matrices[6];
-} light;
+// the point light being drawn, in the lights block
+uniform uint light_index;
 
+// only used where the vertex shader can't pick the viewport itself
+// the face was already chosen per instance, so each triangle is sent to just the one tile
 void main()
 {
-    for (int face = 0; face < 6; face++)
+    uint face = vertex_face[0];
+    gl_ViewportIndex = int(face) + 1;
+    for (int i = 0; i < 3; i++)
     {
-        gl_Layer = face;
-        for (int i = 0; i < 3; i++)
-        {
-            frag_position = gl_in[i].gl_Position;
-            gl_Position = light.transformation_matrices[face] * frag_position;
-            EmitVertex();
-        }
-        EndPrimitive();
+        frag_position = vertex_position[i];
+        gl_Position = point_lights[light_index].transformation_matrices[face] * vertex_position[i];
+        EmitVertex();
     }
+    EndPrimitive();
 }
@@ -1,10 +1,34 @@
 #version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+
+#include "glsl/instance_models.glsl"
+#include "glsl/lights.glsl"
 
 layout (location = 0) in vec3 position;
 
-uniform mat4 model;
+// the point light being drawn, in the lights block
+uniform uint light_index;
+
+#ifdef GL_ARB_shader_viewport_layer_array
+out vec4 frag_position;
+#else
+out vec4 vertex_position;
+flat out uint vertex_face;
+#endif
 
+// each instance is drawn into the tile of one face, viewports 1 to 6 are set to them
 void main()
 {
-    gl_Position = model * vec4(position, 1.0);
+    vec4 world_position = get_instance_model() * vec4(position, 1.0);
+    uint face = get_instance_view();
+
+#ifdef GL_ARB_shader_viewport_layer_array
+    frag_position = world_position;
+    gl_ViewportIndex = int(face) + 1;
+    gl_Position = point_lights[light_index].transformation_matrices[face] * world_position;
+#else
+    // the geometry shader picks the viewport instead
+    vertex_position = world_position;
+    vertex_face = face;
+#endif
 }
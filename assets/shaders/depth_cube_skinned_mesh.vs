@@ -1,15 +1,27 @@
 #version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
 
+#include "glsl/instance_models.glsl"
+#include "glsl/lights.glsl"
 #include "glsl/skinned_mesh_constants.glsl"
 
 layout (location = 0) in vec3 position;
 layout (location = 5) in uint bone_ids[NUM_BONES_PER_VERTEX];
 layout (location = 6) in float bone_weights[NUM_BONES_PER_VERTEX];
 
-uniform mat4 model;
-
 uniform mat4 bone_transformations[MAX_BONE_TRANSFORMATIONS];
 
+// the point light being drawn, in the lights block
+uniform uint light_index;
+
+#ifdef GL_ARB_shader_viewport_layer_array
+out vec4 frag_position;
+#else
+out vec4 vertex_position;
+flat out uint vertex_face;
+#endif
+
+// each instance is drawn into the tile of one face, viewports 1 to 6 are set to them
 void main()
 {
     mat4 bone_transformation = mat4(0.0);
@@ -18,5 +30,16 @@ void main()
         bone_transformation += bone_transformations[bone_ids[i]] * bone_weights[i];
     }
 
-    gl_Position = model * bone_transformation * vec4(position, 1.0);
+    vec4 world_position = get_instance_model() * bone_transformation * vec4(position, 1.0);
+    uint face = get_instance_view();
+
+#ifdef GL_ARB_shader_viewport_layer_array
+    frag_position = world_position;
+    gl_ViewportIndex = int(face) + 1;
+    gl_Position = point_lights[light_index].transformation_matrices[face] * world_position;
+#else
+    // the geometry shader picks the viewport instead
+    vertex_position = world_position;
+    vertex_face = face;
+#endif
 }
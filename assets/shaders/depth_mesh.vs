@@ -1,10 +1,11 @@
 #version 460 core
 
-layout (location = 0) in vec3 position;
+#include "glsl/instance_models.glsl"
+#include "glsl/view.glsl"
 
-uniform mat4 mvp;
+layout (location = 0) in vec3 position;
 
 void main()
 {
-    gl_Position = mvp * vec4(position, 1.0);
+    gl_Position = view.view_projection * get_instance_model() * vec4(position, 1.0);
 }
@@ -1,13 +1,13 @@
 #version 460 core
 
+#include "glsl/instance_models.glsl"
 #include "glsl/skinned_mesh_constants.glsl"
+#include "glsl/view.glsl"
 
 layout (location = 0) in vec3 position;
 layout (location = 5) in uint bone_ids[NUM_BONES_PER_VERTEX];
 layout (location = 6) in float bone_weights[NUM_BONES_PER_VERTEX];
 
-uniform mat4 mvp;
-
 uniform mat4 bone_transformations[MAX_BONE_TRANSFORMATIONS];
 
 void main()
@@ -18,5 +18,5 @@ void main()
         bone_transformation += bone_transformations[bone_ids[i]] * bone_weights[i];
     }
 
-    gl_Position = mvp * bone_transformation * vec4(position, 1.0);
+    gl_Position = view.view_projection * get_instance_model() * bone_transformation * vec4(position, 1.0);
 }
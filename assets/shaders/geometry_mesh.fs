@@ -1,5 +1,9 @@
 #version 460 core
 
+#include "glsl/draws.glsl"
+#include "glsl/gbuffer.glsl"
+#include "glsl/materials.glsl"
+
 in struct Vertex
 {
     vec3 position;
@@ -7,23 +11,20 @@ in struct Vertex
     vec2 uv;
 } vertex;
 
+flat in uint draw_index;
+
 layout (location = 0) out vec3 position_map;
-layout (location = 1) out vec3 normal_map;
+layout (location = 1) out vec4 normal_map;
 layout (location = 2) out vec3 albedo_map;
 layout (location = 3) out vec4 material_map;
 
 uniform struct Material
 {
     sampler2D albedo_map;
-    bool has_normal_map;
     sampler2D normal_map;
-    bool has_metallic_map;
     sampler2D metallic_map;
-    bool has_roughness_map;
     sampler2D roughness_map;
-    bool has_occlusion_map;
     sampler2D occlusion_map;
-    bool has_height_map;
     sampler2D height_map;
 } material;
 
@@ -46,11 +47,13 @@ vec3 calc_normal()
 
 void main()
 {
+    MaterialParameters parameters = materials[draws[draw_index].material_index];
+
     position_map = vertex.position;
-    normal_map = material.has_normal_map ? calc_normal() : normalize(vertex.normal);
-    albedo_map = texture(material.albedo_map, vertex.uv).rgb;
-    material_map.r = material.has_metallic_map ? texture(material.metallic_map, vertex.uv).r : 0.0;
-    material_map.g = material.has_roughness_map ? texture(material.roughness_map, vertex.uv).r : 1.0;
-    material_map.b = material.has_occlusion_map ? texture(material.occlusion_map, vertex.uv).r : 1.0;
-    material_map.a = material.has_height_map ? texture(material.height_map, vertex.uv).r : 0.0;
+    normal_map = encode_normal((parameters.flags & MATERIAL_HAS_NORMAL_MAP) != 0 ? calc_normal() : normalize(vertex.normal));
+    albedo_map = (parameters.flags & MATERIAL_HAS_ALBEDO_MAP) != 0 ? texture(material.albedo_map, vertex.uv).rgb : parameters.albedo_color;
+    material_map.r = (parameters.flags & MATERIAL_HAS_METALLIC_MAP) != 0 ? texture(material.metallic_map, vertex.uv).r : parameters.metallic;
+    material_map.g = (parameters.flags & MATERIAL_HAS_ROUGHNESS_MAP) != 0 ? texture(material.roughness_map, vertex.uv).r : parameters.roughness;
+    material_map.b = (parameters.flags & MATERIAL_HAS_OCCLUSION_MAP) != 0 ? texture(material.occlusion_map, vertex.uv).r : 1.0;
+    material_map.a = (parameters.flags & MATERIAL_HAS_HEIGHT_MAP) != 0 ? texture(material.height_map, vertex.uv).r : 0.0;
 }
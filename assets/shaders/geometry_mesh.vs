@@ -1,5 +1,9 @@
 #version 460 core
 
+#include "glsl/draws.glsl"
+#include "glsl/instance_models.glsl"
+#include "glsl/view.glsl"
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 uv;
@@ -13,19 +17,20 @@ out struct Vertex
     vec2 uv;
 } vertex;
 
-uniform mat4 mvp;
-
-uniform mat4 model;
-uniform vec4 clipping_plane;
+flat out uint draw_index;
 
-uniform float tiling = 1.0;
+uniform uint draw_offset;
 
 void main()
 {
+    draw_index = draw_offset + gl_DrawID;
+
+    mat4 model = get_instance_model();
+
     vertex.position = (model * vec4(position, 1.0)).xyz;
     vertex.normal = (model * vec4(normal, 0.0)).xyz;
-    vertex.uv = uv * tiling;
+    vertex.uv = uv * draws[draw_index].tiling;
 
-    gl_Position = mvp * vec4(position, 1.0);
-	gl_ClipDistance[0] = dot(vec4(vertex.position, 1.0), clipping_plane);
+    gl_Position = view.view_projection * vec4(vertex.position, 1.0);
+	gl_ClipDistance[0] = dot(vec4(vertex.position, 1.0), view.clipping_plane);
 }
@@ -1,6 +1,9 @@
 #version 460 core
 
+#include "glsl/draws.glsl"
+#include "glsl/instance_models.glsl"
 #include "glsl/skinned_mesh_constants.glsl"
+#include "glsl/view.glsl"
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
@@ -17,14 +20,11 @@ out struct Vertex
     vec2 uv;
 } vertex;
 
-uniform mat4 mvp;
+flat out uint draw_index;
 
 uniform mat4 bone_transformations[MAX_BONE_TRANSFORMATIONS];
 
-uniform mat4 model;
-uniform vec4 clipping_plane;
-
-uniform float tiling = 1.0;
+uniform uint draw_offset;
 
 void main()
 {
@@ -34,10 +34,14 @@ void main()
         bone_transformation += bone_transformations[bone_ids[i]] * bone_weights[i];
     }
 
+    draw_index = draw_offset + gl_DrawID;
+
+    mat4 model = get_instance_model();
+
     vertex.position = (model * bone_transformation * vec4(position, 1.0)).xyz;
     vertex.normal = (model * bone_transformation * vec4(normal, 0.0)).xyz;
-    vertex.uv = uv * tiling;
+    vertex.uv = uv * draws[draw_index].tiling;
 
-    gl_Position = mvp * bone_transformation * vec4(position, 1.0);
-	gl_ClipDistance[0] = dot(vec4(vertex.position, 1.0), clipping_plane);
+    gl_Position = view.view_projection * vec4(vertex.position, 1.0);
+	gl_ClipDistance[0] = dot(vec4(vertex.position, 1.0), view.clipping_plane);
 }
@@ -1,5 +1,7 @@
 #version 460 core
 
+#include "glsl/gbuffer.glsl"
+
 in struct Vertex
 {
     vec3 position;
@@ -8,7 +10,7 @@ in struct Vertex
 } vertex;
 
 layout (location = 0) out vec3 position_map;
-layout (location = 1) out vec3 normal_map;
+layout (location = 1) out vec4 normal_map;
 layout (location = 2) out vec3 albedo_map;
 layout (location = 3) out vec4 material_map;
 
@@ -44,7 +46,7 @@ vec3 calc_normal()
 void main()
 {
     position_map = vertex.position;
-    normal_map = calc_normal();
+    normal_map = encode_normal(calc_normal());
     albedo_map = texture(materials[0].albedo_map, vertex.uv).rgb;
     material_map.r = texture(materials[0].metallic_map, vertex.uv).r;
     material_map.g = texture(materials[0].roughness_map, vertex.uv).r;
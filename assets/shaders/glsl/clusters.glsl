@@ -0,0 +1,37 @@
+#ifndef CLUSTERS_GLSL
+#define CLUSTERS_GLSL
+
+// must match the defines in src/renderer.hpp
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+#define NUM_CLUSTERS (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+
+// a cluster's lights start at its index * MAX_LIGHTS_PER_CLUSTER in the light index list, point lights first
+struct Cluster
+{
+    uint point_count;
+    uint spot_count;
+};
+
+// depth slices are spaced exponentially between the near and far plane, so clusters stay roughly cubic
+float calc_slice_depth(uint slice, float near_plane, float far_plane)
+{
+    return near_plane * pow(far_plane / near_plane, float(slice) / float(CLUSTER_GRID_Z));
+}
+
+// frag_coord is relative to the pass's viewport, view_depth is the distance in front of the camera
+uint find_cluster(vec2 frag_coord, vec2 screen_size, float view_depth, float near_plane, float far_plane)
+{
+    uvec2 tile = uvec2(clamp(frag_coord / screen_size, 0.0, 1.0) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    tile = min(tile, uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+
+    float slice = log(max(view_depth, near_plane) / near_plane) / log(far_plane / near_plane) * float(CLUSTER_GRID_Z);
+    uint z = min(uint(slice), uint(CLUSTER_GRID_Z - 1));
+
+    return tile.x + tile.y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef CULL_COMMANDS_GLSL
+#define CULL_COMMANDS_GLSL
+
+// command of candidates no command covers, must match NO_CULL_COMMAND in src/render_queue.hpp
+const uint NO_CULL_COMMAND = 0xffffffffu;
+
+// must match liminal::draw_elements_indirect_command in src/render_queue.hpp
+struct DrawCommand
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+// must match liminal::cull_command in src/render_queue.hpp
+struct CullCommand
+{
+    vec4 aabb_min;
+    vec4 aabb_max;
+    uint first_instance;
+    uint instance_count;
+    uint batch;
+    uint batch_first_command;
+};
+
+layout (std430, binding = 5) readonly buffer CullCommands
+{
+    CullCommand cull_commands[];
+};
+
+#endif
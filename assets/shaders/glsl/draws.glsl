@@ -0,0 +1,15 @@
+#ifndef DRAWS_GLSL
+#define DRAWS_GLSL
+
+struct Draw
+{
+    uint material_index;
+    float tiling;
+};
+
+layout (std430, binding = 1) readonly buffer Draws
+{
+    Draw draws[];
+};
+
+#endif
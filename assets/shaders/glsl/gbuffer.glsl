@@ -0,0 +1,67 @@
+#ifndef GBUFFER_GLSL
+#define GBUFFER_GLSL
+
+#include "glsl/view.glsl"
+
+// the gbuffer comes in two layouts, see liminal::renderer::set_screen_size
+// full: position, normal and albedo rgb16f, material rgba16f
+// compact: position reconstructed from depth, octahedral normal rg16, albedo srgb8_alpha8, material rgba8
+// the geometry programs always write every target, the compact layout just doesn't have a position one
+
+uniform struct Geometry
+{
+    sampler2D position_map;
+    sampler2D normal_map;
+    sampler2D albedo_map;
+    sampler2D material_map;
+    sampler2D depth_map;
+} geometry;
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// folds the unit sphere onto an octahedron and unwraps it into a square, mapped to [0, 1]
+vec2 encode_octahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 decode_octahedral(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    }
+    return normalize(n);
+}
+
+vec4 encode_normal(vec3 n)
+{
+    return view.compact_gbuffer != 0 ? vec4(encode_octahedral(n), 0.0, 0.0) : vec4(n, 0.0);
+}
+
+// uv is into the gbuffer, which can be bigger than the pass
+vec3 read_position(vec2 uv)
+{
+    if (view.compact_gbuffer != 0)
+    {
+        float depth = texture(geometry.depth_map, uv).r;
+        vec4 position = view.inverse_view_projection * vec4(vec3(uv / view.gbuffer_scale, depth) * 2.0 - 1.0, 1.0);
+        return position.xyz / position.w;
+    }
+    return texture(geometry.position_map, uv).rgb;
+}
+
+vec3 read_normal(vec2 uv)
+{
+    vec4 normal = texture(geometry.normal_map, uv);
+    return view.compact_gbuffer != 0 ? decode_octahedral(normal.rg) : normalize(normal.rgb);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef INSTANCE_MODELS_GLSL
+#define INSTANCE_MODELS_GLSL
+
+// passes that draw to several views at once (cube faces, cascades) draw an instance once for each view it touches
+// with the view in the top bits, must match src/renderer.hpp
+#define INSTANCE_INDEX_MASK 0x1fffffffu
+#define INSTANCE_VIEW_SHIFT 29u
+
+layout (std430, binding = 0) readonly buffer InstanceModels
+{
+    mat4 instance_models[];
+};
+
+// instances that survived culling in the current pass, as indices into instance_models
+layout (std430, binding = 2) readonly buffer VisibleInstances
+{
+    uint visible_instances[];
+};
+
+mat4 get_instance_model()
+{
+    return instance_models[visible_instances[gl_BaseInstance + gl_InstanceID] & INSTANCE_INDEX_MASK];
+}
+
+uint get_instance_view()
+{
+    return visible_instances[gl_BaseInstance + gl_InstanceID] >> INSTANCE_VIEW_SHIFT;
+}
+
+#endif
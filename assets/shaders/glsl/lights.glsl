@@ -0,0 +1,73 @@
+#ifndef LIGHTS_GLSL
+#define LIGHTS_GLSL
+
+// must match the defines and structs in src/uniforms.hpp and src/directional_light.hpp
+#define MAX_DIRECTIONAL_LIGHTS 4
+#define NUM_CASCADES 4
+
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 color;
+    mat4 transformation_matrices[NUM_CASCADES];
+};
+
+// point and spot lights fade out to nothing at their radius, which is also their shadow's far plane
+struct PointLight
+{
+    vec3 position;
+    float radius;
+    vec3 color;
+    uint casts_shadows;
+    mat4 transformation_matrices[6];
+    vec4 shadow_tiles[6];
+};
+
+struct SpotLight
+{
+    vec3 position;
+    float inner_cutoff;
+    vec3 direction;
+    float outer_cutoff;
+    vec3 color;
+    float radius;
+    mat4 transformation_matrix;
+    vec4 shadow_tile;
+    uint casts_shadows;
+};
+
+// every light in the scene, uploaded once per frame
+layout (std140, binding = 1) uniform Lights
+{
+    DirectionalLight directional_lights[MAX_DIRECTIONAL_LIGHTS];
+    uint num_directional_lights;
+    uint num_point_lights;
+    uint num_spot_lights;
+};
+
+layout (std430, binding = 14) readonly buffer PointLights
+{
+    PointLight point_lights[];
+};
+
+layout (std430, binding = 15) readonly buffer SpotLights
+{
+    SpotLight spot_lights[];
+};
+
+// point and spot lights with shadows have tiles in one shared depth texture, xy is a tile's corner and z its size in uv
+// samples are clamped half a texel inside the tile, so filtering near its edge can't pick up a neighbour
+vec2 calc_shadow_atlas_uv(vec4 tile, vec2 uv, vec2 texel_size)
+{
+    return clamp(tile.xy + uv * tile.z, tile.xy + texel_size * 0.5, tile.xy + tile.z - texel_size * 0.5);
+}
+
+// inverse square falloff, windowed so it reaches zero at the radius instead of never
+float calc_attenuation(float distance, float radius)
+{
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / max(distance * distance, 0.0001);
+}
+
+#endif
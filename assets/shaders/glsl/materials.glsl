@@ -0,0 +1,26 @@
+#ifndef MATERIALS_GLSL
+#define MATERIALS_GLSL
+
+// must match the defines in src/material.hpp
+#define MATERIAL_HAS_NORMAL_MAP (1u << 0)
+#define MATERIAL_HAS_METALLIC_MAP (1u << 1)
+#define MATERIAL_HAS_ROUGHNESS_MAP (1u << 2)
+#define MATERIAL_HAS_OCCLUSION_MAP (1u << 3)
+#define MATERIAL_HAS_HEIGHT_MAP (1u << 4)
+#define MATERIAL_HAS_ALBEDO_MAP (1u << 5)
+
+// factors are used in place of the maps that are missing
+struct MaterialParameters
+{
+    vec3 albedo_color;
+    uint flags;
+    float metallic;
+    float roughness;
+};
+
+layout (std430, binding = 13) readonly buffer Materials
+{
+    MaterialParameters materials[];
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SSR_GLSL
+#define SSR_GLSL
+
+#include "glsl/view.glsl"
+
+// screen space reflections, traced through a pyramid of the nearest depth on screen
+// cells the ray passes in front of are skipped whole, so long rays take few steps
+
+#define SSR_MAX_ITERATIONS 64
+
+float ssr_view_distance(float depth)
+{
+    return 2.0 * view.near_plane * view.far_plane / (view.far_plane + view.near_plane - (2.0 * depth - 1.0) * (view.far_plane - view.near_plane));
+}
+
+// how far along the ray it leaves the screen, a component of zero never does
+float ssr_exit_distance(vec3 start, vec3 ray)
+{
+    float t = 1.0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (ray[i] > 0.0)
+        {
+            t = min(t, (1.0 - start[i]) / ray[i]);
+        }
+        else if (ray[i] < 0.0)
+        {
+            t = min(t, -start[i] / ray[i]);
+        }
+    }
+    return t;
+}
+
+// returns how much the hit can be trusted, 0 for a miss
+float trace_screen_space(sampler2D hi_z_map, vec3 position, vec3 direction, out vec2 hit_uv)
+{
+    hit_uv = vec2(0.0);
+
+    // the ray in screen space, xy in uv and z in depth, both of which are linear along it
+    // its end is kept in front of the camera, or it would flip when projected
+    vec4 start_clip = view.view_projection * vec4(position, 1.0);
+    vec4 end_clip = view.view_projection * vec4(position + direction * view.far_plane, 1.0);
+    if (end_clip.w < view.near_plane)
+    {
+        end_clip = mix(start_clip, end_clip, (start_clip.w - view.near_plane) / (start_clip.w - end_clip.w));
+    }
+    vec3 start = (start_clip.xyz / start_clip.w) * 0.5 + 0.5;
+    vec3 end = (end_clip.xyz / end_clip.w) * 0.5 + 0.5;
+    vec3 ray = end - start;
+    if (length(ray.xy) < 1e-6)
+    {
+        return 0.0;
+    }
+    float t_max = ssr_exit_distance(start, ray);
+
+    // crossing a cell boundary lands a hundredth of a texel past it, so the next step reads the next cell
+    vec2 texel_size = 1.0 / vec2(textureSize(hi_z_map, 0));
+    vec2 crossing_offset = sign(ray.xy) * texel_size * 0.01;
+
+    // start two texels out so the ray doesn't hit the surface it leaves
+    int max_level = textureQueryLevels(hi_z_map) - 1;
+    int level = 0;
+    float t = 2.0 * length(texel_size) / length(ray.xy);
+    for (int i = 0; i < SSR_MAX_ITERATIONS && level >= 0; i++)
+    {
+        if (t >= t_max)
+        {
+            return 0.0;
+        }
+
+        vec3 p = start + ray * t;
+        vec2 cell_count = vec2(textureSize(hi_z_map, level));
+        vec2 cell = min(floor(p.xy * cell_count), cell_count - 1.0);
+        float nearest_depth = texelFetch(hi_z_map, ivec2(cell), level).r;
+
+        // behind the nearest surface of the cell, look at its smaller cells
+        if (p.z >= nearest_depth)
+        {
+            level--;
+            continue;
+        }
+
+        // in front of it, move to where the ray reaches that depth or leaves the cell, whichever is first
+        vec2 boundary = (cell + step(0.0, ray.xy)) / cell_count + crossing_offset;
+        vec2 t_boundary = mix(vec2(t_max), (boundary - start.xy) / ray.xy, notEqual(ray.xy, vec2(0.0)));
+        float t_cell = min(t_boundary.x, t_boundary.y);
+        float t_depth = ray.z > 0.0 ? (nearest_depth - start.z) / ray.z : t_max;
+        if (t_depth < t_cell)
+        {
+            t = t_depth;
+            level--;
+        }
+        else
+        {
+            t = t_cell;
+            level = min(level + 1, max_level);
+        }
+    }
+
+    // ran out of steps
+    if (level >= 0)
+    {
+        return 0.0;
+    }
+
+    // the pyramid only knows the front of things, a ray that went far behind one passed it
+    vec3 hit = start + ray * t;
+    float hit_distance = ssr_view_distance(hit.z);
+    float surface_distance = ssr_view_distance(texelFetch(hi_z_map, min(ivec2(hit.xy / texel_size), textureSize(hi_z_map, 0) - 1), 0).r);
+    if (hit_distance - surface_distance > max(0.25, surface_distance * 0.02))
+    {
+        return 0.0;
+    }
+    hit_uv = hit.xy;
+
+    // fade out towards the edges of the screen, where rays start missing what's just off it
+    vec2 edge = smoothstep(0.0, 0.1, hit_uv) * (1.0 - smoothstep(0.9, 1.0, hit_uv));
+    return edge.x * edge.y;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef VIEW_GLSL
+#define VIEW_GLSL
+
+// the camera or light the current pass is drawn from, uploaded once per pass
+// must match liminal::view_uniforms in src/uniforms.hpp
+layout (std140, binding = 0) uniform View
+{
+    mat4 view_projection;
+    mat4 inverse_view_projection;
+    vec4 clipping_plane;
+    vec3 position;
+    float near_plane;
+    float far_plane;
+    uint compact_gbuffer; // layout the gbuffer was allocated with, see glsl/gbuffer.glsl
+    vec2 gbuffer_scale; // part of the gbuffer the pass covers, passes smaller than it draw into the bottom left corner
+} view;
+
+#endif
@@ -0,0 +1,43 @@
+#version 460 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D input_map;
+uniform int input_level;
+uniform bool first_level;
+uniform bool nearest; // keeps the nearest depth instead of the farthest
+
+layout (r32f, binding = 0) uniform writeonly image2D output_map;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 output_size = imageSize(output_map);
+    if (any(greaterThanEqual(texel, output_size)))
+    {
+        return;
+    }
+
+    if (first_level)
+    {
+        imageStore(output_map, texel, vec4(texelFetch(input_map, texel, 0).r));
+        return;
+    }
+
+    // the last texel of a row or column also covers the leftover texel of an odd sized level
+    ivec2 input_size = textureSize(input_map, input_level);
+    ivec2 start = texel * 2;
+    ivec2 end = min(start + 1 + ivec2(equal(texel, output_size - 1)) * (input_size & 1), input_size - 1);
+
+    float depth = nearest ? 1.0 : 0.0;
+    for (int y = start.y; y <= end.y; y++)
+    {
+        for (int x = start.x; x <= end.x; x++)
+        {
+            float input_depth = texelFetch(input_map, ivec2(x, y), input_level).r;
+            depth = nearest ? min(depth, input_depth) : max(depth, input_depth);
+        }
+    }
+
+    imageStore(output_map, texel, vec4(depth));
+}
@@ -1,4 +1,8 @@
 #version 460 core
+#inject
+
+// every post effect in one pass, only the enabled ones are compiled in, see liminal::renderer::get_screen_program
+// so the hdr image is read once and the screen written once however many effects there are
 
 in struct Vertex
 {
@@ -9,28 +13,44 @@ out vec4 frag_color;
 
 uniform sampler2D hdr_map;
 uniform sampler2D bloom_map;
+uniform sampler3D color_lut;
 
-uniform uint greyscale;
+uniform float exposure;
+uniform float bloom_strength; // the bloom is the sum of every level of its chain, this averages them
+uniform float vignette;
 
 const float gamma = 2.2;
-const float exposure = 1.0;
 const float white = 1.0;
 
 void main()
 {
-	vec3 hdr_color = texture(hdr_map, vertex.uv).rgb;
-	vec3 bloom_color = texture(bloom_map, vertex.uv).rgb;
+	vec3 color = texture(hdr_map, vertex.uv).rgb;
+
+#ifdef BLOOM
+	color += texture(bloom_map, vertex.uv).rgb * bloom_strength;
+#endif
+
+	color *= exposure;
+
+#ifdef VIGNETTE
+	vec2 from_center = vertex.uv - 0.5;
+	color *= 1.0 - vignette * smoothstep(0.2, 0.8, dot(from_center, from_center) * 2.0);
+#endif
 
-	vec3 color = (hdr_color + bloom_color) * exposure;
 	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
 	float mapped_luminance = (luminance * (1.0 + luminance / (white * white))) / (1.0 + luminance);
-    color = (mapped_luminance / luminance) * color;
-    color = pow(color, vec3(1.0 / gamma));
+	color = luminance > 0.0 ? (mapped_luminance / luminance) * color : vec3(0.0);
+	color = pow(clamp(color, 0.0, 1.0), vec3(1.0 / gamma));
+
+#ifdef COLOR_GRADING
+	// the lut is indexed by the gamma corrected color, through the centers of its edge texels
+	vec3 lut_size = vec3(textureSize(color_lut, 0));
+	color = texture(color_lut, color * (lut_size - 1.0) / lut_size + 0.5 / lut_size).rgb;
+#endif
 
-	if (greyscale == 1)
-	{
-		color = vec3((color.r + color.g + color.b) / 3);
-	}
+#ifdef GREYSCALE
+	color = vec3((color.r + color.g + color.b) / 3);
+#endif
 
-    frag_color = vec4(color, 1.0);
+	frag_color = vec4(color, 1.0);
 }
@@ -0,0 +1,72 @@
+#version 460 core
+
+#include "glsl/fresnel_schlick.glsl"
+#include "glsl/gbuffer.glsl"
+#include "glsl/ssr.glsl"
+#include "glsl/view.glsl"
+
+in struct Vertex
+{
+    vec2 uv;
+} vertex;
+
+layout (location = 0) out vec4 frag_color;
+layout (location = 1) out vec4 bright_color;
+
+uniform sampler2D hi_z_map;
+uniform sampler2D color_map;
+uniform samplerCube prefilter_cubemap;
+uniform sampler2D brdf_map;
+
+// rougher surfaces keep the skybox's reflection, one ray can't stand in for how blurry theirs is
+const float max_roughness = 0.6;
+
+void main()
+{
+    float depth = texture(geometry.depth_map, vertex.uv).r;
+    float roughness = texture(geometry.material_map, vertex.uv).g;
+    if (depth == 1.0 || roughness >= max_roughness)
+    {
+        discard;
+    }
+
+    vec3 position = read_position(vertex.uv);
+    vec3 normal = read_normal(vertex.uv);
+    vec3 albedo = texture(geometry.albedo_map, vertex.uv).rgb;
+    float metallic = texture(geometry.material_map, vertex.uv).r;
+    float ao = texture(geometry.material_map, vertex.uv).b;
+
+    vec3 n = normalize(normal);
+    vec3 v = normalize(view.position - position);
+    vec3 r = reflect(-v, n);
+
+    vec2 hit_uv;
+    float confidence = trace_screen_space(hi_z_map, position, r, hit_uv);
+
+    // the back of something was never lit from the side the ray sees
+    if (confidence > 0.0 && dot(read_normal(hit_uv), r) > 0.0)
+    {
+        confidence = 0.0;
+    }
+    confidence *= 1.0 - smoothstep(max_roughness * 0.5, max_roughness, roughness);
+    if (confidence <= 0.0)
+    {
+        discard;
+    }
+
+    vec3 f0 = vec3(0.04);
+    f0 = mix(f0, albedo, metallic);
+    vec3 f = fresnel_schlick_roughness(max(dot(n, v), 0.0), f0, roughness);
+    vec2 brdf = texture(brdf_map, vec2(max(dot(n, v), 0.0), roughness)).rg;
+
+    // the ambient pass already added the skybox's reflection, this swaps it for what the ray hit
+    // the lit image's mips blur the reflection like the prefiltered skybox's do
+    const float MAX_REFLECTION_LOD = 4.0;
+    vec3 reflection = textureLod(color_map, hit_uv, roughness * MAX_REFLECTION_LOD).rgb;
+    vec3 prefilter = textureLod(prefilter_cubemap, r, roughness * MAX_REFLECTION_LOD).rgb;
+    vec3 specular = (reflection - prefilter) * (f * brdf.x + brdf.y) * ao;
+
+    // added to the lit image, which is floating point so the difference can be negative
+    frag_color = vec4(specular * confidence, 0.0);
+    bright_color = vec4(0.0);
+}
@@ -1,5 +1,9 @@
 #version 460 core
 
+#include "glsl/lights.glsl"
+#include "glsl/ssr.glsl"
+#include "glsl/view.glsl"
+
 in struct Vertex
 {
     vec3 position;
@@ -11,13 +15,6 @@ in struct Vertex
 layout (location = 0) out vec4 frag_color;
 layout (location = 1) out vec4 bright_color;
 
-uniform struct Camera
-{
-    float near_plane;
-    float far_plane;
-    vec3 position;
-} camera;
-
 uniform struct Water
 {
 	sampler2D reflection_map;
@@ -27,14 +24,13 @@ uniform struct Water
 	sampler2D normal_map;
 } water;
 
-uniform struct Light
-{
-    vec3 direction;
-    vec3 color;
-} light;
-
 uniform uint current_time;
 
+// traces the reflection against the camera pass instead of sampling a mirrored render of the scene
+uniform bool screen_space_reflections;
+uniform sampler2D hi_z_map;
+uniform samplerCube environment_cubemap;
+
 const float speed = 0.02;
 const float wave_strength = 0.01;
 const float reflectivity = 0.5;
@@ -47,9 +43,9 @@ void main()
 	vec2 refraction_uv = vec2(clip_space_proj_coords.x, clip_space_proj_coords.y);
 
 	float depth_to_floor = texture(water.depth_map, refraction_uv).r;
-	float distance_to_floor = 2.0 * camera.near_plane * camera.far_plane / (camera.far_plane + camera.near_plane - (2.0 * depth_to_floor - 1.0) * (camera.far_plane - camera.near_plane));
+	float distance_to_floor = 2.0 * view.near_plane * view.far_plane / (view.far_plane + view.near_plane - (2.0 * depth_to_floor - 1.0) * (view.far_plane - view.near_plane));
 	float depth_to_surface = gl_FragCoord.z;
-	float distance_to_surface = 2.0 * camera.near_plane * camera.far_plane / (camera.far_plane + camera.near_plane - (2.0 * depth_to_surface - 1.0) * (camera.far_plane - camera.near_plane));
+	float distance_to_surface = 2.0 * view.near_plane * view.far_plane / (view.far_plane + view.near_plane - (2.0 * depth_to_surface - 1.0) * (view.far_plane - view.near_plane));
 	float water_depth = distance_to_floor - distance_to_surface;
 
 	float move_factor = float(current_time) / 1000 * speed;
@@ -57,27 +53,51 @@ void main()
 	distorted_uv += vertex.uv + vec2(distorted_uv.x, distorted_uv.y + move_factor);
 	vec2 distortion = (texture(water.dudv_map, distorted_uv).rg * 2.0 - 1.0) * wave_strength * clamp(water_depth / 20.0, 0.0, 1.0);
 
-	reflection_uv += distortion;
-	reflection_uv.x = clamp(reflection_uv.x, 0.001, 0.999);
-	reflection_uv.y = clamp(reflection_uv.y, -0.999, -0.001);
-	vec3 reflection_color = texture(water.reflection_map, reflection_uv).rgb;
-
+	// the refraction is a copy of the whole camera pass, so a distorted sample can land on something in front of the water
+	vec2 undistorted_refraction_uv = refraction_uv;
 	refraction_uv += distortion;
 	refraction_uv = clamp(refraction_uv, 0.001, 0.999);
+	if (texture(water.depth_map, refraction_uv).r < depth_to_surface)
+	{
+		refraction_uv = undistorted_refraction_uv;
+	}
 	vec3 refraction_color = texture(water.refraction_map, refraction_uv).rgb;
 
 	vec4 normal_color = texture(water.normal_map, distorted_uv);
 	vec3 normal = vec3(normal_color.r * 2.0 - 1.0, normal_color.b * 3.0, normal_color.g * 2.0 - 1.0);
 	normal = normalize(normal);
 	
-	vec3 view_direction = normalize(camera.position - vertex.position);
+	vec3 view_direction = normalize(view.position - vertex.position);
+
+	vec3 reflection_color;
+	if (screen_space_reflections)
+	{
+		// the skybox where the ray leaves the screen or passes behind something
+		vec2 hit_uv;
+		vec3 r = reflect(-view_direction, normal);
+		float confidence = trace_screen_space(hi_z_map, vertex.position, r, hit_uv);
+		reflection_color = mix(texture(environment_cubemap, r).rgb, texture(water.refraction_map, hit_uv).rgb, confidence);
+	}
+	else
+	{
+		reflection_uv += distortion;
+		reflection_uv.x = clamp(reflection_uv.x, 0.001, 0.999);
+		reflection_uv.y = clamp(reflection_uv.y, -0.999, -0.001);
+		reflection_color = texture(water.reflection_map, reflection_uv).rgb;
+	}
+
 	float refractive_factor = dot(abs(view_direction), normal);
 	refractive_factor = pow(refractive_factor, reflectivity);
 	refractive_factor = clamp(refractive_factor, 0.0, 1.0);
 
-	vec3 light_reflection = reflect(normalize(light.direction), normal);
-	float specular_factor = pow(max(dot(light_reflection, view_direction), 0.0), shine_damper);
-	vec3 specular = light.color * specular_factor * reflectivity * clamp(water_depth / 5.0, 0.0, 1.0);
+	// TODO: specular reflections for all lights
+	vec3 specular = vec3(0.0);
+	if (num_directional_lights > 0)
+	{
+		vec3 light_reflection = reflect(normalize(directional_lights[0].direction), normal);
+		float specular_factor = pow(max(dot(light_reflection, view_direction), 0.0), shine_damper);
+		specular = directional_lights[0].color * specular_factor * reflectivity * clamp(water_depth / 5.0, 0.0, 1.0);
+	}
 
 	vec3 color = mix(reflection_color, refraction_color, refractive_factor) + specular;
 
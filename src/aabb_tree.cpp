@@ -0,0 +1,466 @@
+#include "aabb_tree.hpp"
+
+#include <glm/glm.hpp>
+
+static liminal::aabb combine(const liminal::aabb &a, const liminal::aabb &b)
+{
+    liminal::aabb combined = a;
+    combined.expand(b);
+    return combined;
+}
+
+bool liminal::aabb_tree::node::is_leaf() const
+{
+    return children[0] == null_node;
+}
+
+liminal::aabb_tree::aabb_tree(float margin)
+    : margin(margin),
+      root(null_node),
+      free_list(null_node),
+      proxy_count(0)
+{
+}
+
+int liminal::aabb_tree::create_proxy(const liminal::aabb &aabb, void *user_data)
+{
+    int proxy_id = allocate_node();
+    nodes[proxy_id].aabb = liminal::aabb(aabb.min - glm::vec3(margin), aabb.max + glm::vec3(margin));
+    nodes[proxy_id].user_data = user_data;
+    nodes[proxy_id].height = 0;
+
+    insert_leaf(proxy_id);
+    proxy_count++;
+
+    return proxy_id;
+}
+
+void liminal::aabb_tree::destroy_proxy(int proxy_id)
+{
+    remove_leaf(proxy_id);
+    free_node(proxy_id);
+    proxy_count--;
+}
+
+bool liminal::aabb_tree::move_proxy(int proxy_id, const liminal::aabb &aabb)
+{
+    if (nodes[proxy_id].aabb.contains(aabb))
+    {
+        return false;
+    }
+
+    remove_leaf(proxy_id);
+    nodes[proxy_id].aabb = liminal::aabb(aabb.min - glm::vec3(margin), aabb.max + glm::vec3(margin));
+    insert_leaf(proxy_id);
+
+    return true;
+}
+
+void *liminal::aabb_tree::get_user_data(int proxy_id) const
+{
+    return nodes[proxy_id].user_data;
+}
+
+const liminal::aabb &liminal::aabb_tree::get_fat_aabb(int proxy_id) const
+{
+    return nodes[proxy_id].aabb;
+}
+
+void liminal::aabb_tree::query(const liminal::frustum &frustum, const std::function<void(int)> &callback) const
+{
+    if (root == null_node)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        int node_id = stack.back();
+        stack.pop_back();
+
+        const node &current = nodes[node_id];
+        if (!frustum.intersects(current.aabb))
+        {
+            continue;
+        }
+
+        // a node completely inside needs no more plane tests below it
+        if (current.is_leaf() || frustum.contains(current.aabb))
+        {
+            report_leaves(node_id, callback);
+            continue;
+        }
+
+        stack.push_back(current.children[0]);
+        stack.push_back(current.children[1]);
+    }
+}
+
+void liminal::aabb_tree::query(const liminal::bounding_sphere &sphere, const std::function<void(int)> &callback) const
+{
+    if (root == null_node)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        int node_id = stack.back();
+        stack.pop_back();
+
+        const node &current = nodes[node_id];
+        if (!sphere.intersects(current.aabb))
+        {
+            continue;
+        }
+
+        if (current.is_leaf())
+        {
+            callback(node_id);
+            continue;
+        }
+
+        stack.push_back(current.children[0]);
+        stack.push_back(current.children[1]);
+    }
+}
+
+void liminal::aabb_tree::query(const liminal::cone &cone, const std::function<void(int)> &callback) const
+{
+    if (root == null_node)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        int node_id = stack.back();
+        stack.pop_back();
+
+        const node &current = nodes[node_id];
+        if (!cone.intersects(current.aabb))
+        {
+            continue;
+        }
+
+        if (current.is_leaf())
+        {
+            callback(node_id);
+            continue;
+        }
+
+        stack.push_back(current.children[0]);
+        stack.push_back(current.children[1]);
+    }
+}
+
+void liminal::aabb_tree::query(const liminal::aabb &aabb, const std::function<void(int)> &callback) const
+{
+    if (root == null_node)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        int node_id = stack.back();
+        stack.pop_back();
+
+        const node &current = nodes[node_id];
+        if (!aabb.intersects(current.aabb))
+        {
+            continue;
+        }
+
+        if (current.is_leaf())
+        {
+            callback(node_id);
+            continue;
+        }
+
+        stack.push_back(current.children[0]);
+        stack.push_back(current.children[1]);
+    }
+}
+
+void liminal::aabb_tree::query(const liminal::ray &ray, const std::function<void(int, float)> &callback) const
+{
+    if (root == null_node)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        int node_id = stack.back();
+        stack.pop_back();
+
+        const node &current = nodes[node_id];
+        float distance;
+        if (!ray.intersects(current.aabb, distance))
+        {
+            continue;
+        }
+
+        if (current.is_leaf())
+        {
+            callback(node_id, distance);
+            continue;
+        }
+
+        stack.push_back(current.children[0]);
+        stack.push_back(current.children[1]);
+    }
+}
+
+std::size_t liminal::aabb_tree::size() const
+{
+    return proxy_count;
+}
+
+int liminal::aabb_tree::get_height() const
+{
+    return root == null_node ? 0 : nodes[root].height;
+}
+
+int liminal::aabb_tree::allocate_node()
+{
+    int node_id;
+    if (free_list == null_node)
+    {
+        node_id = (int)nodes.size();
+        nodes.push_back(node());
+    }
+    else
+    {
+        node_id = free_list;
+        free_list = nodes[node_id].parent;
+    }
+
+    nodes[node_id].aabb = liminal::aabb();
+    nodes[node_id].user_data = nullptr;
+    nodes[node_id].parent = null_node;
+    nodes[node_id].children[0] = null_node;
+    nodes[node_id].children[1] = null_node;
+    nodes[node_id].height = 0;
+
+    return node_id;
+}
+
+void liminal::aabb_tree::free_node(int node_id)
+{
+    nodes[node_id].parent = free_list;
+    nodes[node_id].height = -1;
+    free_list = node_id;
+}
+
+void liminal::aabb_tree::insert_leaf(int leaf_id)
+{
+    if (root == null_node)
+    {
+        root = leaf_id;
+        nodes[root].parent = null_node;
+        return;
+    }
+
+    // walk down to the sibling that grows the total surface area the least
+    liminal::aabb leaf_aabb = nodes[leaf_id].aabb;
+    int sibling_id = root;
+    while (!nodes[sibling_id].is_leaf())
+    {
+        const node &current = nodes[sibling_id];
+
+        float area = current.aabb.calc_surface_area();
+        float combined_area = combine(current.aabb, leaf_aabb).calc_surface_area();
+
+        // cost of pairing with this node, and the cost every descendant pays for this node growing
+        float cost = 2.0f * combined_area;
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        float child_costs[2];
+        for (int i = 0; i < 2; i++)
+        {
+            const node &child = nodes[current.children[i]];
+            float child_combined_area = combine(child.aabb, leaf_aabb).calc_surface_area();
+            child_costs[i] = (child.is_leaf() ? child_combined_area : child_combined_area - child.aabb.calc_surface_area()) + inheritance_cost;
+        }
+
+        if (cost < child_costs[0] && cost < child_costs[1])
+        {
+            break;
+        }
+
+        sibling_id = child_costs[0] < child_costs[1] ? current.children[0] : current.children[1];
+    }
+
+    // replace the sibling with a new parent of both
+    int old_parent_id = nodes[sibling_id].parent;
+    int new_parent_id = allocate_node();
+    nodes[new_parent_id].parent = old_parent_id;
+    nodes[new_parent_id].aabb = combine(leaf_aabb, nodes[sibling_id].aabb);
+    nodes[new_parent_id].height = nodes[sibling_id].height + 1;
+    nodes[new_parent_id].children[0] = sibling_id;
+    nodes[new_parent_id].children[1] = leaf_id;
+    nodes[sibling_id].parent = new_parent_id;
+    nodes[leaf_id].parent = new_parent_id;
+
+    if (old_parent_id == null_node)
+    {
+        root = new_parent_id;
+    }
+    else if (nodes[old_parent_id].children[0] == sibling_id)
+    {
+        nodes[old_parent_id].children[0] = new_parent_id;
+    }
+    else
+    {
+        nodes[old_parent_id].children[1] = new_parent_id;
+    }
+
+    refit(nodes[leaf_id].parent);
+}
+
+void liminal::aabb_tree::remove_leaf(int leaf_id)
+{
+    if (leaf_id == root)
+    {
+        root = null_node;
+        return;
+    }
+
+    // the sibling takes the parent's place
+    int parent_id = nodes[leaf_id].parent;
+    int grandparent_id = nodes[parent_id].parent;
+    int sibling_id = nodes[parent_id].children[0] == leaf_id ? nodes[parent_id].children[1] : nodes[parent_id].children[0];
+
+    if (grandparent_id == null_node)
+    {
+        root = sibling_id;
+        nodes[sibling_id].parent = null_node;
+        free_node(parent_id);
+        return;
+    }
+
+    if (nodes[grandparent_id].children[0] == parent_id)
+    {
+        nodes[grandparent_id].children[0] = sibling_id;
+    }
+    else
+    {
+        nodes[grandparent_id].children[1] = sibling_id;
+    }
+    nodes[sibling_id].parent = grandparent_id;
+    free_node(parent_id);
+
+    refit(grandparent_id);
+}
+
+int liminal::aabb_tree::balance(int a_id)
+{
+    node &a = nodes[a_id];
+    if (a.is_leaf() || a.height < 2)
+    {
+        return a_id;
+    }
+
+    // rotate the taller child up, its taller child stays with it and the other one moves under a
+    int b_id = a.children[0];
+    int c_id = a.children[1];
+    int difference = nodes[c_id].height - nodes[b_id].height;
+    if (difference >= -1 && difference <= 1)
+    {
+        return a_id;
+    }
+
+    int up_side = difference > 1 ? 1 : 0;
+    int up_id = a.children[up_side];
+    int other_id = a.children[1 - up_side];
+    node &up = nodes[up_id];
+    int f_id = up.children[0];
+    int g_id = up.children[1];
+
+    up.children[0] = a_id;
+    up.parent = a.parent;
+    a.parent = up_id;
+
+    if (up.parent == null_node)
+    {
+        root = up_id;
+    }
+    else if (nodes[up.parent].children[0] == a_id)
+    {
+        nodes[up.parent].children[0] = up_id;
+    }
+    else
+    {
+        nodes[up.parent].children[1] = up_id;
+    }
+
+    int keep_id = nodes[f_id].height > nodes[g_id].height ? f_id : g_id;
+    int move_id = keep_id == f_id ? g_id : f_id;
+
+    up.children[1] = keep_id;
+    a.children[up_side] = move_id;
+    nodes[move_id].parent = a_id;
+
+    a.aabb = combine(nodes[other_id].aabb, nodes[move_id].aabb);
+    a.height = 1 + glm::max(nodes[other_id].height, nodes[move_id].height);
+    up.aabb = combine(a.aabb, nodes[keep_id].aabb);
+    up.height = 1 + glm::max(a.height, nodes[keep_id].height);
+
+    return up_id;
+}
+
+void liminal::aabb_tree::refit(int node_id)
+{
+    // walk back up, balancing and fitting every ancestor to its children
+    while (node_id != null_node)
+    {
+        node_id = balance(node_id);
+
+        node &current = nodes[node_id];
+        const node &first = nodes[current.children[0]];
+        const node &second = nodes[current.children[1]];
+        current.aabb = combine(first.aabb, second.aabb);
+        current.height = 1 + glm::max(first.height, second.height);
+
+        node_id = current.parent;
+    }
+}
+
+void liminal::aabb_tree::report_leaves(int node_id, const std::function<void(int)> &callback) const
+{
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(node_id);
+    while (!stack.empty())
+    {
+        int current_id = stack.back();
+        stack.pop_back();
+
+        const node &current = nodes[current_id];
+        if (current.is_leaf())
+        {
+            callback(current_id);
+            continue;
+        }
+
+        stack.push_back(current.children[0]);
+        stack.push_back(current.children[1]);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef AABB_TREE_HPP
+#define AABB_TREE_HPP
+
+#include <functional>
+#include <vector>
+
+#include "bounds.hpp"
+
+namespace liminal
+{
+    // dynamic bounding volume hierarchy, in the spirit of Bullet's btDbvt and Box2D's b2DynamicTree
+    // leaves store a fattened box so small movements don't touch the tree, and the tree is kept balanced with rotations
+    class aabb_tree
+    {
+    public:
+        static const int null_node = -1;
+
+        aabb_tree(float margin = 0.1f);
+
+        int create_proxy(const liminal::aabb &aabb, void *user_data);
+        void destroy_proxy(int proxy_id);
+
+        // returns whether the proxy left its fattened box and had to be reinserted
+        bool move_proxy(int proxy_id, const liminal::aabb &aabb);
+
+        void *get_user_data(int proxy_id) const;
+        const liminal::aabb &get_fat_aabb(int proxy_id) const;
+
+        // call back with every proxy whose fattened box overlaps the volume
+        void query(const liminal::frustum &frustum, const std::function<void(int)> &callback) const;
+        void query(const liminal::bounding_sphere &sphere, const std::function<void(int)> &callback) const;
+        void query(const liminal::cone &cone, const std::function<void(int)> &callback) const;
+        void query(const liminal::aabb &aabb, const std::function<void(int)> &callback) const;
+
+        // also passes the distance along the ray to where it enters the box
+        void query(const liminal::ray &ray, const std::function<void(int, float)> &callback) const;
+
+        std::size_t size() const;
+        int get_height() const;
+
+    private:
+        struct node
+        {
+            liminal::aabb aabb;
+            void *user_data;
+            int parent; // next free node while the node is unused
+            int children[2];
+            int height; // leaves are 0, unused nodes are -1
+
+            bool is_leaf() const;
+        };
+
+        float margin;
+        std::vector<node> nodes;
+        int root;
+        int free_list;
+        std::size_t proxy_count;
+
+        int allocate_node();
+        void free_node(int node_id);
+
+        void insert_leaf(int leaf_id);
+        void remove_leaf(int leaf_id);
+        int balance(int node_id);
+        void refit(int node_id);
+
+        void report_leaves(int node_id, const std::function<void(int)> &callback) const;
+    };
+} // namespace liminal
+
+#endif
@@ -0,0 +1,363 @@
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <limits>
+#include <xmmintrin.h>
+
+liminal::aabb::aabb()
+    : min(std::numeric_limits<float>::max()),
+      max(-std::numeric_limits<float>::max())
+{
+}
+
+liminal::aabb::aabb(glm::vec3 min, glm::vec3 max)
+    : min(min),
+      max(max)
+{
+}
+
+bool liminal::aabb::is_empty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+glm::vec3 liminal::aabb::calc_center() const
+{
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 liminal::aabb::calc_extents() const
+{
+    return (max - min) * 0.5f;
+}
+
+float liminal::aabb::calc_surface_area() const
+{
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool liminal::aabb::contains(const liminal::aabb &other) const
+{
+    return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+           max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+}
+
+bool liminal::aabb::intersects(const liminal::aabb &other) const
+{
+    return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z &&
+           max.x >= other.min.x && max.y >= other.min.y && max.z >= other.min.z;
+}
+
+void liminal::aabb::expand(glm::vec3 point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void liminal::aabb::expand(const liminal::aabb &other)
+{
+    if (other.is_empty())
+    {
+        return;
+    }
+
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+liminal::aabb liminal::aabb::transform(const glm::mat4 &matrix) const
+{
+    if (is_empty())
+    {
+        return *this;
+    }
+
+    // transform the center, then project the extents onto each axis of the new space
+    glm::vec3 center = glm::vec3(matrix * glm::vec4(calc_center(), 1.0f));
+    glm::mat3 abs_matrix(
+        glm::abs(glm::vec3(matrix[0])),
+        glm::abs(glm::vec3(matrix[1])),
+        glm::abs(glm::vec3(matrix[2])));
+    glm::vec3 extents = abs_matrix * calc_extents();
+
+    return liminal::aabb(center - extents, center + extents);
+}
+
+liminal::bounding_sphere::bounding_sphere()
+    : center(0.0f),
+      radius(0.0f)
+{
+}
+
+liminal::bounding_sphere::bounding_sphere(glm::vec3 center, float radius)
+    : center(center),
+      radius(radius)
+{
+}
+
+bool liminal::bounding_sphere::intersects(const liminal::bounding_sphere &other) const
+{
+    glm::vec3 offset = other.center - center;
+    float radii = radius + other.radius;
+    return glm::dot(offset, offset) <= radii * radii;
+}
+
+bool liminal::bounding_sphere::intersects(const liminal::aabb &aabb) const
+{
+    glm::vec3 offset = glm::max(aabb.min - center, glm::max(glm::vec3(0.0f), center - aabb.max));
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+liminal::bounding_sphere liminal::bounding_sphere::transform(const glm::mat4 &matrix) const
+{
+    // non-uniform scales grow the sphere by the largest axis
+    float scale = glm::max(
+        glm::length(glm::vec3(matrix[0])),
+        glm::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+
+    return liminal::bounding_sphere(glm::vec3(matrix * glm::vec4(center, 1.0f)), radius * scale);
+}
+
+liminal::frustum::frustum()
+{
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        planes[i] = glm::vec4(0.0f);
+    }
+}
+
+liminal::frustum::frustum(const glm::mat4 &view_projection)
+{
+    // Gribb/Hartmann plane extraction, glm matrices are indexed by column first
+    glm::vec4 rows[4];
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    }
+
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+bool liminal::frustum::intersects(const liminal::aabb &aabb) const
+{
+    glm::vec3 center = aabb.calc_center();
+    glm::vec3 extents = aabb.calc_extents();
+
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        glm::vec3 normal(planes[i]);
+        float distance = glm::dot(normal, center) + planes[i].w;
+        float radius = glm::dot(glm::abs(normal), extents);
+        if (distance + radius < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool liminal::frustum::intersects(const liminal::bounding_sphere &sphere) const
+{
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool liminal::frustum::contains(const liminal::aabb &aabb) const
+{
+    glm::vec3 center = aabb.calc_center();
+    glm::vec3 extents = aabb.calc_extents();
+
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        glm::vec3 normal(planes[i]);
+        float distance = glm::dot(normal, center) + planes[i].w;
+        float radius = glm::dot(glm::abs(normal), extents);
+        if (distance - radius < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+liminal::cone::cone(glm::vec3 apex, glm::vec3 direction, float angle, float range)
+    : apex(apex),
+      direction(glm::normalize(direction)),
+      angle(angle),
+      range(range)
+{
+}
+
+bool liminal::cone::intersects(const liminal::aabb &aabb) const
+{
+    glm::vec3 offset = aabb.calc_center() - apex;
+    float radius = glm::length(aabb.calc_extents());
+
+    // distance along the axis, and from the sphere's center to the side of the cone
+    float axial_distance = glm::dot(offset, direction);
+    float lateral_distance = glm::sqrt(glm::max(glm::dot(offset, offset) - axial_distance * axial_distance, 0.0f));
+    float side_distance = cosf(angle) * lateral_distance - sinf(angle) * axial_distance;
+
+    return side_distance <= radius && axial_distance <= range + radius && axial_distance >= -radius;
+}
+
+liminal::ray::ray(glm::vec3 origin, glm::vec3 direction, float length)
+    : origin(origin),
+      direction(glm::normalize(direction)),
+      length(length)
+{
+}
+
+bool liminal::ray::intersects(const liminal::aabb &aabb, float &distance) const
+{
+    // slab test, division by a zero component gives infinities that compare correctly
+    float near_distance = 0.0f;
+    float far_distance = length;
+    for (int i = 0; i < 3; i++)
+    {
+        float inverse_direction = 1.0f / direction[i];
+        float t1 = (aabb.min[i] - origin[i]) * inverse_direction;
+        float t2 = (aabb.max[i] - origin[i]) * inverse_direction;
+        near_distance = glm::max(near_distance, glm::min(t1, t2));
+        far_distance = glm::min(far_distance, glm::max(t1, t2));
+        if (near_distance > far_distance)
+        {
+            return false;
+        }
+    }
+
+    distance = near_distance;
+    return true;
+}
+
+liminal::aabb_list::aabb_list()
+    : count(0)
+{
+}
+
+void liminal::aabb_list::clear()
+{
+    count = 0;
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    extents_x.clear();
+    extents_y.clear();
+    extents_z.clear();
+}
+
+void liminal::aabb_list::push(const liminal::aabb &aabb)
+{
+    if (count % 8 == 0)
+    {
+        std::size_t padded_size = count + 8;
+        center_x.resize(padded_size, 0.0f);
+        center_y.resize(padded_size, 0.0f);
+        center_z.resize(padded_size, 0.0f);
+        extents_x.resize(padded_size, 0.0f);
+        extents_y.resize(padded_size, 0.0f);
+        extents_z.resize(padded_size, 0.0f);
+    }
+
+    // empty boxes (meshes without vertices) become a point at the origin, they draw nothing either way
+    glm::vec3 center = aabb.is_empty() ? glm::vec3(0.0f) : aabb.calc_center();
+    glm::vec3 extents = aabb.is_empty() ? glm::vec3(0.0f) : aabb.calc_extents();
+    center_x[count] = center.x;
+    center_y[count] = center.y;
+    center_z[count] = center.z;
+    extents_x[count] = extents.x;
+    extents_y[count] = extents.y;
+    extents_z[count] = extents.z;
+    count++;
+}
+
+void liminal::aabb_list::cull(const liminal::frustum &frustum, std::vector<std::uint8_t> &visibility) const
+{
+    visibility.resize(count, 0);
+
+    // broadcast every plane once, the absolute normal projects the extents onto the plane normal
+    __m128 plane_x[6];
+    __m128 plane_y[6];
+    __m128 plane_z[6];
+    __m128 plane_w[6];
+    __m128 abs_plane_x[6];
+    __m128 abs_plane_y[6];
+    __m128 abs_plane_z[6];
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        plane_x[i] = _mm_set1_ps(frustum.planes[i].x);
+        plane_y[i] = _mm_set1_ps(frustum.planes[i].y);
+        plane_z[i] = _mm_set1_ps(frustum.planes[i].z);
+        plane_w[i] = _mm_set1_ps(frustum.planes[i].w);
+        abs_plane_x[i] = _mm_set1_ps(glm::abs(frustum.planes[i].x));
+        abs_plane_y[i] = _mm_set1_ps(glm::abs(frustum.planes[i].y));
+        abs_plane_z[i] = _mm_set1_ps(glm::abs(frustum.planes[i].z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    // eight boxes per block, as two halves of four lanes since the build doesn't enable AVX
+    for (std::size_t block = 0; block < count; block += 8)
+    {
+        int inside_mask = 0;
+        for (std::size_t half = 0; half < 8; half += 4)
+        {
+            std::size_t i = block + half;
+            __m128 cx = _mm_loadu_ps(&center_x[i]);
+            __m128 cy = _mm_loadu_ps(&center_y[i]);
+            __m128 cz = _mm_loadu_ps(&center_z[i]);
+            __m128 ex = _mm_loadu_ps(&extents_x[i]);
+            __m128 ey = _mm_loadu_ps(&extents_y[i]);
+            __m128 ez = _mm_loadu_ps(&extents_z[i]);
+
+            // a box is outside when it lies entirely behind any one plane
+            __m128 outside = zero;
+            for (unsigned int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(cx, plane_x[p]), _mm_mul_ps(cy, plane_y[p])),
+                    _mm_add_ps(_mm_mul_ps(cz, plane_z[p]), plane_w[p]));
+                __m128 radius = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(ex, abs_plane_x[p]), _mm_mul_ps(ey, abs_plane_y[p])),
+                    _mm_mul_ps(ez, abs_plane_z[p]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+
+            inside_mask |= (~_mm_movemask_ps(outside) & 0xf) << half;
+        }
+
+        std::size_t block_end = std::min(block + 8, count);
+        for (std::size_t i = block; i < block_end; i++)
+        {
+            if (inside_mask & (1 << (i - block)))
+            {
+                visibility[i] = 1;
+            }
+        }
+    }
+}
+
+std::size_t liminal::aabb_list::size() const
+{
+    return count;
+}
@@ -0,0 +1,118 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <cstdint>
+#include <glm/matrix.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+
+namespace liminal
+{
+    struct aabb
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+
+        // an empty box, expanding it by a point makes it contain only that point
+        aabb();
+        aabb(glm::vec3 min, glm::vec3 max);
+
+        bool is_empty() const;
+        glm::vec3 calc_center() const;
+        glm::vec3 calc_extents() const;
+        float calc_surface_area() const;
+
+        bool contains(const liminal::aabb &other) const;
+        bool intersects(const liminal::aabb &other) const;
+
+        void expand(glm::vec3 point);
+        void expand(const liminal::aabb &other);
+
+        // the box that contains this box after it has been transformed
+        liminal::aabb transform(const glm::mat4 &matrix) const;
+    };
+
+    struct bounding_sphere
+    {
+        glm::vec3 center;
+        float radius;
+
+        bounding_sphere();
+        bounding_sphere(glm::vec3 center, float radius);
+
+        bool intersects(const liminal::bounding_sphere &other) const;
+        bool intersects(const liminal::aabb &aabb) const;
+
+        liminal::bounding_sphere transform(const glm::mat4 &matrix) const;
+    };
+
+    struct frustum
+    {
+        // normalized planes facing inwards: left, right, bottom, top, near, far
+        glm::vec4 planes[6];
+
+        frustum();
+        explicit frustum(const glm::mat4 &view_projection);
+
+        bool intersects(const liminal::aabb &aabb) const;
+        bool intersects(const liminal::bounding_sphere &sphere) const;
+
+        // whether the box is entirely inside, so everything it contains can skip testing
+        bool contains(const liminal::aabb &aabb) const;
+    };
+
+    struct cone
+    {
+        glm::vec3 apex;
+        glm::vec3 direction;
+        float angle;
+        float range;
+
+        cone(glm::vec3 apex, glm::vec3 direction, float angle, float range);
+
+        // conservative, tests the sphere around the box
+        bool intersects(const liminal::aabb &aabb) const;
+    };
+
+    struct ray
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        float length;
+
+        ray(glm::vec3 origin, glm::vec3 direction, float length);
+
+        // distance is set to where the ray enters the box, or zero if it starts inside
+        bool intersects(const liminal::aabb &aabb, float &distance) const;
+    };
+
+    // world space boxes stored as structure of arrays so they can be tested against a frustum eight at a time
+    class aabb_list
+    {
+    public:
+        aabb_list();
+
+        void clear();
+        void push(const liminal::aabb &aabb);
+
+        // sets the visibility of every box that is at least partly inside the frustum, leaving the others untouched
+        // this lets several frustums be tested into the same visibility list
+        void cull(const liminal::frustum &frustum, std::vector<std::uint8_t> &visibility) const;
+
+        std::size_t size() const;
+
+    private:
+        std::size_t count;
+
+        // padded to a multiple of eight so the last block can be loaded whole
+        std::vector<float> center_x;
+        std::vector<float> center_y;
+        std::vector<float> center_z;
+        std::vector<float> extents_x;
+        std::vector<float> extents_y;
+        std::vector<float> extents_z;
+    };
+} // namespace liminal
+
+#endif
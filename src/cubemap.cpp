@@ -4,10 +4,12 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "gl_state.hpp"
+
 liminal::cubemap::cubemap(std::vector<std::string> filenames)
 {
     glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, texture_id);
     {
         for (unsigned int i = 0; i < 6; i++)
         {
@@ -38,10 +40,10 @@ liminal::cubemap::cubemap(std::vector<std::string> filenames)
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 }
 
 liminal::cubemap::~cubemap()
 {
-    glDeleteTextures(1, &texture_id);
+    liminal::gl_state::delete_textures(1, &texture_id);
 }
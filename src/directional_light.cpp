@@ -1,11 +1,17 @@
 #include "directional_light.hpp"
 
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 
-float liminal::directional_light::shadow_map_size = 100.0f;
-float liminal::directional_light::near_plane = -10.0f;
-float liminal::directional_light::far_plane = 100.0f;
+#include "camera.hpp"
+#include "gl_state.hpp"
+
+float liminal::directional_light::shadow_distance = 100.0f;
+float liminal::directional_light::split_lambda = 0.75f;
+float liminal::directional_light::caster_distance = 100.0f;
 
 liminal::directional_light::directional_light(
     glm::vec3 direction,
@@ -15,68 +21,57 @@ liminal::directional_light::directional_light(
       color(color)
 {
     this->depth_map_fbo_id = 0;
-    for (unsigned int i = 0; i < NUM_CASCADES; i++)
-    {
-        depth_map_texture_ids[i] = 0;
-    }
+    this->depth_map_texture_id = 0;
     set_depth_map_size(depth_map_size);
 }
 
 liminal::directional_light::~directional_light()
 {
-    glDeleteFramebuffers(1, &depth_map_fbo_id);
-    for (unsigned int i = 0; i < NUM_CASCADES; i++)
-    {
-        glDeleteTextures(1, &depth_map_texture_ids[i]);
-    }
+    liminal::gl_state::delete_framebuffers(1, &depth_map_fbo_id);
+    liminal::gl_state::delete_textures(1, &depth_map_texture_id);
 }
 
 void liminal::directional_light::set_depth_map_size(GLsizei depth_map_size)
 {
     this->depth_map_size = depth_map_size;
 
-    glDeleteFramebuffers(1, &depth_map_fbo_id);
-    for (unsigned int i = 0; i < NUM_CASCADES; i++)
-    {
-        glDeleteTextures(1, &depth_map_texture_ids[i]);
-    }
+    liminal::gl_state::delete_framebuffers(1, &depth_map_fbo_id);
+    liminal::gl_state::delete_textures(1, &depth_map_texture_id);
 
     glGenFramebuffers(1, &depth_map_fbo_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, depth_map_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, depth_map_fbo_id);
     {
         glDrawBuffer(GL_NONE);
         glReadBuffer(GL_NONE);
 
-        glGenTextures(NUM_CASCADES, depth_map_texture_ids);
-        for (unsigned int i = 0; i < NUM_CASCADES; i++)
+        glGenTextures(1, &depth_map_texture_id);
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, depth_map_texture_id);
         {
-            glBindTexture(GL_TEXTURE_2D, depth_map_texture_ids[i]);
-            {
-                glTexImage2D(
-                    GL_TEXTURE_2D,
-                    0,
-                    GL_DEPTH_COMPONENT32,
-                    depth_map_size,
-                    depth_map_size,
-                    0,
-                    GL_DEPTH_COMPONENT,
-                    GL_FLOAT,
-                    nullptr);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-                GLfloat border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
-                glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border_color);
-            }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            glTexImage3D(
+                GL_TEXTURE_2D_ARRAY,
+                0,
+                GL_DEPTH_COMPONENT32F,
+                depth_map_size,
+                depth_map_size,
+                NUM_CASCADES,
+                0,
+                GL_DEPTH_COMPONENT,
+                GL_FLOAT,
+                nullptr);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            GLfloat border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
+            glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
         }
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, 0);
 
-        glFramebufferTexture2D(
+        // layered, every cascade is drawn in one pass
+        glFramebufferTexture(
             GL_FRAMEBUFFER,
             GL_DEPTH_ATTACHMENT,
-            GL_TEXTURE_2D,
-            depth_map_texture_ids[0],
+            depth_map_texture_id,
             0);
 
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -85,16 +80,70 @@ void liminal::directional_light::set_depth_map_size(GLsizei depth_map_size)
             return;
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void liminal::directional_light::update_transformation_matrix(glm::vec3 center)
+void liminal::directional_light::update_transformation_matrices(const glm::mat4 &camera_view_projection, float shadow_near, float shadow_far)
 {
-    glm::mat4 projection = glm::ortho(-shadow_map_size, shadow_map_size, -shadow_map_size, shadow_map_size, near_plane, far_plane);
-    glm::mat4 view = glm::lookAt(
-        center - direction,
-        center,
-        glm::vec3(0.0f, 1.0f, 0.0f));
+    // corners of the whole camera frustum, the near plane's first
+    glm::mat4 inverse_view_projection = glm::inverse(camera_view_projection);
+    glm::vec3 corners[8];
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        glm::vec4 ndc(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+        glm::vec4 corner = inverse_view_projection * ndc;
+        corners[i] = glm::vec3(corner) / corner.w;
+    }
+
+    // the rotation only depends on the direction, so a cascade following the camera only translates, and can be snapped to its texels
+    glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), direction, up);
 
-    transformation_matrix = projection * view;
+    float split_near = shadow_near;
+    for (unsigned int i = 0; i < NUM_CASCADES; i++)
+    {
+        // practical split scheme
+        float fraction = (float)(i + 1) / (float)NUM_CASCADES;
+        float log_split = shadow_near * powf(shadow_far / shadow_near, fraction);
+        float uniform_split = shadow_near + (shadow_far - shadow_near) * fraction;
+        float split_far = split_lambda * log_split + (1.0f - split_lambda) * uniform_split;
+
+        // the slice's corners are on the frustum's edges, along which the distance from the camera changes linearly
+        float t_near = (split_near - camera::near_plane) / (camera::far_plane - camera::near_plane);
+        float t_far = (split_far - camera::near_plane) / (camera::far_plane - camera::near_plane);
+        glm::vec3 slice[8];
+        glm::vec3 center(0.0f);
+        for (unsigned int j = 0; j < 4; j++)
+        {
+            slice[j] = glm::mix(corners[j], corners[j + 4], t_near);
+            slice[j + 4] = glm::mix(corners[j], corners[j + 4], t_far);
+            center += slice[j] + slice[j + 4];
+        }
+        center /= 8.0f;
+
+        // a sphere around the slice keeps the same size as the camera turns, a tight box would make the shadows shimmer
+        float radius = 0.0f;
+        for (unsigned int j = 0; j < 8; j++)
+        {
+            radius = glm::max(radius, glm::length(slice[j] - center));
+        }
+        radius = ceilf(radius * 16.0f) / 16.0f;
+
+        // move in whole texels only
+        float texel_size = 2.0f * radius / (float)depth_map_size;
+        glm::vec3 light_center = glm::vec3(view * glm::vec4(center, 1.0f));
+        light_center.x = floorf(light_center.x / texel_size) * texel_size;
+        light_center.y = floorf(light_center.y / texel_size) * texel_size;
+
+        // the light looks down -z, casters in front of the near plane are clamped onto it when drawn
+        float left = light_center.x - radius;
+        float right = light_center.x + radius;
+        float bottom = light_center.y - radius;
+        float top = light_center.y + radius;
+        float distance = -light_center.z;
+        transformation_matrices[i] = glm::ortho(left, right, bottom, top, distance - radius, distance + radius) * view;
+        caster_matrices[i] = glm::ortho(left, right, bottom, top, distance - radius - caster_distance, distance + radius) * view;
+
+        split_near = split_far;
+    }
 }
@@ -5,22 +5,27 @@
 #include <glm/vec3.hpp>
 #include <GL/glew.h>
 
-#define NUM_CASCADES 1
+// must match assets/shaders/glsl/lights.glsl
+#define NUM_CASCADES 4
 
 namespace liminal
 {
     struct directional_light
     {
-        static float shadow_map_size;
-        static float near_plane;
-        static float far_plane;
+        // shadows reach this far from the camera, split into cascades that get longer with distance
+        static float shadow_distance;
+        // blends evenly spaced splits (0) with logarithmic ones (1)
+        static float split_lambda;
+        // casters this far toward the light from a cascade are still drawn into it
+        static float caster_distance;
 
         glm::vec3 direction;
         glm::vec3 color;
         GLsizei depth_map_size;
         GLuint depth_map_fbo_id;
-        GLuint depth_map_texture_ids[NUM_CASCADES];
-        glm::mat4 transformation_matrix;
+        GLuint depth_map_texture_id; // an array with a layer per cascade
+        glm::mat4 transformation_matrices[NUM_CASCADES];
+        glm::mat4 caster_matrices[NUM_CASCADES]; // the same boxes stretched toward the light, to cull casters with
 
         directional_light(
             glm::vec3 direction,
@@ -30,7 +35,8 @@ namespace liminal
 
         void set_depth_map_size(GLsizei depth_map_size);
 
-        void update_transformation_matrix(glm::vec3 center);
+        // fits a cascade around each slice of the camera frustum between the two distances along the view
+        void update_transformation_matrices(const glm::mat4 &camera_view_projection, float shadow_near, float shadow_far);
     };
 } // namespace liminal
 
@@ -0,0 +1,99 @@
+#include "frame_governor.hpp"
+
+// how far under the target the average has to be to try a better level
+// each level is around 20% cheaper than the one above, so this leaves room for the one above to fit
+static const float raise_threshold = 0.75f;
+// how far over the target the average can be before dropping a level, so noise around the target doesn't count
+static const float drop_threshold = 1.05f;
+// weight of each new frame in the average
+static const float average_weight = 0.1f;
+
+liminal::frame_governor::frame_governor(float target_frame_time)
+    : enabled(false),
+      target_frame_time(target_frame_time),
+      level_index(0),
+      average_frame_time(0.0f),
+      over_frames(0),
+      under_frames(0),
+      settle_frames(0)
+{
+    // the cheapest settings to lose go first, shadows and reflections are mostly off screen or far away
+    levels.push_back({1.0f, 1.0f, 1.0f});
+    levels.push_back({1.0f, 0.75f, 0.5f});
+    levels.push_back({0.9f, 0.5f, 0.5f});
+    levels.push_back({0.8f, 0.5f, 0.5f});
+    levels.push_back({0.7f, 0.5f, 0.25f});
+    levels.push_back({0.6f, 0.5f, 0.25f});
+    levels.push_back({0.5f, 0.5f, 0.25f});
+}
+
+bool liminal::frame_governor::update(float gpu_frame_time)
+{
+    // turning it off gives back everything it took
+    if (!enabled)
+    {
+        if (level_index == 0)
+        {
+            return false;
+        }
+        set_level_index(0);
+        return true;
+    }
+
+    if (gpu_frame_time <= 0.0f)
+    {
+        return false;
+    }
+
+    if (settle_frames > 0)
+    {
+        settle_frames--;
+        average_frame_time = gpu_frame_time;
+        return false;
+    }
+
+    average_frame_time = average_frame_time > 0.0f ? average_frame_time + (gpu_frame_time - average_frame_time) * average_weight : gpu_frame_time;
+
+    over_frames = average_frame_time > target_frame_time * drop_threshold ? over_frames + 1 : 0;
+    under_frames = average_frame_time < target_frame_time * raise_threshold ? under_frames + 1 : 0;
+
+    if (over_frames >= GOVERNOR_DROP_FRAMES && level_index + 1 < levels.size())
+    {
+        set_level_index(level_index + 1);
+        return true;
+    }
+    if (under_frames >= GOVERNOR_RAISE_FRAMES && level_index > 0)
+    {
+        set_level_index(level_index - 1);
+        return true;
+    }
+    return false;
+}
+
+const liminal::frame_governor::level &liminal::frame_governor::get_level() const
+{
+    return levels[level_index];
+}
+
+std::size_t liminal::frame_governor::get_level_index() const
+{
+    return level_index;
+}
+
+std::size_t liminal::frame_governor::get_num_levels() const
+{
+    return levels.size();
+}
+
+float liminal::frame_governor::get_average_frame_time() const
+{
+    return average_frame_time;
+}
+
+void liminal::frame_governor::set_level_index(std::size_t level_index)
+{
+    this->level_index = level_index;
+    over_frames = 0;
+    under_frames = 0;
+    settle_frames = GOVERNOR_SETTLE_FRAMES;
+}
@@ -0,0 +1,55 @@
+#ifndef FRAME_GOVERNOR_HPP
+#define FRAME_GOVERNOR_HPP
+
+#include <cstddef>
+#include <vector>
+
+// frames the average has to stay over the target before dropping a level, and under it before raising one
+// raising waits longer, so a level that barely fits isn't dropped and raised over and over
+#define GOVERNOR_DROP_FRAMES 15
+#define GOVERNOR_RAISE_FRAMES 120
+// frames ignored after a change, while the timers still hold frames drawn at the old level
+#define GOVERNOR_SETTLE_FRAMES 10
+
+namespace liminal
+{
+    // picks how much of the renderer's quality to give up to keep the gpu within a frame time
+    // fed the gpu time of each frame, it steps down a ladder of levels when over budget, and back up when well under it
+    class frame_governor
+    {
+    public:
+        // fractions of the configured settings, the first level is all of them
+        struct level
+        {
+            float render_scale;
+            float reflection_scale;
+            float shadow_scale;
+        };
+
+        bool enabled;
+        float target_frame_time; // milliseconds
+
+        explicit frame_governor(float target_frame_time);
+
+        // returns whether the level changed
+        bool update(float gpu_frame_time);
+
+        const liminal::frame_governor::level &get_level() const;
+        std::size_t get_level_index() const;
+        std::size_t get_num_levels() const;
+        float get_average_frame_time() const;
+
+    private:
+        std::vector<liminal::frame_governor::level> levels;
+        std::size_t level_index;
+
+        float average_frame_time;
+        unsigned int over_frames;
+        unsigned int under_frames;
+        unsigned int settle_frames;
+
+        void set_level_index(std::size_t level_index);
+    };
+} // namespace liminal
+
+#endif
@@ -0,0 +1,195 @@
+#include "geometry_pool.hpp"
+
+#include <algorithm>
+
+#include "gl_state.hpp"
+
+liminal::geometry_pool::geometry_pool(GLsizei vertex_capacity, GLsizei index_capacity)
+    : vertex_capacity(vertex_capacity),
+      index_capacity(index_capacity)
+{
+    glGenBuffers(1, &vbo_id);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+    glBufferData(GL_ARRAY_BUFFER, vertex_capacity * sizeof(liminal::vertex), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &ebo_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glGenVertexArrays(1, &vao_id);
+    setup_vertex_array();
+
+    free_vertex_ranges.push_back({0, vertex_capacity});
+    free_index_ranges.push_back({0, index_capacity});
+}
+
+liminal::geometry_pool::~geometry_pool()
+{
+    liminal::gl_state::delete_vertex_arrays(1, &vao_id);
+    glDeleteBuffers(1, &vbo_id);
+    glDeleteBuffers(1, &ebo_id);
+}
+
+GLuint liminal::geometry_pool::get_vao_id() const
+{
+    return vao_id;
+}
+
+liminal::geometry_pool::allocation liminal::geometry_pool::allocate(const std::vector<liminal::vertex> &vertices, const std::vector<GLuint> &indices)
+{
+    GLsizei vertex_count = (GLsizei)vertices.size();
+    GLsizei index_count = (GLsizei)indices.size();
+
+    // double the buffers until the allocation fits, copying the existing geometry over
+    GLsizei vertex_offset;
+    while (!allocate_range(free_vertex_ranges, vertex_count, vertex_offset))
+    {
+        GLsizei new_vertex_capacity = std::max(vertex_capacity * 2, vertex_capacity + vertex_count);
+        vbo_id = grow_buffer(vbo_id, vertex_capacity * sizeof(liminal::vertex), new_vertex_capacity * sizeof(liminal::vertex));
+        free_range(free_vertex_ranges, vertex_capacity, new_vertex_capacity - vertex_capacity);
+        vertex_capacity = new_vertex_capacity;
+        setup_vertex_array();
+    }
+
+    GLsizei index_offset;
+    while (!allocate_range(free_index_ranges, index_count, index_offset))
+    {
+        GLsizei new_index_capacity = std::max(index_capacity * 2, index_capacity + index_count);
+        ebo_id = grow_buffer(ebo_id, index_capacity * sizeof(GLuint), new_index_capacity * sizeof(GLuint));
+        free_range(free_index_ranges, index_capacity, new_index_capacity - index_capacity);
+        index_capacity = new_index_capacity;
+        setup_vertex_array();
+    }
+
+    // upload through the copy target so the element buffer binding of whatever VAO is bound isn't touched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertex_offset * sizeof(liminal::vertex), vertex_count * sizeof(liminal::vertex), vertices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset * sizeof(GLuint), index_count * sizeof(GLuint), indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    liminal::geometry_pool::allocation allocation;
+    allocation.base_vertex = vertex_offset;
+    allocation.first_index = (GLuint)index_offset;
+    allocation.vertex_count = vertex_count;
+    allocation.index_count = index_count;
+    return allocation;
+}
+
+void liminal::geometry_pool::free(const liminal::geometry_pool::allocation &allocation)
+{
+    free_range(free_vertex_ranges, allocation.base_vertex, allocation.vertex_count);
+    free_range(free_index_ranges, (GLsizei)allocation.first_index, allocation.index_count);
+}
+
+bool liminal::geometry_pool::allocate_range(std::vector<range> &free_ranges, GLsizei size, GLsizei &offset)
+{
+    if (size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+
+    // first fit
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); it++)
+    {
+        if (it->size >= size)
+        {
+            offset = it->offset;
+
+            it->offset += size;
+            it->size -= size;
+            if (it->size == 0)
+            {
+                free_ranges.erase(it);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void liminal::geometry_pool::free_range(std::vector<range> &free_ranges, GLsizei offset, GLsizei size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    auto it = std::lower_bound(
+        free_ranges.begin(),
+        free_ranges.end(),
+        offset,
+        [](const range &free_range, GLsizei offset) {
+            return free_range.offset < offset;
+        });
+    it = free_ranges.insert(it, {offset, size});
+
+    // merge with the next range
+    auto next = it + 1;
+    if (next != free_ranges.end() && it->offset + it->size == next->offset)
+    {
+        it->size += next->size;
+        free_ranges.erase(next);
+    }
+
+    // merge with the previous range
+    if (it != free_ranges.begin())
+    {
+        auto previous = it - 1;
+        if (previous->offset + previous->size == it->offset)
+        {
+            previous->size += it->size;
+            free_ranges.erase(it);
+        }
+    }
+}
+
+GLuint liminal::geometry_pool::grow_buffer(GLuint buffer_id, GLsizeiptr size, GLsizeiptr new_size)
+{
+    GLuint new_buffer_id;
+    glGenBuffers(1, &new_buffer_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer_id);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &buffer_id);
+
+    return new_buffer_id;
+}
+
+void liminal::geometry_pool::setup_vertex_array()
+{
+    liminal::gl_state::bind_vertex_array(vao_id);
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_id);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, uv));
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, tangent));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, bitangent));
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, bone_ids));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, bone_weights));
+
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+        glEnableVertexAttribArray(5);
+        glEnableVertexAttribArray(6);
+    }
+    liminal::gl_state::bind_vertex_array(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
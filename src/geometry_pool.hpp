@@ -0,0 +1,57 @@
+#ifndef GEOMETRY_POOL_HPP
+#define GEOMETRY_POOL_HPP
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "vertex.hpp"
+
+namespace liminal
+{
+    // sub-allocates the vertices and indices of every mesh out of one large vertex buffer and one large index buffer
+    // all meshes share the pool's VAO, so draws only differ by their offsets and can be batched into indirect draws
+    class geometry_pool
+    {
+    public:
+        struct allocation
+        {
+            GLint base_vertex;
+            GLuint first_index;
+            GLsizei vertex_count;
+            GLsizei index_count;
+        };
+
+        geometry_pool(GLsizei vertex_capacity, GLsizei index_capacity);
+        ~geometry_pool();
+
+        GLuint get_vao_id() const;
+
+        liminal::geometry_pool::allocation allocate(const std::vector<liminal::vertex> &vertices, const std::vector<GLuint> &indices);
+        void free(const liminal::geometry_pool::allocation &allocation);
+
+    private:
+        struct range
+        {
+            GLsizei offset;
+            GLsizei size;
+        };
+
+        GLuint vao_id;
+        GLuint vbo_id;
+        GLuint ebo_id;
+        GLsizei vertex_capacity;
+        GLsizei index_capacity;
+
+        // free ranges are kept sorted by offset so neighbours can be merged when freed
+        std::vector<range> free_vertex_ranges;
+        std::vector<range> free_index_ranges;
+
+        static bool allocate_range(std::vector<range> &free_ranges, GLsizei size, GLsizei &offset);
+        static void free_range(std::vector<range> &free_ranges, GLsizei offset, GLsizei size);
+        static GLuint grow_buffer(GLuint buffer_id, GLsizeiptr size, GLsizeiptr new_size);
+
+        void setup_vertex_array();
+    };
+} // namespace liminal
+
+#endif
@@ -0,0 +1,335 @@
+#include "gl_state.hpp"
+
+#include <unordered_map>
+
+// a name or enum GL never hands out, so state holding it is unknown and the next call always goes through
+static const GLuint unknown = 0xffffffff;
+
+// texture units and targets that are tracked, binds outside of them always go through
+static const unsigned int num_texture_units = 32;
+static const GLenum texture_targets[] = {GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D};
+static const unsigned int num_texture_targets = sizeof(texture_targets) / sizeof(texture_targets[0]);
+
+struct state_data
+{
+    GLuint program_id;
+    GLuint vao_id;
+    GLenum active_unit;
+    GLuint texture_ids[num_texture_units][num_texture_targets];
+    GLuint read_fbo_id;
+    GLuint draw_fbo_id;
+    GLint viewport[4];
+    GLint scissor[4];
+    std::unordered_map<GLenum, bool> capabilities; // missing ones are unknown
+    GLenum depth_func;
+    GLuint depth_mask;
+    GLenum blend_source_factor;
+    GLenum blend_destination_factor;
+    GLenum polygon_mode;
+    GLenum cull_face;
+    liminal::gl_state::counters counters;
+};
+
+static state_data make_unknown_state()
+{
+    state_data state;
+    state.program_id = unknown;
+    state.vao_id = unknown;
+    state.active_unit = unknown;
+    for (unsigned int i = 0; i < num_texture_units; i++)
+    {
+        for (unsigned int j = 0; j < num_texture_targets; j++)
+        {
+            state.texture_ids[i][j] = unknown;
+        }
+    }
+    state.read_fbo_id = unknown;
+    state.draw_fbo_id = unknown;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        state.viewport[i] = -1;
+        state.scissor[i] = -1;
+    }
+    state.depth_func = unknown;
+    state.depth_mask = unknown;
+    state.blend_source_factor = unknown;
+    state.blend_destination_factor = unknown;
+    state.polygon_mode = unknown;
+    state.cull_face = unknown;
+    state.counters = {0, 0};
+    return state;
+}
+
+static state_data state = make_unknown_state();
+
+// counts the call either way, returns whether it has to be issued
+static bool changes(bool different)
+{
+    if (different)
+    {
+        state.counters.issued++;
+    }
+    else
+    {
+        state.counters.elided++;
+    }
+    return different;
+}
+
+static int get_target_index(GLenum target)
+{
+    for (unsigned int i = 0; i < num_texture_targets; i++)
+    {
+        if (texture_targets[i] == target)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void liminal::gl_state::use_program(GLuint program_id)
+{
+    if (changes(state.program_id != program_id))
+    {
+        glUseProgram(program_id);
+        state.program_id = program_id;
+    }
+}
+
+void liminal::gl_state::bind_vertex_array(GLuint vao_id)
+{
+    if (changes(state.vao_id != vao_id))
+    {
+        glBindVertexArray(vao_id);
+        state.vao_id = vao_id;
+    }
+}
+
+void liminal::gl_state::active_texture(GLenum unit)
+{
+    if (changes(state.active_unit != unit))
+    {
+        glActiveTexture(unit);
+        state.active_unit = unit;
+    }
+}
+
+void liminal::gl_state::bind_texture(GLenum target, GLuint texture_id)
+{
+    int target_index = get_target_index(target);
+    GLuint unit_index = state.active_unit - GL_TEXTURE0;
+    if (state.active_unit == unknown || unit_index >= num_texture_units || target_index < 0)
+    {
+        changes(true);
+        glBindTexture(target, texture_id);
+        return;
+    }
+
+    GLuint &bound_id = state.texture_ids[unit_index][target_index];
+    if (changes(bound_id != texture_id))
+    {
+        glBindTexture(target, texture_id);
+        bound_id = texture_id;
+    }
+}
+
+void liminal::gl_state::bind_framebuffer(GLenum target, GLuint fbo_id)
+{
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    if (changes((read && state.read_fbo_id != fbo_id) || (draw && state.draw_fbo_id != fbo_id)))
+    {
+        glBindFramebuffer(target, fbo_id);
+        if (read)
+        {
+            state.read_fbo_id = fbo_id;
+        }
+        if (draw)
+        {
+            state.draw_fbo_id = fbo_id;
+        }
+    }
+}
+
+void liminal::gl_state::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (changes(state.viewport[0] != x || state.viewport[1] != y || state.viewport[2] != width || state.viewport[3] != height))
+    {
+        glViewport(x, y, width, height);
+        state.viewport[0] = x;
+        state.viewport[1] = y;
+        state.viewport[2] = width;
+        state.viewport[3] = height;
+    }
+}
+
+void liminal::gl_state::scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (changes(state.scissor[0] != x || state.scissor[1] != y || state.scissor[2] != width || state.scissor[3] != height))
+    {
+        glScissor(x, y, width, height);
+        state.scissor[0] = x;
+        state.scissor[1] = y;
+        state.scissor[2] = width;
+        state.scissor[3] = height;
+    }
+}
+
+void liminal::gl_state::enable(GLenum capability)
+{
+    auto it = state.capabilities.find(capability);
+    if (changes(it == state.capabilities.end() || !it->second))
+    {
+        glEnable(capability);
+        state.capabilities[capability] = true;
+    }
+}
+
+void liminal::gl_state::disable(GLenum capability)
+{
+    auto it = state.capabilities.find(capability);
+    if (changes(it == state.capabilities.end() || it->second))
+    {
+        glDisable(capability);
+        state.capabilities[capability] = false;
+    }
+}
+
+void liminal::gl_state::depth_func(GLenum func)
+{
+    if (changes(state.depth_func != func))
+    {
+        glDepthFunc(func);
+        state.depth_func = func;
+    }
+}
+
+void liminal::gl_state::depth_mask(GLboolean flag)
+{
+    if (changes(state.depth_mask != flag))
+    {
+        glDepthMask(flag);
+        state.depth_mask = flag;
+    }
+}
+
+void liminal::gl_state::blend_func(GLenum source_factor, GLenum destination_factor)
+{
+    if (changes(state.blend_source_factor != source_factor || state.blend_destination_factor != destination_factor))
+    {
+        glBlendFunc(source_factor, destination_factor);
+        state.blend_source_factor = source_factor;
+        state.blend_destination_factor = destination_factor;
+    }
+}
+
+void liminal::gl_state::polygon_mode(GLenum face, GLenum mode)
+{
+    // the core profile only has GL_FRONT_AND_BACK, anything else isn't tracked
+    if (face != GL_FRONT_AND_BACK)
+    {
+        changes(true);
+        glPolygonMode(face, mode);
+        state.polygon_mode = unknown;
+        return;
+    }
+
+    if (changes(state.polygon_mode != mode))
+    {
+        glPolygonMode(face, mode);
+        state.polygon_mode = mode;
+    }
+}
+
+void liminal::gl_state::cull_face(GLenum mode)
+{
+    if (changes(state.cull_face != mode))
+    {
+        glCullFace(mode);
+        state.cull_face = mode;
+    }
+}
+
+void liminal::gl_state::delete_program(GLuint program_id)
+{
+    // a deleted program stays in use until another one is, don't assume anything about it
+    glDeleteProgram(program_id);
+    if (state.program_id == program_id)
+    {
+        state.program_id = unknown;
+    }
+}
+
+void liminal::gl_state::delete_vertex_arrays(GLsizei n, const GLuint *vao_ids)
+{
+    glDeleteVertexArrays(n, vao_ids);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        if (vao_ids[i] != 0 && state.vao_id == vao_ids[i])
+        {
+            state.vao_id = 0;
+        }
+    }
+}
+
+void liminal::gl_state::delete_textures(GLsizei n, const GLuint *texture_ids)
+{
+    glDeleteTextures(n, texture_ids);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        if (texture_ids[i] == 0)
+        {
+            continue;
+        }
+
+        for (unsigned int j = 0; j < num_texture_units; j++)
+        {
+            for (unsigned int k = 0; k < num_texture_targets; k++)
+            {
+                if (state.texture_ids[j][k] == texture_ids[i])
+                {
+                    state.texture_ids[j][k] = 0;
+                }
+            }
+        }
+    }
+}
+
+void liminal::gl_state::delete_framebuffers(GLsizei n, const GLuint *fbo_ids)
+{
+    glDeleteFramebuffers(n, fbo_ids);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        if (fbo_ids[i] == 0)
+        {
+            continue;
+        }
+
+        if (state.read_fbo_id == fbo_ids[i])
+        {
+            state.read_fbo_id = 0;
+        }
+        if (state.draw_fbo_id == fbo_ids[i])
+        {
+            state.draw_fbo_id = 0;
+        }
+    }
+}
+
+void liminal::gl_state::invalidate()
+{
+    liminal::gl_state::counters counters = state.counters;
+    state = make_unknown_state();
+    state.counters = counters;
+}
+
+liminal::gl_state::counters liminal::gl_state::get_counters()
+{
+    return state.counters;
+}
+
+void liminal::gl_state::reset_counters()
+{
+    state.counters = {0, 0};
+}
@@ -0,0 +1,54 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <GL/glew.h>
+
+namespace liminal
+{
+    // shadows the GL state the engine changes, and skips any call that wouldn't change it
+    // every bind, toggle and delete of the tracked state has to go through here, or the shadow goes stale
+    // code that can't (third party libraries) has to restore what it changed, or call invalidate afterwards
+    namespace gl_state
+    {
+        struct counters
+        {
+            unsigned int issued;
+            unsigned int elided;
+        };
+
+        void use_program(GLuint program_id);
+        void bind_vertex_array(GLuint vao_id);
+
+        // binds to the active unit, like glBindTexture
+        void active_texture(GLenum unit);
+        void bind_texture(GLenum target, GLuint texture_id);
+
+        // GL_FRAMEBUFFER sets both the read and draw framebuffer
+        void bind_framebuffer(GLenum target, GLuint fbo_id);
+        void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+        void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        void enable(GLenum capability);
+        void disable(GLenum capability);
+        void depth_func(GLenum func);
+        void depth_mask(GLboolean flag);
+        void blend_func(GLenum source_factor, GLenum destination_factor);
+        void polygon_mode(GLenum face, GLenum mode);
+        void cull_face(GLenum mode);
+
+        // deleting unbinds the objects, and their names can be handed out again
+        void delete_program(GLuint program_id);
+        void delete_vertex_arrays(GLsizei n, const GLuint *vao_ids);
+        void delete_textures(GLsizei n, const GLuint *texture_ids);
+        void delete_framebuffers(GLsizei n, const GLuint *fbo_ids);
+
+        // forget everything, the next call of each kind is always issued
+        void invalidate();
+
+        // calls issued and skipped since the last reset
+        liminal::gl_state::counters get_counters();
+        void reset_counters();
+    } // namespace gl_state
+} // namespace liminal
+
+#endif
@@ -0,0 +1,183 @@
+#include "gpu_profiler.hpp"
+
+#include <iostream>
+
+liminal::gpu_profiler::gpu_profiler()
+    : frame_number(0),
+      history(GPU_PROFILER_HISTORY, 0.0f),
+      history_offset(0)
+{
+    for (unsigned int i = 0; i < GPU_PROFILER_LATENCY; i++)
+    {
+        frames[i].frame_number = 0;
+        frames[i].pending = false;
+    }
+}
+
+liminal::gpu_profiler::~gpu_profiler()
+{
+    for (unsigned int i = 0; i < GPU_PROFILER_LATENCY; i++)
+    {
+        if (!frames[i].query_ids.empty())
+        {
+            glDeleteQueries((GLsizei)frames[i].query_ids.size(), frames[i].query_ids.data());
+        }
+    }
+}
+
+void liminal::gpu_profiler::begin_frame()
+{
+    // the frame about to reuse these queries was recorded GPU_PROFILER_LATENCY frames ago
+    liminal::gpu_profiler::frame &frame = frames[frame_number % GPU_PROFILER_LATENCY];
+    if (frame.pending)
+    {
+        read_frame(frame);
+    }
+
+    frame.frame_number = frame_number;
+    frame.pending = false;
+    frame.sections.clear();
+    open_sections.clear();
+
+    begin("frame");
+}
+
+void liminal::gpu_profiler::end_frame()
+{
+    end();
+
+    // sections left open don't have an end time
+    liminal::gpu_profiler::frame &frame = frames[frame_number % GPU_PROFILER_LATENCY];
+    if (open_sections.empty())
+    {
+        frame.pending = true;
+    }
+    else
+    {
+        std::cerr << "Error: GPU profiler section " << frame.sections[open_sections.back()].name << " was never ended" << std::endl;
+    }
+
+    frame_number++;
+}
+
+void liminal::gpu_profiler::begin(const char *name, int index)
+{
+    liminal::gpu_profiler::frame &frame = frames[frame_number % GPU_PROFILER_LATENCY];
+
+    std::size_t section_index = frame.sections.size();
+    if (frame.query_ids.size() < (section_index + 1) * 2)
+    {
+        GLuint query_ids[2];
+        glGenQueries(2, query_ids);
+        frame.query_ids.push_back(query_ids[0]);
+        frame.query_ids.push_back(query_ids[1]);
+    }
+
+    frame.sections.push_back({name, index, (unsigned int)open_sections.size()});
+    open_sections.push_back(section_index);
+
+    glQueryCounter(frame.query_ids[section_index * 2], GL_TIMESTAMP);
+}
+
+void liminal::gpu_profiler::end()
+{
+    if (open_sections.empty())
+    {
+        std::cerr << "Error: GPU profiler section ended without one being begun" << std::endl;
+        return;
+    }
+
+    liminal::gpu_profiler::frame &frame = frames[frame_number % GPU_PROFILER_LATENCY];
+    std::size_t index = open_sections.back();
+    open_sections.pop_back();
+
+    glQueryCounter(frame.query_ids[index * 2 + 1], GL_TIMESTAMP);
+}
+
+const std::vector<liminal::gpu_profiler::section> &liminal::gpu_profiler::get_sections() const
+{
+    return sections;
+}
+
+float liminal::gpu_profiler::get_frame_time() const
+{
+    return sections.empty() ? 0.0f : sections[0].time;
+}
+
+const std::vector<float> &liminal::gpu_profiler::get_history() const
+{
+    return history;
+}
+
+std::size_t liminal::gpu_profiler::get_history_offset() const
+{
+    return history_offset;
+}
+
+bool liminal::gpu_profiler::start_capture(const std::string &filename)
+{
+    stop_capture();
+
+    capture.open(filename);
+    if (!capture)
+    {
+        std::cerr << "Error: Failed to open GPU profiler capture: " << filename << std::endl;
+        return false;
+    }
+
+    capture << "frame,section,index,depth,start_ms,time_ms" << std::endl;
+    return true;
+}
+
+void liminal::gpu_profiler::stop_capture()
+{
+    if (capture.is_open())
+    {
+        capture.close();
+    }
+}
+
+bool liminal::gpu_profiler::is_capturing() const
+{
+    return capture.is_open();
+}
+
+void liminal::gpu_profiler::read_frame(liminal::gpu_profiler::frame &frame)
+{
+    // timestamps are written in order, so once the frame's end is there every other one is too
+    GLuint available;
+    glGetQueryObjectuiv(frame.query_ids[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        return;
+    }
+
+    std::vector<GLuint64> timestamps(frame.sections.size() * 2);
+    for (std::size_t i = 0; i < timestamps.size(); i++)
+    {
+        glGetQueryObjectui64v(frame.query_ids[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    sections.clear();
+    for (std::size_t i = 0; i < frame.sections.size(); i++)
+    {
+        liminal::gpu_profiler::section section;
+        section.name = frame.sections[i].name;
+        section.index = frame.sections[i].index;
+        section.depth = frame.sections[i].depth;
+        section.start_time = (float)(timestamps[i * 2] - timestamps[0]) / 1000000.0f;
+        section.time = (float)(timestamps[i * 2 + 1] - timestamps[i * 2]) / 1000000.0f;
+        sections.push_back(section);
+    }
+
+    history[history_offset] = get_frame_time();
+    history_offset = (history_offset + 1) % history.size();
+
+    if (capture.is_open())
+    {
+        for (auto &section : sections)
+        {
+            capture << frame.frame_number << "," << section.name << "," << section.index << "," << section.depth << "," << section.start_time << "," << section.time << "\n";
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+// frames a frame's timers are read back after, so reading them never waits on the gpu
+#define GPU_PROFILER_LATENCY 4
+// frame times kept for the history graph
+#define GPU_PROFILER_HISTORY 240
+
+namespace liminal
+{
+    // times nested sections of each frame on the gpu with timestamp queries
+    // results come back a few frames late, frames whose timers still aren't done by then are dropped
+    class gpu_profiler
+    {
+    public:
+        struct section
+        {
+            const char *name;
+            int index; // which of several sections with the same name, -1 when there's only one
+            unsigned int depth; // the frame itself is 0
+            float start_time; // milliseconds since the frame started
+            float time; // milliseconds
+        };
+
+        gpu_profiler();
+        ~gpu_profiler();
+
+        // the frame is the outermost section, every other one has to be inside it
+        void begin_frame();
+        void end_frame();
+        // names are kept by pointer until the frame is read back, so they have to be string literals
+        void begin(const char *name, int index = -1);
+        void end();
+
+        // sections of the latest frame that came back, in the order they began
+        const std::vector<liminal::gpu_profiler::section> &get_sections() const;
+        float get_frame_time() const;
+
+        // oldest first starting at the offset, wrapping around
+        const std::vector<float> &get_history() const;
+        std::size_t get_history_offset() const;
+
+        // writes every section of every frame that comes back from now on, one row each
+        bool start_capture(const std::string &filename);
+        void stop_capture();
+        bool is_capturing() const;
+
+    private:
+        struct pending_section
+        {
+            const char *name;
+            int index;
+            unsigned int depth;
+        };
+
+        struct frame
+        {
+            unsigned int frame_number;
+            bool pending;
+            std::vector<liminal::gpu_profiler::pending_section> sections;
+            // the start and end timestamp of each section, only ever grows
+            std::vector<GLuint> query_ids;
+        };
+
+        liminal::gpu_profiler::frame frames[GPU_PROFILER_LATENCY];
+        unsigned int frame_number;
+        std::vector<std::size_t> open_sections;
+
+        std::vector<liminal::gpu_profiler::section> sections;
+        std::vector<float> history;
+        std::size_t history_offset;
+
+        std::ofstream capture;
+
+        void read_frame(liminal::gpu_profiler::frame &frame);
+    };
+} // namespace liminal
+
+#endif
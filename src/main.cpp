@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <bullet/btBulletDynamicsCommon.h>
+#include <cstdio>
 #include <cxxopts.hpp>
 #include <iostream>
 #include <imgui.h>
@@ -12,6 +14,8 @@
 #include "audio.hpp"
 #include "directional_light.hpp"
 #include "camera.hpp"
+#include "frame_governor.hpp"
+#include "gl_state.hpp"
 #include "model.hpp"
 #include "object.hpp"
 #include "point_light.hpp"
@@ -32,7 +36,8 @@ int main(int argc, char *argv[])
 {
     int window_width;
     int window_height;
-    int render_scale;
+    float render_scale;
+    std::string profile_filename;
 
     try
     {
@@ -41,6 +46,7 @@ int main(int argc, char *argv[])
         cxxopts::OptionAdder option_adder = options.add_options();
         option_adder("height", "Set window height", cxxopts::value<int>()->default_value("720"));
         option_adder("h,help", "Print usage");
+        option_adder("profile", "Write the GPU time of every pass to a CSV file", cxxopts::value<std::string>());
         option_adder("scale", "Set render scale", cxxopts::value<float>()->default_value("1.0"));
         option_adder("v,version", "Print version");
         option_adder("width", "Set window width", cxxopts::value<int>()->default_value("1280"));
@@ -64,6 +70,11 @@ int main(int argc, char *argv[])
         }
 
         window_width = result["width"].as<int>();
+
+        if (result.count("profile"))
+        {
+            profile_filename = result["profile"].as<std::string>();
+        }
     }
     catch (std::exception &e)
     {
@@ -134,10 +145,12 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    liminal::renderer renderer(
-        window_width, window_height, render_scale,
-        window_width, window_height,
-        window_width, window_height);
+    float reflection_scale = 0.5f;
+    liminal::renderer renderer(window_width, window_height, render_scale, reflection_scale);
+    if (!profile_filename.empty())
+    {
+        renderer.profiler.start_capture(profile_filename);
+    }
     liminal::audio audio;
 
     btDefaultCollisionConfiguration *collision_configuration = new btDefaultCollisionConfiguration();
@@ -203,34 +216,41 @@ int main(int argc, char *argv[])
     liminal::directional_light *sun = new liminal::directional_light(
         glm::vec3(0.352286f, -0.547564f, -0.758992f),
         glm::vec3(1.0f, 1.0f, 1.0f) * sun_intensity,
-        4096);
+        1024);
 
     const float light_intensity = 10.0f;
+    const float light_radius = 25.0f;
     liminal::point_light *red_light = new liminal::point_light(
         glm::vec3(2.0f, 0.0f, 2.0f),
         glm::vec3(1.0f, 0.0f, 0.0f) * light_intensity,
-        512);
+        light_radius,
+        true);
     liminal::point_light *yellow_light = new liminal::point_light(
         glm::vec3(-2.0f, 0.0f, -2.0f),
         glm::vec3(1.0f, 1.0f, 0.0f) * light_intensity,
-        512);
+        light_radius,
+        true);
     liminal::point_light *green_light = new liminal::point_light(
         glm::vec3(2.0f, 0.0f, -2.0f),
         glm::vec3(0.0f, 1.0f, 0.0f) * light_intensity,
-        512);
+        light_radius,
+        true);
     liminal::point_light *blue_light = new liminal::point_light(
         glm::vec3(-2.0f, 0.0f, 2.0f),
         glm::vec3(0.0f, 0.0f, 1.0f) * light_intensity,
-        512);
+        light_radius,
+        true);
 
     const float flashlight_intensity = 20.0f;
+    const float flashlight_radius = 10.0f;
     liminal::spot_light *flashlight = new liminal::spot_light(
         glm::vec3(0.0f, 0.0f, 0.0f),
         glm::vec3(0.0f, 0.0f, 0.0f),
         glm::vec3(1.0f, 1.0f, 1.0f) * flashlight_intensity,
+        flashlight_radius,
         cosf(glm::radians(12.5f)),
         cosf(glm::radians(15.0f)),
-        1024);
+        true);
 
     liminal::water *water = new liminal::water(
         glm::vec3(0.0f, -2.0f, 0.0f),
@@ -243,6 +263,17 @@ int main(int argc, char *argv[])
         10.0f);
     // world->addRigidBody(terrain->rigidbody);
 
+    liminal::renderer::object_handle object_handle = renderer.add_object(object->model, object->calc_model());
+    liminal::renderer::object_handle animated_object_handle = renderer.add_object(animated_object->model, animated_object->calc_model());
+    liminal::renderer::object_handle animated_object2_handle = renderer.add_object(animated_object2->model, animated_object2->calc_model());
+
+    renderer.add_light(sun);
+    liminal::renderer::point_light_handle red_light_handle = renderer.add_light(red_light);
+    liminal::renderer::point_light_handle yellow_light_handle = renderer.add_light(yellow_light);
+    liminal::renderer::point_light_handle green_light_handle = renderer.add_light(green_light);
+    liminal::renderer::point_light_handle blue_light_handle = renderer.add_light(blue_light);
+    liminal::renderer::spot_light_handle flashlight_handle = renderer.add_light(flashlight);
+
     liminal::sound *ambient_sound = new liminal::sound("assets/audio/ambient.wav");
     liminal::sound *bounce_sound = new liminal::sound("assets/audio/bounce.wav");
     liminal::sound *shoot_sound = new liminal::sound("assets/audio/shoot.wav");
@@ -258,6 +289,17 @@ int main(int argc, char *argv[])
     float time_scale = 1.0f;
     bool console_open = false;
     bool wireframe = false;
+    bool gpu_culling = false;
+    bool occlusion_culling = false;
+    bool sdsm = false;
+    bool screen_space_reflections = false;
+    bool water_reflection_shadows = false;
+    bool bloom = true;
+    float exposure = 1.0f;
+    float vignette = 0.0f;
+    liminal::renderer::color_grading color_grading;
+    liminal::frame_governor frame_governor(16.0f);
+    bool compact_gbuffer = true;
     bool edit_mode = false;
     bool lock_cursor = true;
     bool flashlight_on = true;
@@ -296,9 +338,7 @@ int main(int argc, char *argv[])
                     window_width = event.window.data1;
                     window_height = event.window.data2;
                     SDL_SetWindowSize(window, window_width, window_height);
-                    renderer.set_screen_size(window_width, window_height, render_scale);
-                    renderer.set_reflection_size(window_width, window_height);
-                    renderer.set_refraction_size(window_width, window_height);
+                    renderer.set_screen_size(window_width, window_height, render_scale * frame_governor.get_level().render_scale);
                     std::cout << "Window resized to " << window_width << "x" << window_height << std::endl;
                 }
                 break;
@@ -338,7 +378,7 @@ int main(int argc, char *argv[])
                         {
                             render_scale -= 0.1f;
                         }
-                        renderer.set_screen_size(window_width, window_height, render_scale);
+                        renderer.set_screen_size(window_width, window_height, render_scale * frame_governor.get_level().render_scale);
                         std::cout << "Render scale changed to " << render_scale << std::endl;
                     }
                     break;
@@ -348,7 +388,7 @@ int main(int argc, char *argv[])
                         {
                             render_scale += 0.1f;
                         }
-                        renderer.set_screen_size(window_width, window_height, render_scale);
+                        renderer.set_screen_size(window_width, window_height, render_scale * frame_governor.get_level().render_scale);
                         std::cout << "Render scale changed to " << render_scale << std::endl;
                     }
                     break;
@@ -365,6 +405,14 @@ int main(int argc, char *argv[])
                     case SDLK_f:
                     {
                         flashlight_on = !flashlight_on;
+                        if (flashlight_on)
+                        {
+                            flashlight_handle = renderer.add_light(flashlight);
+                        }
+                        else
+                        {
+                            renderer.remove_light(flashlight_handle);
+                        }
                     }
                     break;
                     case SDLK_g:
@@ -512,11 +560,16 @@ int main(int argc, char *argv[])
         green_light->position.z = distance * cosf(angle + pi);
         blue_light->position.x = distance * sinf(angle + 3 * pi / 2);
         blue_light->position.z = distance * cosf(angle + 3 * pi / 2);
+        renderer.update_light(red_light_handle);
+        renderer.update_light(yellow_light_handle);
+        renderer.update_light(green_light_handle);
+        renderer.update_light(blue_light_handle);
 
         if (flashlight_follow)
         {
             flashlight->position = camera->position;
             flashlight->direction = glm::mix(flashlight->direction, camera_front, 30.0f * delta_time);
+            renderer.update_light(flashlight_handle);
         }
 
         audio.set_listener(camera->position, camera_front, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -547,31 +600,160 @@ int main(int argc, char *argv[])
         SDL_GL_MakeCurrent(window, context);
 
         renderer.wireframe = wireframe;
+        renderer.gpu_culling = gpu_culling;
+        renderer.occlusion_culling = occlusion_culling;
+        renderer.sdsm = sdsm;
+        renderer.screen_space_reflections = screen_space_reflections;
+        renderer.water_reflection_shadows = water_reflection_shadows;
+        renderer.bloom = bloom;
+        renderer.exposure = exposure;
+        renderer.vignette = vignette;
         renderer.camera = camera;
         renderer.skybox = skybox;
-        renderer.objects.push_back(object);
-        renderer.objects.push_back(animated_object);
-        renderer.objects.push_back(animated_object2);
-        renderer.directional_lights.push_back(sun);
-        renderer.point_lights.push_back(red_light);
-        renderer.point_lights.push_back(yellow_light);
-        renderer.point_lights.push_back(green_light);
-        renderer.point_lights.push_back(blue_light);
-        if (flashlight_on)
-        {
-            renderer.spot_lights.push_back(flashlight);
-        }
+        renderer.set_object_transform(object_handle, object->calc_model());
+        renderer.set_object_transform(animated_object_handle, animated_object->calc_model());
+        renderer.set_object_transform(animated_object2_handle, animated_object2->calc_model());
         renderer.terrains.push_back(terrain);
         renderer.waters.push_back(water);
         renderer.flush(current_time, delta_time);
 
+        // give up some quality when the gpu can't keep up, and take it back once it can
+        if (frame_governor.update(renderer.profiler.get_frame_time()))
+        {
+            const liminal::frame_governor::level &level = frame_governor.get_level();
+            renderer.set_screen_size(window_width, window_height, render_scale * level.render_scale);
+            renderer.set_reflection_scale(reflection_scale * level.reflection_scale);
+            renderer.set_shadow_scale(level.shadow_scale);
+            std::cout << "Frame governor changed to level " << frame_governor.get_level_index()
+                      << " (render " << level.render_scale
+                      << ", reflection " << level.reflection_scale
+                      << ", shadow " << level.shadow_scale
+                      << ") at " << frame_governor.get_average_frame_time() << " ms" << std::endl;
+        }
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL2_NewFrame(window);
         ImGui::NewFrame();
 
         if (edit_mode)
         {
+            // passes and profiler sections repeated for each light keep the light's index apart from the name
+            // they're only put together here, while the window is open
+            char label_buffer[64];
+            auto make_label = [&](const char *name, int index) -> const char * {
+                if (index < 0)
+                {
+                    return name;
+                }
+                snprintf(label_buffer, sizeof(label_buffer), "%s %d", name, index);
+                return label_buffer;
+            };
+
             ImGui::ShowDemoWindow();
+
+            ImGui::Begin("Renderer");
+            ImGui::Checkbox("GPU culling", &gpu_culling);
+            ImGui::Checkbox("Occlusion culling", &occlusion_culling);
+            ImGui::Checkbox("Fit cascades to depth", &sdsm);
+            if (ImGui::Checkbox("Compact gbuffer", &compact_gbuffer))
+            {
+                renderer.set_compact_gbuffer(compact_gbuffer);
+            }
+            ImGui::Checkbox("Screen space reflections", &screen_space_reflections);
+            ImGui::Checkbox("Water reflection shadows", &water_reflection_shadows);
+            if (ImGui::SliderFloat("Water reflection scale", &reflection_scale, 0.25f, 1.0f))
+            {
+                renderer.set_reflection_scale(reflection_scale * frame_governor.get_level().reflection_scale);
+            }
+            ImGui::Checkbox("Frame governor", &frame_governor.enabled);
+            ImGui::SliderFloat("Target frame time (ms)", &frame_governor.target_frame_time, 4.0f, 33.0f);
+            ImGui::Text("GPU frame time: %.2f ms, level %zu / %zu", renderer.profiler.get_frame_time(), frame_governor.get_level_index(), frame_governor.get_num_levels() - 1);
+            ImGui::Checkbox("Bloom", &bloom);
+            ImGui::SliderFloat("Exposure", &exposure, 0.1f, 4.0f);
+            ImGui::SliderFloat("Vignette", &vignette, 0.0f, 1.0f);
+            bool color_grading_changed = false;
+            color_grading_changed |= ImGui::SliderFloat("Contrast", &color_grading.contrast, 0.5f, 1.5f);
+            color_grading_changed |= ImGui::SliderFloat("Saturation", &color_grading.saturation, 0.0f, 2.0f);
+            color_grading_changed |= ImGui::ColorEdit3("Color filter", &color_grading.color_filter.x);
+            if (color_grading_changed)
+            {
+                renderer.set_color_grading(color_grading);
+            }
+            liminal::gl_state::counters gl_calls = liminal::gl_state::get_counters();
+            ImGui::Text("GL state calls: %u issued, %u elided", gl_calls.issued, gl_calls.elided);
+            ImGui::Text("Materials: %zu", liminal::mesh::material_library->size());
+            for (auto &pass : renderer.stats)
+            {
+                const char *label = make_label(pass.name, pass.index);
+                if (pass.gpu_culled)
+                {
+                    ImGui::Text("%s: %u / %u sent to GPU culling", label, pass.visible, pass.tested);
+                }
+                else
+                {
+                    ImGui::Text("%s: %u / %u visible, %u draws", label, pass.visible, pass.tested, pass.draws);
+                }
+            }
+            ImGui::End();
+
+            ImGui::Begin("GPU profiler");
+            {
+                const std::vector<float> &history = renderer.profiler.get_history();
+                ImGui::PlotLines(
+                    "Frame time (ms)",
+                    history.data(),
+                    (int)history.size(),
+                    (int)renderer.profiler.get_history_offset(),
+                    nullptr,
+                    0.0f,
+                    frame_governor.target_frame_time * 2.0f,
+                    ImVec2(0.0f, 60.0f));
+
+                // one row per nesting level, each section as wide as its share of the frame
+                const std::vector<liminal::gpu_profiler::section> &sections = renderer.profiler.get_sections();
+                float frame_time = renderer.profiler.get_frame_time();
+                ImDrawList *draw_list = ImGui::GetWindowDrawList();
+                ImVec2 origin = ImGui::GetCursorScreenPos();
+                float timeline_width = ImGui::GetContentRegionAvail().x;
+                float row_height = ImGui::GetTextLineHeightWithSpacing();
+                unsigned int rows = 1;
+                for (std::size_t i = 0; i < sections.size() && frame_time > 0.0f; i++)
+                {
+                    const liminal::gpu_profiler::section &section = sections[i];
+                    ImVec2 bar_min(origin.x + section.start_time / frame_time * timeline_width, origin.y + section.depth * row_height);
+                    ImVec2 bar_max(std::max(origin.x + (section.start_time + section.time) / frame_time * timeline_width, bar_min.x + 1.0f), bar_min.y + row_height - 1.0f);
+                    draw_list->AddRectFilled(bar_min, bar_max, ImColor::HSV(fmodf(i * 0.13f, 1.0f), 0.6f, 0.6f));
+                    const char *label = make_label(section.name, section.index);
+                    if (ImGui::CalcTextSize(label).x < bar_max.x - bar_min.x)
+                    {
+                        draw_list->AddText(bar_min, IM_COL32_WHITE, label);
+                    }
+                    if (ImGui::IsMouseHoveringRect(bar_min, bar_max))
+                    {
+                        ImGui::SetTooltip("%s: %.3f ms", label, section.time);
+                    }
+                    rows = std::max(rows, section.depth + 1);
+                }
+                ImGui::Dummy(ImVec2(timeline_width, rows * row_height));
+
+                for (auto &section : sections)
+                {
+                    ImGui::Text("%*s%s: %.3f ms", (int)section.depth * 2, "", make_label(section.name, section.index), section.time);
+                }
+
+                if (renderer.profiler.is_capturing())
+                {
+                    if (ImGui::Button("Stop CSV capture"))
+                    {
+                        renderer.profiler.stop_capture();
+                    }
+                }
+                else if (ImGui::Button("Start CSV capture"))
+                {
+                    renderer.profiler.start_capture(profile_filename.empty() ? "gpu_profile.csv" : profile_filename);
+                }
+            }
+            ImGui::End();
         }
 
         if (console_open)
@@ -0,0 +1,163 @@
+#include "material.hpp"
+
+#include "gl_state.hpp"
+
+// flag set in the material buffer when each texture unit holds a map
+static const GLuint texture_flags[NUM_MATERIAL_TEXTURES] = {
+    MATERIAL_HAS_ALBEDO_MAP,
+    MATERIAL_HAS_NORMAL_MAP,
+    MATERIAL_HAS_METALLIC_MAP,
+    MATERIAL_HAS_ROUGHNESS_MAP,
+    MATERIAL_HAS_OCCLUSION_MAP,
+    MATERIAL_HAS_HEIGHT_MAP};
+
+liminal::material::material()
+    : albedo_color(1.0f),
+      metallic(0.0f),
+      roughness(1.0f),
+      index(0)
+{
+    for (unsigned int i = 0; i < NUM_MATERIAL_TEXTURES; i++)
+    {
+        textures[i] = nullptr;
+    }
+}
+
+GLuint liminal::material::get_flags() const
+{
+    GLuint flags = 0;
+    for (unsigned int i = 0; i < NUM_MATERIAL_TEXTURES; i++)
+    {
+        if (textures[i])
+        {
+            flags |= texture_flags[i];
+        }
+    }
+    return flags;
+}
+
+bool liminal::material::has_same_textures(const liminal::material &other) const
+{
+    for (unsigned int i = 0; i < NUM_MATERIAL_TEXTURES; i++)
+    {
+        if (textures[i] != other.textures[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool liminal::material::has_same_parameters(const liminal::material &other) const
+{
+    return has_same_textures(other) &&
+           albedo_color == other.albedo_color &&
+           metallic == other.metallic &&
+           roughness == other.roughness;
+}
+
+void liminal::material::bind_textures() const
+{
+    for (unsigned int i = 0; i < NUM_MATERIAL_TEXTURES; i++)
+    {
+        liminal::gl_state::active_texture(GL_TEXTURE0 + i);
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, textures[i] ? textures[i]->texture_id : 0);
+    }
+}
+
+liminal::material_library::material_library()
+    : uploaded_count(0)
+{
+    glGenBuffers(1, &material_ssbo_id);
+
+    // the default material is always index 0
+    get_material(liminal::material());
+}
+
+liminal::material_library::~material_library()
+{
+    glDeleteBuffers(1, &material_ssbo_id);
+
+    for (auto material : materials)
+    {
+        delete material;
+    }
+
+    for (auto it = textures.begin(); it != textures.end(); it++)
+    {
+        delete it->second;
+    }
+}
+
+liminal::texture *liminal::material_library::load_texture(const std::string &filename, bool srgb)
+{
+    auto it = textures.find(filename);
+    if (it != textures.end())
+    {
+        return it->second;
+    }
+
+    liminal::texture *texture = new liminal::texture(filename, srgb);
+    textures[filename] = texture;
+    return texture;
+}
+
+const liminal::material *liminal::material_library::get_material(const liminal::material &description)
+{
+    // only searched when meshes are loaded, and scenes have far fewer materials than meshes
+    for (auto material : materials)
+    {
+        if (material->has_same_parameters(description))
+        {
+            return material;
+        }
+    }
+
+    liminal::material *material = new liminal::material(description);
+    material->index = (GLuint)materials.size();
+    materials.push_back(material);
+    return material;
+}
+
+const liminal::material *liminal::material_library::get_default_material() const
+{
+    return materials[0];
+}
+
+std::size_t liminal::material_library::size() const
+{
+    return materials.size();
+}
+
+void liminal::material_library::update()
+{
+    // materials are never removed, so the buffer only has to be rebuilt when one was added
+    if (uploaded_count < materials.size())
+    {
+        std::vector<liminal::material_data> material_datas;
+        material_datas.reserve(materials.size());
+        for (auto material : materials)
+        {
+            liminal::material_data material_data;
+            material_data.albedo_color = material->albedo_color;
+            material_data.flags = material->get_flags();
+            material_data.metallic = material->metallic;
+            material_data.roughness = material->roughness;
+            material_data.padding[0] = 0.0f;
+            material_data.padding[1] = 0.0f;
+            material_datas.push_back(material_data);
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, material_ssbo_id);
+        glBufferData(
+            GL_SHADER_STORAGE_BUFFER,
+            (GLsizeiptr)(material_datas.size() * sizeof(liminal::material_data)),
+            material_datas.data(),
+            GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        uploaded_count = materials.size();
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, material_ssbo_id);
+}
@@ -0,0 +1,96 @@
+#ifndef MATERIAL_HPP
+#define MATERIAL_HPP
+
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <GL/glew.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "texture.hpp"
+
+// texture units used by the geometry programs
+#define MATERIAL_ALBEDO_MAP 0
+#define MATERIAL_NORMAL_MAP 1
+#define MATERIAL_METALLIC_MAP 2
+#define MATERIAL_ROUGHNESS_MAP 3
+#define MATERIAL_OCCLUSION_MAP 4
+#define MATERIAL_HEIGHT_MAP 5
+#define NUM_MATERIAL_TEXTURES 6
+
+// must match assets/shaders/glsl/materials.glsl
+#define MATERIAL_HAS_NORMAL_MAP (1 << 0)
+#define MATERIAL_HAS_METALLIC_MAP (1 << 1)
+#define MATERIAL_HAS_ROUGHNESS_MAP (1 << 2)
+#define MATERIAL_HAS_OCCLUSION_MAP (1 << 3)
+#define MATERIAL_HAS_HEIGHT_MAP (1 << 4)
+#define MATERIAL_HAS_ALBEDO_MAP (1 << 5)
+
+namespace liminal
+{
+    // per-material data read by the shaders through the draw's material index, must match assets/shaders/glsl/materials.glsl
+    struct material_data
+    {
+        glm::vec3 albedo_color;
+        GLuint flags;
+        float metallic;
+        float roughness;
+        float padding[2];
+    };
+
+    // textures and the factors used in place of the ones that are missing
+    // materials are only ever created by the library, so meshes with the same material share one
+    struct material
+    {
+        // indexed by texture unit, null where there is no map
+        liminal::texture *textures[NUM_MATERIAL_TEXTURES];
+        glm::vec3 albedo_color;
+        float metallic;
+        float roughness;
+
+        // position in the library's material buffer, also orders materials in the render queue's sort key
+        GLuint index;
+
+        material();
+
+        GLuint get_flags() const;
+        bool has_same_textures(const liminal::material &other) const;
+        bool has_same_parameters(const liminal::material &other) const;
+
+        // units that already hold the texture are skipped by the state cache
+        void bind_textures() const;
+    };
+
+    // owns every texture and material loaded by meshes, so identical ones are shared across models
+    // the parameters of every material live in one buffer, indexed by the material index of each draw
+    class material_library
+    {
+    public:
+        material_library();
+        ~material_library();
+
+        // textures are keyed by filename and live as long as the library
+        liminal::texture *load_texture(const std::string &filename, bool srgb = false);
+
+        // returns the material with the same textures and factors as the description, creating it if there is none
+        const liminal::material *get_material(const liminal::material &description);
+
+        // no textures and neutral factors, for meshes that are created without a material
+        const liminal::material *get_default_material() const;
+
+        std::size_t size() const;
+
+        // uploads materials created since the last call and binds the buffer
+        void update();
+
+    private:
+        std::unordered_map<std::string, liminal::texture *> textures;
+        std::vector<liminal::material *> materials;
+
+        GLuint material_ssbo_id;
+        std::size_t uploaded_count;
+    };
+} // namespace liminal
+
+#endif
@@ -1,140 +1,91 @@
 #include "mesh.hpp"
 
-#include <assimp/scene.h>
+#include <glm/glm.hpp>
+#include <iostream>
+
+#include "gl_state.hpp"
+
+liminal::geometry_pool *liminal::mesh::geometry_pool = nullptr;
+liminal::material_library *liminal::mesh::material_library = nullptr;
 
 liminal::mesh::mesh(
     std::vector<liminal::vertex> vertices,
     std::vector<GLuint> indices,
-    std::vector<std::vector<liminal::texture *>> textures)
-    : vertices_size((GLsizei)(vertices.size() * sizeof(liminal::vertex))),
-      indices_size((GLsizei)(indices.size() * sizeof(GLuint))),
-      textures(textures)
+    const liminal::material *material)
+    : allocation(),
+      material(material)
 {
-    glGenVertexArrays(1, &vao_id);
-    glBindVertexArray(vao_id);
+    if (!geometry_pool || !material_library)
     {
-        glGenBuffers(1, &vbo_id);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
-        glBufferData(GL_ARRAY_BUFFER, vertices_size, vertices.data(), GL_STATIC_DRAW);
-
-        glGenBuffers(1, &ebo_id);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_id);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_size, indices.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, uv));
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, tangent));
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, bitangent));
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, bone_ids));
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(liminal::vertex), (void *)offsetof(liminal::vertex, bone_weights));
-
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glEnableVertexAttribArray(3);
-        glEnableVertexAttribArray(4);
-        glEnableVertexAttribArray(5);
-        glEnableVertexAttribArray(6);
+        std::cerr << "Error: Geometry pool and material library must be created before any mesh" << std::endl;
+        return;
     }
-    glBindVertexArray(0);
-}
-
-liminal::mesh::~mesh()
-{
-    glDeleteVertexArrays(1, &vao_id);
-    glDeleteBuffers(1, &vbo_id);
-    glDeleteBuffers(1, &ebo_id);
-}
-
-void liminal::mesh::draw(liminal::program *program) const
-{
-    // TODO: support multiple textures per type in the shader?
 
-    glActiveTexture(GL_TEXTURE0);
-    if (textures.size() > 0 && textures[aiTextureType_DIFFUSE].size() > 0)
-    {
-        glBindTexture(GL_TEXTURE_2D, textures[aiTextureType_DIFFUSE][0]->texture_id);
-    }
-    else
+    if (!material)
     {
-        glBindTexture(GL_TEXTURE_2D, 0);
+        this->material = material_library->get_default_material();
     }
 
-    glActiveTexture(GL_TEXTURE1);
-    if (textures.size() > 0 && textures[aiTextureType_NORMALS].size() > 0)
-    {
-        program->set_int("material.has_normal_map", 1);
-        glBindTexture(GL_TEXTURE_2D, textures[aiTextureType_NORMALS][0]->texture_id);
-    }
-    else
-    {
-        program->set_int("material.has_normal_map", 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
+    allocation = geometry_pool->allocate(vertices, indices);
 
-    glActiveTexture(GL_TEXTURE2);
-    if (textures.size() > 0 && textures[aiTextureType_SHININESS].size() > 0)
+    // calculate bounds
+    for (auto &vertex : vertices)
     {
-        program->set_int("material.has_metallic_map", 1);
-        glBindTexture(GL_TEXTURE_2D, textures[aiTextureType_SHININESS][0]->texture_id);
-    }
-    else
-    {
-        program->set_int("material.has_metallic_map", 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        aabb.expand(vertex.position);
     }
 
-    glActiveTexture(GL_TEXTURE3);
-    if (textures.size() > 0 && textures[aiTextureType_OPACITY].size() > 0)
+    // the sphere is centered on the box but fit to the vertices, which is tighter than the box's corners
+    sphere.center = aabb.is_empty() ? glm::vec3(0.0f) : aabb.calc_center();
+    sphere.radius = 0.0f;
+    for (auto &vertex : vertices)
     {
-        program->set_int("material.has_roughness_map", 1);
-        glBindTexture(GL_TEXTURE_2D, textures[aiTextureType_OPACITY][0]->texture_id);
-    }
-    else
-    {
-        program->set_int("material.has_roughness_map", 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        sphere.radius = glm::max(sphere.radius, glm::length(vertex.position - sphere.center));
     }
+}
 
-    glActiveTexture(GL_TEXTURE4);
-    if (textures.size() > 0 && textures[aiTextureType_AMBIENT].size() > 0)
-    {
-        program->set_int("material.has_occlusion_map", 1);
-        glBindTexture(GL_TEXTURE_2D, textures[aiTextureType_AMBIENT][0]->texture_id);
-    }
-    else
+liminal::mesh::~mesh()
+{
+    if (geometry_pool)
     {
-        program->set_int("material.has_occlusion_map", 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        geometry_pool->free(allocation);
     }
+}
 
-    glActiveTexture(GL_TEXTURE5);
-    if (textures.size() > 0 && textures[aiTextureType_HEIGHT].size() > 0)
+void liminal::mesh::update_skinned_bounds(const std::vector<glm::mat4> &bone_transformations)
+{
+    if (bone_aabbs.empty())
     {
-        program->set_int("material.has_height_map", 1);
-        glBindTexture(GL_TEXTURE_2D, textures[aiTextureType_HEIGHT][0]->texture_id);
+        return;
     }
-    else
+
+    // every vertex stays inside the union of the posed boxes of the bones that influence it
+    aabb = liminal::aabb();
+    for (std::size_t i = 0; i < bone_aabbs.size() && i < bone_transformations.size(); i++)
     {
-        program->set_int("material.has_height_map", 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        aabb.expand(bone_aabbs[i].transform(bone_transformations[i]));
     }
 
-    glBindVertexArray(vao_id);
-    glDrawElements(GL_TRIANGLES, indices_size, GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
+    sphere.center = aabb.is_empty() ? glm::vec3(0.0f) : aabb.calc_center();
+    sphere.radius = aabb.is_empty() ? 0.0f : glm::length(aabb.calc_extents());
+}
+
+void liminal::mesh::draw_elements(GLuint base_instance, GLsizei instance_count) const
+{
+    liminal::gl_state::bind_vertex_array(geometry_pool->get_vao_id());
+    glDrawElementsInstancedBaseVertexBaseInstance(
+        GL_TRIANGLES,
+        allocation.index_count,
+        GL_UNSIGNED_INT,
+        (void *)(allocation.first_index * sizeof(GLuint)),
+        instance_count,
+        allocation.base_vertex,
+        base_instance);
+}
+
+void liminal::mesh::draw(GLuint base_instance, GLsizei instance_count) const
+{
+    material->bind_textures();
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    draw_elements(base_instance, instance_count);
+    liminal::gl_state::bind_vertex_array(0);
 }
@@ -1,12 +1,15 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include <glm/matrix.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <GL/glew.h>
 #include <vector>
 
-#include "texture.hpp"
+#include "bounds.hpp"
+#include "geometry_pool.hpp"
+#include "material.hpp"
 #include "program.hpp"
 #include "vertex.hpp"
 
@@ -14,20 +17,34 @@ namespace liminal
 {
     struct mesh
     {
-        GLsizei vertices_size;
-        GLsizei indices_size;
-        GLuint vao_id;
-        GLuint vbo_id;
-        GLuint ebo_id;
-        std::vector<std::vector<liminal::texture *>> textures;
+        // every mesh is sub-allocated from this pool, which the renderer creates before any mesh is loaded
+        static liminal::geometry_pool *geometry_pool;
+
+        // every material is shared through this library, which the renderer creates before any mesh is loaded
+        static liminal::material_library *material_library;
+
+        liminal::geometry_pool::allocation allocation;
+        const liminal::material *material;
+
+        // bounds in model space, skinned meshes update them to the current pose
+        liminal::aabb aabb;
+        liminal::bounding_sphere sphere;
+
+        // bind pose bounds of the vertices influenced by each bone, indexed by bone id
+        // filled in by the model that owns the mesh, empty unless the mesh is skinned
+        std::vector<liminal::aabb> bone_aabbs;
 
         mesh(
             std::vector<liminal::vertex> vertices,
             std::vector<unsigned int> indices,
-            std::vector<std::vector<liminal::texture *>> textures);
+            const liminal::material *material = nullptr);
         ~mesh();
 
-        void draw(liminal::program *program) const;
+        void update_skinned_bounds(const std::vector<glm::mat4> &bone_transformations);
+
+        void draw_elements(GLuint base_instance = 0, GLsizei instance_count = 1) const;
+
+        void draw(GLuint base_instance = 0, GLsizei instance_count = 1) const;
     };
 } // namespace liminal
 
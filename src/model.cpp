@@ -12,6 +12,15 @@ static inline glm::quat quat_cast(const aiQuaternion &q) { return glm::quat(q.w,
 static inline glm::mat4 mat4_cast(const aiMatrix4x4 &m) { return glm::transpose(glm::make_mat4(&m.a1)); }
 static inline glm::mat4 mat4_cast(const aiMatrix3x3 &m) { return glm::transpose(glm::make_mat3(&m.a1)); }
 
+// the assimp texture type loaded into each material texture unit
+static const aiTextureType texture_types[NUM_MATERIAL_TEXTURES] = {
+    aiTextureType_DIFFUSE,
+    aiTextureType_NORMALS,
+    aiTextureType_SHININESS,
+    aiTextureType_OPACITY,
+    aiTextureType_AMBIENT,
+    aiTextureType_HEIGHT};
+
 liminal::model::model(const std::string &filename, bool flip_uvs)
     : directory(filename.substr(0, filename.find_last_of('/')))
 {
@@ -33,6 +42,8 @@ liminal::model::model(const std::string &filename, bool flip_uvs)
     animation_index = 0;
 
     process_node_meshes(scene->mRootNode, scene);
+
+    calc_bounds();
 }
 
 liminal::model::~model()
@@ -41,11 +52,6 @@ liminal::model::~model()
     {
         delete meshes[i];
     }
-
-    for (auto it = loaded_textures.begin(); it != loaded_textures.end(); it++)
-    {
-        delete it->second;
-    }
 }
 
 bool liminal::model::has_animations() const
@@ -78,6 +84,12 @@ void liminal::model::update_bone_transformations(unsigned int current_time)
         {
             bone_transformations[i] = bones[i].transformation;
         }
+
+        for (auto &mesh : meshes)
+        {
+            mesh->update_skinned_bounds(bone_transformations);
+        }
+        calc_bounds();
     }
 }
 
@@ -85,7 +97,23 @@ void liminal::model::draw_meshes(liminal::program *program) const
 {
     for (unsigned int i = 0; i < meshes.size(); i++)
     {
-        meshes[i]->draw(program);
+        meshes[i]->draw();
+    }
+}
+
+void liminal::model::calc_bounds()
+{
+    aabb = liminal::aabb();
+    for (auto &mesh : meshes)
+    {
+        aabb.expand(mesh->aabb);
+    }
+
+    sphere.center = aabb.is_empty() ? glm::vec3(0.0f) : aabb.calc_center();
+    sphere.radius = 0.0f;
+    for (auto &mesh : meshes)
+    {
+        sphere.radius = glm::max(sphere.radius, glm::length(mesh->sphere.center - sphere.center) + mesh->sphere.radius);
     }
 }
 
@@ -107,7 +135,7 @@ liminal::mesh *liminal::model::create_mesh(const aiMesh *scene_mesh, const aiSce
 {
     std::vector<liminal::vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<std::vector<liminal::texture *>> textures;
+    const liminal::material *material = nullptr;
 
     // process vertices
     for (unsigned int i = 0; i < scene_mesh->mNumVertices; i++)
@@ -188,42 +216,79 @@ liminal::mesh *liminal::model::create_mesh(const aiMesh *scene_mesh, const aiSce
         }
     }
 
-    // process textures
+    // process material
     if (scene->HasMaterials())
     {
-        aiMaterial *scene_material = scene->mMaterials[scene_mesh->mMaterialIndex];
-        for (aiTextureType type = aiTextureType_NONE; type <= AI_TEXTURE_TYPE_MAX; type = (aiTextureType)(type + 1))
+        material = create_material(scene->mMaterials[scene_mesh->mMaterialIndex]);
+    }
+
+    // process animations
+    if (scene->HasAnimations())
+    {
+        // TODO: store animations in a map to prevent calls to `find_node_animation` every frame
+    }
+
+    liminal::mesh *mesh = new liminal::mesh(vertices, indices, material);
+
+    // bind pose bounds per bone, so the mesh bounds can follow the animation without touching every vertex
+    if (scene_mesh->HasBones())
+    {
+        for (unsigned int i = 0; i < scene_mesh->mNumBones; i++)
         {
-            std::vector<liminal::texture *> material_textures;
+            unsigned int bone_index = bone_indices[scene_mesh->mBones[i]->mName.data];
+            if (bone_index >= mesh->bone_aabbs.size())
+            {
+                mesh->bone_aabbs.resize(bone_index + 1);
+            }
 
-            for (unsigned int i = 0; i < scene_material->GetTextureCount(type); i++)
+            for (unsigned int j = 0; j < scene_mesh->mBones[i]->mNumWeights; j++)
             {
-                aiString path;
-                scene_material->GetTexture(type, i, &path);
-                std::string filename = directory + "/" + path.C_Str();
-                if (loaded_textures.find(filename) == loaded_textures.end())
-                {
-                    liminal::texture *texture = new liminal::texture(filename);
-                    material_textures.push_back(texture);
-                    loaded_textures[filename] = texture;
-                }
-                else
+                if (scene_mesh->mBones[i]->mWeights[j].mWeight > 0.0f)
                 {
-                    material_textures.push_back(loaded_textures[filename]);
+                    mesh->bone_aabbs[bone_index].expand(vertices[scene_mesh->mBones[i]->mWeights[j].mVertexId].position);
                 }
             }
+        }
+    }
+
+    return mesh;
+}
+
+const liminal::material *liminal::model::create_material(const aiMaterial *scene_material)
+{
+    liminal::material material;
 
-            textures.push_back(material_textures);
+    // TODO: support multiple textures per type in the shader?
+    for (unsigned int i = 0; i < NUM_MATERIAL_TEXTURES; i++)
+    {
+        if (scene_material->GetTextureCount(texture_types[i]) > 0)
+        {
+            aiString path;
+            scene_material->GetTexture(texture_types[i], 0, &path);
+            material.textures[i] = liminal::mesh::material_library->load_texture(directory + "/" + path.C_Str());
         }
     }
 
-    // process animations
-    if (scene->HasAnimations())
+    // factors are only used where there is no map, and keep their defaults when the file doesn't have them
+    aiColor3D albedo_color;
+    if (scene_material->Get(AI_MATKEY_COLOR_DIFFUSE, albedo_color) == AI_SUCCESS)
     {
-        // TODO: store animations in a map to prevent calls to `find_node_animation` every frame
+        material.albedo_color = glm::vec3(albedo_color.r, albedo_color.g, albedo_color.b);
+    }
+#ifdef AI_MATKEY_METALLIC_FACTOR
+    float metallic;
+    if (scene_material->Get(AI_MATKEY_METALLIC_FACTOR, metallic) == AI_SUCCESS)
+    {
+        material.metallic = metallic;
+    }
+    float roughness;
+    if (scene_material->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness) == AI_SUCCESS)
+    {
+        material.roughness = roughness;
     }
+#endif
 
-    return new liminal::mesh(vertices, indices, textures);
+    return liminal::mesh::material_library->get_material(material);
 }
 
 void liminal::model::process_node_animations(float animation_time, const aiNode *node, const glm::mat4 &parent_transformation)
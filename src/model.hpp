@@ -8,9 +8,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include "bounds.hpp"
 #include "mesh.hpp"
 #include "program.hpp"
-#include "texture.hpp"
 
 namespace liminal
 {
@@ -23,8 +23,13 @@ namespace liminal
     struct model
     {
     public:
+        std::vector<liminal::mesh *> meshes;
         std::vector<glm::mat4> bone_transformations;
 
+        // union of the bounds of every mesh, follows the current pose for animated models
+        liminal::aabb aabb;
+        liminal::bounding_sphere sphere;
+
         model(const std::string &filename, bool flip_uvs = false);
         ~model();
 
@@ -40,18 +45,17 @@ namespace liminal
         Assimp::Importer importer;
         const aiScene *scene;
 
-        std::vector<liminal::mesh *> meshes;
-
         glm::mat4 global_inverse_transform;
         unsigned int num_bones;
         std::vector<bone> bones;
         std::unordered_map<std::string, unsigned int> bone_indices;
         unsigned int animation_index;
 
-        std::unordered_map<std::string, liminal::texture *> loaded_textures;
+        void calc_bounds();
 
         void process_node_meshes(const aiNode *node, const aiScene *scene);
         liminal::mesh *create_mesh(const aiMesh *mesh, const aiScene *scene);
+        const liminal::material *create_material(const aiMaterial *scene_material);
 
         void process_node_animations(float animation_time, const aiNode *node, const glm::mat4 &parent_transformation);
         const aiNodeAnim *find_node_animation(const aiAnimation *animation, const std::string node_name);
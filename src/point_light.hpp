@@ -3,7 +3,6 @@
 
 #include <glm/matrix.hpp>
 #include <glm/vec3.hpp>
-#include <GL/glew.h>
 #include <vector>
 
 namespace liminal
@@ -11,22 +10,22 @@ namespace liminal
     struct point_light
     {
         static float near_plane;
-        static float far_plane;
 
         glm::vec3 position;
         glm::vec3 color;
-        GLsizei depth_cube_size;
-        GLuint depth_cubemap_fbo_id;
-        GLuint depth_cubemap_texture_id;
+        float radius; // the light fades out to nothing here, and only casts shadows from objects inside it
+
+        // the renderer gives the light tiles in its shadow atlas every frame it's big enough on screen
+        // the rest of the time, or without this, it's drawn with the clustered lights instead
+        bool casts_shadows;
+
         std::vector<glm::mat4> transformation_matrices;
 
         point_light(
             glm::vec3 position,
             glm::vec3 color,
-            GLsizei depth_cube_size);
-        ~point_light();
-
-        void set_depth_cube_size(GLsizei depth_cube_size);
+            float radius,
+            bool casts_shadows);
 
         void update_transformation_matrices();
     };
@@ -5,6 +5,18 @@
 #include <iostream>
 #include <stb_include.h>
 
+#include "gl_state.hpp"
+
+static std::string make_defines(const std::vector<std::string> &defines)
+{
+    std::string source;
+    for (auto &define : defines)
+    {
+        source += "#define " + define + "\n";
+    }
+    return source;
+}
+
 liminal::program::program(
     const std::string &vertex_filename,
     const std::string &geometry_filename,
@@ -14,6 +26,7 @@ liminal::program::program(
       fragment_filename(fragment_filename)
 {
     program_id = create_program();
+    load_locations();
 }
 
 liminal::program::program(
@@ -23,9 +36,28 @@ liminal::program::program(
 {
 }
 
+liminal::program::program(
+    const std::string &vertex_filename,
+    const std::string &fragment_filename,
+    const std::vector<std::string> &defines)
+    : vertex_filename(vertex_filename),
+      fragment_filename(fragment_filename),
+      defines(make_defines(defines))
+{
+    program_id = create_program();
+    load_locations();
+}
+
+liminal::program::program(const std::string &compute_filename)
+    : compute_filename(compute_filename)
+{
+    program_id = create_program();
+    load_locations();
+}
+
 liminal::program::~program()
 {
-    glDeleteProgram(program_id);
+    liminal::gl_state::delete_program(program_id);
 }
 
 void liminal::program::reload()
@@ -35,58 +67,87 @@ void liminal::program::reload()
     GLuint new_program_id = create_program();
     if (new_program_id)
     {
-        glDeleteProgram(program_id);
+        liminal::gl_state::delete_program(program_id);
         program_id = new_program_id;
+        load_locations();
     }
 }
 
+GLuint liminal::program::get_program_id() const
+{
+    return program_id;
+}
+
 void liminal::program::bind() const
 {
-    glUseProgram(program_id);
+    liminal::gl_state::use_program(program_id);
 }
 
 void liminal::program::unbind(void) const
 {
-    glUseProgram(0);
+    liminal::gl_state::use_program(0);
 }
 
-void liminal::program::set_int(const std::string &name, GLint value) const
+void liminal::program::set_int(liminal::uniform_name name, GLint value) const
 {
     glUniform1i(get_location(name), value);
 }
 
-void liminal::program::set_unsigned_int(const std::string &name, GLuint value) const
+void liminal::program::set_unsigned_int(liminal::uniform_name name, GLuint value) const
 {
     glUniform1ui(get_location(name), value);
 }
 
-void liminal::program::set_float(const std::string &name, GLfloat value) const
+void liminal::program::set_float(liminal::uniform_name name, GLfloat value) const
 {
     glUniform1f(get_location(name), value);
 }
 
-void liminal::program::set_vec3(const std::string &name, glm::vec3 vec3) const
+void liminal::program::set_vec2(liminal::uniform_name name, const glm::vec2 &vec2) const
+{
+    glUniform2fv(get_location(name), 1, glm::value_ptr(vec2));
+}
+
+void liminal::program::set_vec3(liminal::uniform_name name, const glm::vec3 &vec3) const
 {
     glUniform3fv(get_location(name), 1, glm::value_ptr(vec3));
 }
 
-void liminal::program::set_vec4(const std::string &name, glm::vec4 vec4) const
+void liminal::program::set_vec4(liminal::uniform_name name, const glm::vec4 &vec4) const
 {
     glUniform4fv(get_location(name), 1, glm::value_ptr(vec4));
 }
 
-void liminal::program::set_mat4(const std::string &name, glm::mat4 mat4) const
+void liminal::program::set_mat4(liminal::uniform_name name, const glm::mat4 &mat4) const
 {
     glUniformMatrix4fv(get_location(name), 1, GL_FALSE, glm::value_ptr(mat4));
 }
 
-void liminal::program::set_mat4_vector(const std::string &name, std::vector<glm::mat4> mat4_vector) const
+void liminal::program::set_vec4_array(liminal::uniform_name name, const glm::vec4 *vec4s, GLsizei count) const
+{
+    glUniform4fv(get_location(name), count, glm::value_ptr(vec4s[0]));
+}
+
+void liminal::program::set_mat4_array(liminal::uniform_name name, const glm::mat4 *mat4s, GLsizei count) const
+{
+    glUniformMatrix4fv(get_location(name), count, GL_FALSE, glm::value_ptr(mat4s[0]));
+}
+
+void liminal::program::set_mat4_vector(liminal::uniform_name name, const std::vector<glm::mat4> &mat4_vector) const
 {
-    glUniformMatrix4fv(get_location(name), mat4_vector.size(), GL_FALSE, glm::value_ptr(mat4_vector[0]));
+    if (!mat4_vector.empty())
+    {
+        set_mat4_array(name, mat4_vector.data(), (GLsizei)mat4_vector.size());
+    }
 }
 
 GLuint liminal::program::create_program() const
 {
+    if (!compute_filename.empty())
+    {
+        return create_compute_program();
+    }
+
     GLuint program_id = glCreateProgram();
 
     GLuint vertex_shader = create_shader(GL_VERTEX_SHADER, vertex_filename);
@@ -163,6 +224,40 @@ GLuint liminal::program::create_program() const
     return program_id;
 }
 
+GLuint liminal::program::create_compute_program() const
+{
+    GLuint program_id = glCreateProgram();
+
+    GLuint compute_shader = create_shader(GL_COMPUTE_SHADER, compute_filename);
+    if (!compute_shader)
+    {
+        return 0;
+    }
+    glAttachShader(program_id, compute_shader);
+
+    glLinkProgram(program_id);
+    {
+        GLint success;
+        glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            GLint length;
+            glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &length);
+
+            std::vector<GLchar> info_log(length);
+            glGetProgramInfoLog(program_id, length, &length, &info_log[0]);
+
+            std::cerr << "Error: Failed to link program: " << &info_log[0] << std::endl;
+            return 0;
+        }
+    }
+
+    glDetachShader(program_id, compute_shader);
+    glDeleteShader(compute_shader);
+
+    return program_id;
+}
+
 GLuint liminal::program::create_shader(GLenum type, const std::string &filename) const
 {
     GLuint shader_id = glCreateShader(type);
@@ -170,7 +265,7 @@ GLuint liminal::program::create_shader(GLenum type, const std::string &filename)
     char error[256];
     char *source = stb_include_file(
         const_cast<char *>(filename.c_str()),
-        NULL,
+        defines.empty() ? NULL : const_cast<char *>(defines.c_str()),
         const_cast<char *>("assets/shaders"),
         error);
     if (!source)
@@ -201,17 +296,68 @@ GLuint liminal::program::create_shader(GLenum type, const std::string &filename)
     return shader_id;
 }
 
-GLint liminal::program::get_location(const std::string &name) const
+void liminal::program::load_locations()
 {
-    GLint location;
-    if (uniforms.find(name) == uniforms.end())
+    locations.clear();
+    if (!program_id)
+    {
+        return;
+    }
+
+    GLint uniform_count;
+    glGetProgramInterfaceiv(program_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_count);
+    GLint max_name_length;
+    glGetProgramInterfaceiv(program_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length);
+
+    std::vector<GLchar> name_buffer(max_name_length);
+    for (GLint i = 0; i < uniform_count; i++)
     {
-        location = glGetUniformLocation(program_id, name.c_str());
-        uniforms[name] = location;
+        const GLenum properties[] = {GL_LOCATION, GL_ARRAY_SIZE};
+        GLint values[2];
+        glGetProgramResourceiv(program_id, GL_UNIFORM, i, 2, properties, 2, nullptr, values);
+
+        // members of uniform blocks have no location, they're set through their buffer
+        GLint location = values[0];
+        GLint array_size = values[1];
+        if (location == -1)
+        {
+            continue;
+        }
+
+        glGetProgramResourceName(program_id, GL_UNIFORM, i, max_name_length, nullptr, name_buffer.data());
+        std::string name(name_buffer.data());
+        add_location(name, location);
+
+        // arrays are listed by their first element, but can be set by their own name or any element's
+        const std::string first_element = "[0]";
+        if (name.size() > first_element.size() && name.compare(name.size() - first_element.size(), first_element.size(), first_element) == 0)
+        {
+            std::string array_name = name.substr(0, name.size() - first_element.size());
+            add_location(array_name, location);
+            for (GLint j = 1; j < array_size; j++)
+            {
+                std::string element_name = array_name + "[" + std::to_string(j) + "]";
+                add_location(element_name, glGetUniformLocation(program_id, element_name.c_str()));
+            }
+        }
     }
-    else
+}
+
+void liminal::program::add_location(const std::string &name, GLint location)
+{
+    liminal::uniform_name uniform_name(name);
+    auto it = locations.find(uniform_name.hash);
+    if (it != locations.end() && it->second != location)
     {
-        location = uniforms[name];
+        std::cerr << "Error: Uniform name hash collision: " << name << std::endl;
+        return;
     }
-    return location;
+
+    locations[uniform_name.hash] = location;
+}
+
+GLint liminal::program::get_location(liminal::uniform_name name) const
+{
+    auto it = locations.find(name.hash);
+    return it == locations.end() ? -1 : it->second;
 }
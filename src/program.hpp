@@ -1,6 +1,7 @@
 #ifndef PROGRAM_HPP
 #define PROGRAM_HPP
 
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include <string>
@@ -9,6 +10,28 @@
 
 namespace liminal
 {
+    // a uniform is looked up by the fnv-1a hash of its name
+    // string literals can be hashed at compile time, so setting a uniform needn't build or hash a std::string
+    struct uniform_name
+    {
+        std::uint32_t hash;
+
+        constexpr uniform_name(const char *name)
+            : hash(hash_string(name, 2166136261u))
+        {
+        }
+
+        uniform_name(const std::string &name)
+            : uniform_name(name.c_str())
+        {
+        }
+
+        static constexpr std::uint32_t hash_string(const char *name, std::uint32_t hash)
+        {
+            return *name ? hash_string(name + 1, (hash ^ (std::uint8_t)*name) * 16777619u) : hash;
+        }
+    };
+
     class program
     {
     public:
@@ -19,34 +42,54 @@ namespace liminal
         program(
             const std::string &vertex_filename,
             const std::string &fragment_filename);
+        // each define is written as a #define on the #inject line of every shader, shaders without one get none
+        program(
+            const std::string &vertex_filename,
+            const std::string &fragment_filename,
+            const std::vector<std::string> &defines);
+        explicit program(const std::string &compute_filename);
         ~program();
 
         void reload();
 
+        GLuint get_program_id() const;
+
         void bind() const;
         void unbind(void) const;
 
-        void set_int(const std::string &name, GLint value) const;
-        void set_unsigned_int(const std::string &name, GLuint value) const;
-        void set_float(const std::string &name, GLfloat value) const;
-        void set_vec3(const std::string &name, glm::vec3 vec3) const;
-        void set_vec4(const std::string &name, glm::vec4 vec4) const;
-        void set_mat4(const std::string &name, glm::mat4 mat4) const;
-        void set_mat4_vector(const std::string &name, std::vector<glm::mat4> mat4_vector) const;
+        // names that aren't active uniforms of the program are ignored
+        void set_int(liminal::uniform_name name, GLint value) const;
+        void set_unsigned_int(liminal::uniform_name name, GLuint value) const;
+        void set_float(liminal::uniform_name name, GLfloat value) const;
+        void set_vec2(liminal::uniform_name name, const glm::vec2 &vec2) const;
+        void set_vec3(liminal::uniform_name name, const glm::vec3 &vec3) const;
+        void set_vec4(liminal::uniform_name name, const glm::vec4 &vec4) const;
+        void set_mat4(liminal::uniform_name name, const glm::mat4 &mat4) const;
+
+        // whole arrays at once, straight from the caller's memory
+        void set_vec4_array(liminal::uniform_name name, const glm::vec4 *vec4s, GLsizei count) const;
+        void set_mat4_array(liminal::uniform_name name, const glm::mat4 *mat4s, GLsizei count) const;
+        void set_mat4_vector(liminal::uniform_name name, const std::vector<glm::mat4> &mat4_vector) const;
 
     private:
         const std::string vertex_filename;
         const std::string geometry_filename;
         const std::string fragment_filename;
+        const std::string compute_filename;
+        const std::string defines;
 
         GLuint program_id;
 
-        mutable std::unordered_map<std::string, GLint> uniforms;
+        // location of every active uniform by name hash, read from the program whenever it's linked
+        std::unordered_map<std::uint32_t, GLint> locations;
 
         GLuint create_program() const;
+        GLuint create_compute_program() const;
         GLuint create_shader(GLenum type, const std::string &filename) const;
 
-        GLint get_location(const std::string &name) const;
+        void load_locations();
+        void add_location(const std::string &name, GLint location);
+        GLint get_location(liminal::uniform_name name) const;
     };
 } // namespace liminal
 
@@ -0,0 +1,426 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "gl_state.hpp"
+
+// hashed at compile time, these are set for every batch
+static constexpr liminal::uniform_name bone_transformations_uniform("bone_transformations");
+static constexpr liminal::uniform_name draw_offset_uniform("draw_offset");
+
+// orphans the buffer's previous storage so uploading doesn't wait on draws that may still be reading it
+// the storage only ever grows, size is what is actually needed this time
+static void orphan_buffer(GLenum target, GLuint buffer_id, GLsizeiptr &capacity, GLsizeiptr size, const void *data, GLenum usage)
+{
+    capacity = std::max(capacity, size);
+    glBindBuffer(target, buffer_id);
+    glBufferData(target, capacity, nullptr, usage);
+    if (data)
+    {
+        glBufferSubData(target, 0, size, data);
+    }
+}
+
+liminal::render_queue::render_queue()
+    : indirect_buffer_size(0),
+      draw_ssbo_size(0),
+      cull_command_ssbo_size(0),
+      candidate_command_ssbo_size(0),
+      culled_instance_ssbo_size(0),
+      culled_indirect_buffer_size(0),
+      culled_draw_ssbo_size(0),
+      draw_count_buffer_size(0),
+      occluded_candidate_ssbo_size(0)
+{
+    glGenBuffers(1, &indirect_buffer_id);
+    glGenBuffers(1, &draw_ssbo_id);
+    glGenBuffers(1, &cull_command_ssbo_id);
+    glGenBuffers(1, &candidate_command_ssbo_id);
+    glGenBuffers(1, &culled_instance_ssbo_id);
+    glGenBuffers(1, &culled_indirect_buffer_id);
+    glGenBuffers(1, &culled_draw_ssbo_id);
+    glGenBuffers(1, &draw_count_buffer_id);
+    glGenBuffers(1, &occluded_candidate_ssbo_id);
+}
+
+liminal::render_queue::~render_queue()
+{
+    glDeleteBuffers(1, &indirect_buffer_id);
+    glDeleteBuffers(1, &draw_ssbo_id);
+    glDeleteBuffers(1, &cull_command_ssbo_id);
+    glDeleteBuffers(1, &candidate_command_ssbo_id);
+    glDeleteBuffers(1, &culled_instance_ssbo_id);
+    glDeleteBuffers(1, &culled_indirect_buffer_id);
+    glDeleteBuffers(1, &culled_draw_ssbo_id);
+    glDeleteBuffers(1, &draw_count_buffer_id);
+    glDeleteBuffers(1, &occluded_candidate_ssbo_id);
+}
+
+std::uint64_t liminal::render_queue::make_sort_key(GLuint program_id, GLuint material_id, GLuint vao_id, float depth)
+{
+    std::uint64_t program_bits = (std::uint64_t)(program_id & 0xfff);
+    std::uint64_t material_bits = (std::uint64_t)(material_id & 0xfffff);
+    std::uint64_t vao_bits = (std::uint64_t)(vao_id & 0xffff);
+    std::uint64_t depth_bits = (std::uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * 0xffff);
+
+    return (program_bits << 52) | (material_bits << 32) | (vao_bits << 16) | depth_bits;
+}
+
+void liminal::render_queue::push(
+    liminal::program *program,
+    const liminal::mesh *mesh,
+    GLuint base_instance,
+    GLsizei instance_count,
+    const std::vector<glm::mat4> *bone_transformations,
+    float depth,
+    float tiling)
+{
+    liminal::draw_packet packet;
+    packet.sort_key = make_sort_key(program->get_program_id(), mesh->material->index, liminal::mesh::geometry_pool->get_vao_id(), depth);
+    packet.program = program;
+    packet.mesh = mesh;
+    packet.base_instance = base_instance;
+    packet.instance_count = instance_count;
+    packet.bone_transformations = bone_transformations;
+    packet.tiling = tiling;
+    packets.push_back(packet);
+}
+
+void liminal::render_queue::clear()
+{
+    packets.clear();
+    entries.clear();
+}
+
+void liminal::render_queue::sort()
+{
+    entries.resize(packets.size());
+    scratch.resize(packets.size());
+    for (std::uint32_t i = 0; i < packets.size(); i++)
+    {
+        entries[i].key = packets[i].sort_key;
+        entries[i].index = i;
+    }
+
+    // LSD radix sort, one byte per pass
+    // all histograms are built up front so passes where every key shares the same byte can be skipped
+    std::uint32_t histograms[8][256] = {};
+    for (auto &entry : entries)
+    {
+        for (unsigned int pass = 0; pass < 8; pass++)
+        {
+            histograms[pass][(entry.key >> (pass * 8)) & 0xff]++;
+        }
+    }
+
+    for (unsigned int pass = 0; pass < 8; pass++)
+    {
+        std::uint32_t *histogram = histograms[pass];
+
+        bool skip = false;
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            if (histogram[i] == entries.size())
+            {
+                skip = true;
+                break;
+            }
+        }
+        if (skip)
+        {
+            continue;
+        }
+
+        std::uint32_t offset = 0;
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            std::uint32_t count = histogram[i];
+            histogram[i] = offset;
+            offset += count;
+        }
+
+        for (auto &entry : entries)
+        {
+            scratch[histogram[(entry.key >> (pass * 8)) & 0xff]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
+
+void liminal::render_queue::submit(
+    bool bind_textures,
+    const std::function<void(liminal::program *)> &on_program,
+    const liminal::gpu_cull *gpu_cull)
+{
+    if (entries.empty())
+    {
+        return;
+    }
+
+    // build the commands in sorted order, starting a new batch whenever the packet needs different state
+    commands.clear();
+    draws.clear();
+    batches.clear();
+    cull_commands.clear();
+    for (auto &entry : entries)
+    {
+        const liminal::draw_packet &packet = packets[entry.index];
+
+        const liminal::draw_packet *previous = batches.empty() ? nullptr : batches.back().packet;
+        if (!previous ||
+            previous->program != packet.program ||
+            (bind_textures && !previous->mesh->material->has_same_textures(*packet.mesh->material)) ||
+            previous->bone_transformations != packet.bone_transformations)
+        {
+            draw_batch batch;
+            batch.packet = &packet;
+            batch.first_command = (GLsizei)commands.size();
+            batch.command_count = 0;
+            batches.push_back(batch);
+        }
+
+        // when culling on the gpu, the compute pass counts the instances that survive
+        liminal::draw_elements_indirect_command command;
+        command.count = (GLuint)packet.mesh->allocation.index_count;
+        command.instance_count = gpu_cull ? 0 : (GLuint)packet.instance_count;
+        command.first_index = packet.mesh->allocation.first_index;
+        command.base_vertex = packet.mesh->allocation.base_vertex;
+        command.base_instance = packet.base_instance;
+        commands.push_back(command);
+
+        liminal::draw_data draw;
+        draw.material_index = packet.mesh->material->index;
+        draw.tiling = packet.tiling;
+        draws.push_back(draw);
+
+        if (gpu_cull)
+        {
+            liminal::cull_command cull_command;
+            cull_command.aabb_min = glm::vec4(packet.mesh->aabb.min, 1.0f);
+            cull_command.aabb_max = glm::vec4(packet.mesh->aabb.max, 1.0f);
+            cull_command.first_instance = packet.base_instance;
+            cull_command.instance_count = (GLuint)packet.instance_count;
+            cull_command.batch = (GLuint)(batches.size() - 1);
+            cull_command.batch_first_command = (GLuint)batches.back().first_command;
+            cull_commands.push_back(cull_command);
+        }
+
+        batches.back().command_count++;
+    }
+
+    // the queue is usually submitted several times per frame
+    orphan_buffer(
+        GL_DRAW_INDIRECT_BUFFER,
+        indirect_buffer_id,
+        indirect_buffer_size,
+        (GLsizeiptr)(commands.size() * sizeof(liminal::draw_elements_indirect_command)),
+        commands.data(),
+        GL_STREAM_DRAW);
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        draw_ssbo_id,
+        draw_ssbo_size,
+        (GLsizeiptr)(draws.size() * sizeof(liminal::draw_data)),
+        draws.data(),
+        GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, draw_ssbo_id);
+
+    if (gpu_cull)
+    {
+        cull(*gpu_cull);
+    }
+
+    liminal::program *bound_program = nullptr;
+    const std::vector<glm::mat4> *bound_bone_transformations = nullptr;
+
+    // every mesh lives in the geometry pool, so a single VAO covers the whole queue
+    liminal::gl_state::bind_vertex_array(liminal::mesh::geometry_pool->get_vao_id());
+
+    for (std::size_t i = 0; i < batches.size(); i++)
+    {
+        const draw_batch &batch = batches[i];
+        const liminal::draw_packet &packet = *batch.packet;
+
+        if (packet.program != bound_program)
+        {
+            bound_program = packet.program;
+            bound_program->bind();
+            bound_bone_transformations = nullptr;
+
+            on_program(bound_program);
+        }
+
+        if (bind_textures)
+        {
+            packet.mesh->material->bind_textures();
+        }
+
+        if (packet.bone_transformations && packet.bone_transformations != bound_bone_transformations)
+        {
+            bound_bone_transformations = packet.bone_transformations;
+            bound_program->set_mat4_vector(bone_transformations_uniform, *packet.bone_transformations);
+        }
+
+        // gl_DrawID restarts at zero for every call
+        bound_program->set_unsigned_int(draw_offset_uniform, (GLuint)batch.first_command);
+
+        if (gpu_cull)
+        {
+            // the batch's count was written by the compact pass, command_count is only the upper bound
+            glMultiDrawElementsIndirectCount(
+                GL_TRIANGLES,
+                GL_UNSIGNED_INT,
+                (void *)(batch.first_command * sizeof(liminal::draw_elements_indirect_command)),
+                (GLintptr)(i * sizeof(GLuint)),
+                batch.command_count,
+                0);
+        }
+        else
+        {
+            glMultiDrawElementsIndirect(
+                GL_TRIANGLES,
+                GL_UNSIGNED_INT,
+                (void *)(batch.first_command * sizeof(liminal::draw_elements_indirect_command)),
+                batch.command_count,
+                0);
+        }
+    }
+
+    liminal::gl_state::bind_vertex_array(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBuffer(GL_PARAMETER_BUFFER, 0);
+
+    bound_program->unbind();
+}
+
+void liminal::render_queue::cull(const liminal::gpu_cull &gpu_cull)
+{
+    // which command every candidate instance belongs to, so the cull pass can run one thread per instance
+    // candidates outside every command's range would otherwise be drawn with some other command's mesh
+    candidate_commands.assign(gpu_cull.candidate_count, NO_CULL_COMMAND);
+    for (std::size_t i = 0; i < cull_commands.size(); i++)
+    {
+        for (GLuint j = 0; j < cull_commands[i].instance_count; j++)
+        {
+            candidate_commands[cull_commands[i].first_instance + j] = (GLuint)i;
+        }
+    }
+
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        cull_command_ssbo_id,
+        cull_command_ssbo_size,
+        (GLsizeiptr)(cull_commands.size() * sizeof(liminal::cull_command)),
+        cull_commands.data(),
+        GL_STREAM_DRAW);
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        candidate_command_ssbo_id,
+        candidate_command_ssbo_size,
+        (GLsizeiptr)(candidate_commands.size() * sizeof(GLuint)),
+        candidate_commands.data(),
+        GL_STREAM_DRAW);
+
+    // everything below is written and read only by the gpu
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        culled_instance_ssbo_id,
+        culled_instance_ssbo_size,
+        (GLsizeiptr)(candidate_commands.size() * sizeof(GLuint)),
+        nullptr,
+        GL_DYNAMIC_COPY);
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        culled_indirect_buffer_id,
+        culled_indirect_buffer_size,
+        (GLsizeiptr)(commands.size() * sizeof(liminal::draw_elements_indirect_command)),
+        nullptr,
+        GL_DYNAMIC_COPY);
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        culled_draw_ssbo_id,
+        culled_draw_ssbo_size,
+        (GLsizeiptr)(draws.size() * sizeof(liminal::draw_data)),
+        nullptr,
+        GL_DYNAMIC_COPY);
+    orphan_buffer(
+        GL_SHADER_STORAGE_BUFFER,
+        draw_count_buffer_id,
+        draw_count_buffer_size,
+        (GLsizeiptr)(batches.size() * sizeof(GLuint)),
+        nullptr,
+        GL_DYNAMIC_COPY);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    // phase 2 reads what phase 1 wrote, so it keeps the same storage
+    if (gpu_cull.occlusion_phase != 2)
+    {
+        orphan_buffer(
+            GL_SHADER_STORAGE_BUFFER,
+            occluded_candidate_ssbo_id,
+            occluded_candidate_ssbo_size,
+            (GLsizeiptr)(candidate_commands.size() * sizeof(GLuint)),
+            nullptr,
+            GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gpu_cull.candidate_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, candidate_command_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, cull_command_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, indirect_buffer_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, culled_instance_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, culled_indirect_buffer_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, culled_draw_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, draw_count_buffer_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, occluded_candidate_ssbo_id);
+
+    // test every candidate instance, counting the survivors of each command
+    gpu_cull.cull_program->bind();
+    {
+        gpu_cull.cull_program->set_unsigned_int("candidate_count", (GLuint)gpu_cull.candidate_count);
+        gpu_cull.cull_program->set_vec4_array("frustum_planes", gpu_cull.frustum.planes, 6);
+        gpu_cull.cull_program->set_unsigned_int("occlusion_phase", gpu_cull.occlusion_phase);
+        if (gpu_cull.occlusion_phase != 0)
+        {
+            gpu_cull.cull_program->set_mat4("occlusion_view_projection", gpu_cull.occlusion_view_projection);
+            liminal::gl_state::active_texture(GL_TEXTURE0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, gpu_cull.hi_z_texture_id);
+        }
+
+        glDispatchCompute((GLuint)(gpu_cull.candidate_count + 63) / 64, 1, 1);
+
+        if (gpu_cull.occlusion_phase != 0)
+        {
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+        }
+    }
+    gpu_cull.cull_program->unbind();
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // drop the commands left without instances
+    gpu_cull.compact_program->bind();
+    {
+        gpu_cull.compact_program->set_unsigned_int("command_count", (GLuint)commands.size());
+
+        glDispatchCompute((GLuint)(commands.size() + 63) / 64, 1, 1);
+    }
+    gpu_cull.compact_program->unbind();
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // draw from the compacted results instead
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culled_indirect_buffer_id);
+    glBindBuffer(GL_PARAMETER_BUFFER, draw_count_buffer_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, culled_draw_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, culled_instance_ssbo_id);
+}
+
+std::size_t liminal::render_queue::size() const
+{
+    return packets.size();
+}
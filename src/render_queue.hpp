@@ -0,0 +1,166 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <glm/matrix.hpp>
+#include <GL/glew.h>
+#include <vector>
+
+#include "bounds.hpp"
+#include "mesh.hpp"
+#include "program.hpp"
+
+// command of candidates no command covers, the cull pass skips them, must match assets/shaders/glsl/cull_commands.glsl
+#define NO_CULL_COMMAND 0xffffffff
+
+namespace liminal
+{
+    struct draw_packet
+    {
+        std::uint64_t sort_key;
+        liminal::program *program;
+        const liminal::mesh *mesh;
+        GLuint base_instance;
+        GLsizei instance_count;
+        const std::vector<glm::mat4> *bone_transformations;
+        float tiling;
+    };
+
+    // layout of a single glMultiDrawElementsIndirect command
+    struct draw_elements_indirect_command
+    {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+    };
+
+    // per-draw data read by the shaders through gl_DrawID, must match assets/shaders/glsl/draws.glsl
+    struct draw_data
+    {
+        GLuint material_index;
+        float tiling;
+    };
+
+    // per-command data for culling on the gpu, must match assets/shaders/glsl/cull_commands.glsl
+    struct cull_command
+    {
+        glm::vec4 aabb_min;
+        glm::vec4 aabb_max;
+        GLuint first_instance;
+        GLuint instance_count;
+        GLuint batch;
+        GLuint batch_first_command;
+    };
+
+    // what a pass needs to have its instances culled on the gpu instead of on the cpu
+    struct gpu_cull
+    {
+        liminal::program *cull_program;
+        liminal::program *compact_program;
+        liminal::frustum frustum;
+
+        // buffer holding the instances that every packet's base_instance range points into, and how many there are
+        GLuint candidate_ssbo_id;
+        GLsizei candidate_count;
+
+        // two phase occlusion culling against a hi-z pyramid, phase 0 only tests the frustum
+        // phase 1 reprojects with the camera the pyramid was built from and remembers which instances it hid
+        // phase 2 retests only those, with a pyramid of what phase 1 drew, so the queue has to be submitted again unchanged
+        unsigned int occlusion_phase;
+        GLuint hi_z_texture_id;
+        glm::mat4 occlusion_view_projection;
+    };
+
+    // collects the draws of a single pass so they can be sorted by state before being submitted
+    // sort key layout, from most to least significant bits:
+    //      program - 12 bits
+    //      material - 20 bits
+    //      vao - 16 bits
+    //      depth - 16 bits
+    class render_queue
+    {
+    public:
+        render_queue();
+        ~render_queue();
+
+        static std::uint64_t make_sort_key(GLuint program_id, GLuint material_id, GLuint vao_id, float depth);
+
+        void push(
+            liminal::program *program,
+            const liminal::mesh *mesh,
+            GLuint base_instance,
+            GLsizei instance_count,
+            const std::vector<glm::mat4> *bone_transformations,
+            float depth,
+            float tiling = 1.0f);
+        void clear();
+        void sort();
+
+        // draws every packet in sorted order with one glMultiDrawElementsIndirect per run of packets that share state
+        // a run is broken by a program change, a change of textures when binding them, or a different set of bones
+        // materials that only differ by their factors share a run, the shaders read those through the material index
+        // on_program is called whenever the bound program changes so per-pass uniforms can be set
+        // per-instance model matrices are expected to already be bound to the instance buffer binding
+        // and the visible instance list that base_instance indexes to its binding
+        // with gpu_cull, every instance of every packet is tested against the frustum in a compute pass
+        // and the commands that still draw something are compacted per batch, the results are never read back
+        void submit(
+            bool bind_textures,
+            const std::function<void(liminal::program *)> &on_program,
+            const liminal::gpu_cull *gpu_cull = nullptr);
+
+        std::size_t size() const;
+
+    private:
+        struct sort_entry
+        {
+            std::uint64_t key;
+            std::uint32_t index;
+        };
+
+        struct draw_batch
+        {
+            const liminal::draw_packet *packet;
+            GLsizei first_command;
+            GLsizei command_count;
+        };
+
+        std::vector<liminal::draw_packet> packets;
+        std::vector<sort_entry> entries;
+        std::vector<sort_entry> scratch;
+
+        std::vector<liminal::draw_elements_indirect_command> commands;
+        std::vector<liminal::draw_data> draws;
+        std::vector<draw_batch> batches;
+
+        GLuint indirect_buffer_id;
+        GLsizeiptr indirect_buffer_size;
+        GLuint draw_ssbo_id;
+        GLsizeiptr draw_ssbo_size;
+
+        std::vector<liminal::cull_command> cull_commands;
+        std::vector<GLuint> candidate_commands;
+
+        GLuint cull_command_ssbo_id;
+        GLsizeiptr cull_command_ssbo_size;
+        GLuint candidate_command_ssbo_id;
+        GLsizeiptr candidate_command_ssbo_size;
+        GLuint culled_instance_ssbo_id;
+        GLsizeiptr culled_instance_ssbo_size;
+        GLuint culled_indirect_buffer_id;
+        GLsizeiptr culled_indirect_buffer_size;
+        GLuint culled_draw_ssbo_id;
+        GLsizeiptr culled_draw_ssbo_size;
+        GLuint draw_count_buffer_id;
+        GLsizeiptr draw_count_buffer_size;
+        GLuint occluded_candidate_ssbo_id;
+        GLsizeiptr occluded_candidate_ssbo_size;
+
+        void cull(const liminal::gpu_cull &gpu_cull);
+    };
+} // namespace liminal
+
+#endif
@@ -1,28 +1,104 @@
 #include "renderer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/common.hpp>
 #include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <unordered_map>
+
+#include "gl_state.hpp"
+
+// hashed at compile time, set once for every light of every pass
+static constexpr liminal::uniform_name light_index_uniform("light_index");
+
+// effects the screen pass can be compiled with, by bit, must match the defines in assets/shaders/screen.fs
+#define SCREEN_EFFECT_BLOOM (1 << 0)
+#define SCREEN_EFFECT_VIGNETTE (1 << 1)
+#define SCREEN_EFFECT_COLOR_GRADING (1 << 2)
+#define SCREEN_EFFECT_GREYSCALE (1 << 3)
+static const char *const screen_effect_defines[] = {"BLOOM", "VIGNETTE", "COLOR_GRADING", "GREYSCALE"};
+static const unsigned int num_screen_effects = sizeof(screen_effect_defines) / sizeof(screen_effect_defines[0]);
+
+static void set_screen_samplers(const liminal::program *program)
+{
+    program->bind();
+    {
+        program->set_int("hdr_map", 0);
+        program->set_int("bloom_map", 1);
+        program->set_int("color_lut", 2);
+    }
+    program->unbind();
+}
+
+// pixels covered by a light's bounding sphere, false when it has to be drawn over the whole screen
+static bool calc_light_scissor(const glm::mat4 &view_projection, glm::vec3 position, float radius, GLsizei width, GLsizei height, GLint rect[4])
+{
+    glm::vec2 min_ndc(1.0f);
+    glm::vec2 max_ndc(-1.0f);
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = position + radius * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+        glm::vec4 clip = view_projection * glm::vec4(corner, 1.0f);
+
+        // a corner behind the camera projects to nowhere meaningful, the camera is most likely inside the light
+        if (clip.w <= 0.0f)
+        {
+            return false;
+        }
+
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        min_ndc = glm::min(min_ndc, ndc);
+        max_ndc = glm::max(max_ndc, ndc);
+    }
+    min_ndc = glm::clamp(min_ndc, glm::vec2(-1.0f), glm::vec2(1.0f));
+    max_ndc = glm::clamp(max_ndc, glm::vec2(-1.0f), glm::vec2(1.0f));
+
+    GLint min_x = (GLint)floorf((min_ndc.x * 0.5f + 0.5f) * (float)width);
+    GLint min_y = (GLint)floorf((min_ndc.y * 0.5f + 0.5f) * (float)height);
+    GLint max_x = (GLint)ceilf((max_ndc.x * 0.5f + 0.5f) * (float)width);
+    GLint max_y = (GLint)ceilf((max_ndc.y * 0.5f + 0.5f) * (float)height);
+    rect[0] = min_x;
+    rect[1] = min_y;
+    rect[2] = max_x - min_x;
+    rect[3] = max_y - min_y;
+    return true;
+}
+
+// distance along the view of a depth buffer value of the camera pass
+static float calc_view_distance(float depth)
+{
+    float ndc_depth = depth * 2.0f - 1.0f;
+    return 2.0f * liminal::camera::near_plane * liminal::camera::far_plane /
+           (liminal::camera::far_plane + liminal::camera::near_plane - ndc_depth * (liminal::camera::far_plane - liminal::camera::near_plane));
+}
 
 // TODO: framebuffer helper class
 // should store info about width/height
 // when binding the framebuffer, automatically set viewport to those values
 // and when unbinding, reset the viewport to some default value (probably the display width/height)
 
-// TODO: control shadowmap resolutions from a centralized location
-// currently they are stored on each instance of a light
-
-// TODO: render_scale other than 1 causes water reflection/refraction to break
+// TODO: directional light shadow map resolutions are still stored on each instance of the light
+// point and spot lights share the shadow atlas
 
 // TODO: print more specific errors when framebuffers fail
 
 liminal::renderer::renderer(
     GLsizei display_width, GLsizei display_height, float render_scale,
-    GLsizei reflection_width, GLsizei reflection_height,
-    GLsizei refraction_width, GLsizei refraction_height)
+    float reflection_scale)
 {
     wireframe = false;
     greyscale = false;
+    bloom = false;
+    exposure = 1.0f;
+    vignette = 0.0f;
+    gpu_culling = false;
+    occlusion_culling = false;
+    sdsm = false;
+    screen_space_reflections = false;
+    water_reflection_shadows = false;
     camera = nullptr;
     skybox = nullptr;
 
@@ -36,31 +112,35 @@ liminal::renderer::renderer(
     geometry_normal_texture_id = 0;
     geometry_albedo_texture_id = 0;
     geometry_material_texture_id = 0;
-    geometry_rbo_id = 0;
-    set_screen_size(display_width, display_height, render_scale);
-
+    geometry_depth_texture_id = 0;
+    compact_gbuffer = true;
+    hi_z_texture_id = 0;
+    hi_z_levels = 0;
+    hi_z_valid = false;
+    ssr_hi_z_texture_id = 0;
+    ssr_color_texture_id = 0;
+    bloom_texture_id = 0;
+    bloom_levels = 0;
     water_reflection_fbo_id = 0;
     water_reflection_color_texture_id = 0;
     water_reflection_rbo_id = 0;
-    set_reflection_size(reflection_width, reflection_height);
-
-    water_refraction_fbo_id = 0;
+    this->reflection_scale = reflection_scale;
     water_refraction_color_texture_id = 0;
     water_refraction_depth_texture_id = 0;
-    set_refraction_size(refraction_width, refraction_height);
+    set_screen_size(display_width, display_height, render_scale);
 
     // init OpenGL state
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-    glCullFace(GL_BACK);
-    // glEnable(GL_MULTISAMPLE);
-    // glEnable(GL_FRAMEBUFFER_SRGB);
+    liminal::gl_state::enable(GL_DEPTH_TEST);
+    liminal::gl_state::enable(GL_STENCIL_TEST);
+    liminal::gl_state::enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    liminal::gl_state::cull_face(GL_BACK);
+    // liminal::gl_state::enable(GL_MULTISAMPLE);
+    // liminal::gl_state::enable(GL_FRAMEBUFFER_SRGB);
 
     // create water mesh
     glGenVertexArrays(1, &water_vao_id);
-    glBindVertexArray(water_vao_id);
+    liminal::gl_state::bind_vertex_array(water_vao_id);
     {
         std::vector<GLfloat> water_vertices =
             {-1.0f, -1.0f,
@@ -80,11 +160,11 @@ liminal::renderer::renderer(
 
         glEnableVertexAttribArray(0);
     }
-    glBindVertexArray(0);
+    liminal::gl_state::bind_vertex_array(0);
 
     // create skybox mesh
     glGenVertexArrays(1, &skybox_vao_id);
-    glBindVertexArray(skybox_vao_id);
+    liminal::gl_state::bind_vertex_array(skybox_vao_id);
     {
         std::vector<GLfloat> skybox_vertices =
             {-1.0f, +1.0f, -1.0f,
@@ -138,11 +218,11 @@ liminal::renderer::renderer(
 
         glEnableVertexAttribArray(0);
     }
-    glBindVertexArray(0);
+    liminal::gl_state::bind_vertex_array(0);
 
     // create sprite mesh
     glGenVertexArrays(1, &sprite_vao_id);
-    glBindVertexArray(sprite_vao_id);
+    liminal::gl_state::bind_vertex_array(sprite_vao_id);
     {
         std::vector<GLfloat> sprite_vertices =
             {+0.0f, +1.0f, +0.0f, +1.0f,
@@ -164,11 +244,11 @@ liminal::renderer::renderer(
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(1);
     }
-    glBindVertexArray(0);
+    liminal::gl_state::bind_vertex_array(0);
 
     // create screen mesh
     glGenVertexArrays(1, &screen_vao_id);
-    glBindVertexArray(screen_vao_id);
+    liminal::gl_state::bind_vertex_array(screen_vao_id);
     {
         std::vector<GLfloat> screen_vertices =
             {-1.0f, -1.0f, +0.0f, +0.0f,
@@ -189,7 +269,124 @@ liminal::renderer::renderer(
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(1);
     }
-    glBindVertexArray(0);
+    liminal::gl_state::bind_vertex_array(0);
+
+    // create geometry pool
+    // every mesh is sub-allocated from here, it grows if it runs out of space
+    liminal::mesh::geometry_pool = new liminal::geometry_pool(1 << 16, 1 << 18);
+
+    // create material library
+    // meshes share materials and textures through it, their parameters are read from one buffer
+    liminal::mesh::material_library = new liminal::material_library();
+
+    // create instance buffer
+    // holds the model matrix of every object and terrain drawn this frame, indexed by gl_BaseInstance + gl_InstanceID
+    glGenBuffers(1, &instance_ssbo_id);
+    instance_ssbo_size = 0;
+    terrain_base_instance = 0;
+    instance_batches_dirty = false;
+
+    // create visible instance buffer
+    // rewritten by every pass with the instances that survived culling, indexed by gl_BaseInstance + gl_InstanceID
+    glGenBuffers(1, &visible_instance_ssbo_id);
+    visible_instance_ssbo_size = 0;
+
+    // create uniform buffers
+    // the view is rewritten by every pass, the lights once per frame, and both stay bound
+    glGenBuffers(1, &view_ubo_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, view_ubo_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(liminal::view_uniforms), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, view_ubo_id);
+
+    glGenBuffers(1, &lights_ubo_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, lights_ubo_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(liminal::lights_uniforms), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 1, lights_ubo_id);
+
+    // create light buffers
+    // every point and spot light, rewritten once per frame
+    glGenBuffers(1, &point_light_ssbo_id);
+    glGenBuffers(1, &spot_light_ssbo_id);
+
+    // create cluster buffers
+    // each cluster has a fixed range of the light index list, so assigning lights doesn't need atomics
+    glGenBuffers(1, &cluster_ssbo_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cluster_ssbo_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, NUM_CLUSTERS * 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    glGenBuffers(1, &cluster_light_index_ssbo_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cluster_light_index_ssbo_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, NUM_CLUSTERS * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, cluster_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, cluster_light_index_ssbo_id);
+    num_clustered_lights = 0;
+
+    // create depth bounds buffers
+    glGenBuffers(NUM_DEPTH_BOUNDS_BUFFERS, depth_bounds_ssbo_ids);
+    for (unsigned int i = 0; i < NUM_DEPTH_BOUNDS_BUFFERS; i++)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, depth_bounds_ssbo_ids[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        depth_bounds_fences[i] = nullptr;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    depth_bounds_index = 0;
+    depth_bounds_valid = false;
+
+    // create shadow atlases
+    // point light depth is the distance to the light over its radius, spot light depth is regular depth
+    // the static one only ever holds static casters, and is copied into the other before dynamic casters are drawn
+    GLuint *shadow_atlas_fbo_ids[] = {&shadow_atlas_fbo_id, &static_shadow_atlas_fbo_id};
+    GLuint *shadow_atlas_texture_ids[] = {&shadow_atlas_texture_id, &static_shadow_atlas_texture_id};
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        glGenFramebuffers(1, shadow_atlas_fbo_ids[i]);
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, *shadow_atlas_fbo_ids[i]);
+        {
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+
+            {
+                glGenTextures(1, shadow_atlas_texture_ids[i]);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, *shadow_atlas_texture_ids[i]);
+                {
+                    glTexImage2D(
+                        GL_TEXTURE_2D,
+                        0,
+                        GL_DEPTH_COMPONENT32F,
+                        SHADOW_ATLAS_SIZE,
+                        SHADOW_ATLAS_SIZE,
+                        0,
+                        GL_DEPTH_COMPONENT,
+                        GL_FLOAT,
+                        nullptr);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                }
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+
+                glFramebufferTexture2D(
+                    GL_FRAMEBUFFER,
+                    GL_DEPTH_ATTACHMENT,
+                    GL_TEXTURE_2D,
+                    *shadow_atlas_texture_ids[i],
+                    0);
+            }
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            {
+                std::cerr << "Error: Failed to create shadow atlas framebuffer" << std::endl;
+            }
+        }
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+    }
+    num_shadow_tiles = 0;
+    frame_index = 0;
+    shadow_scale = 1.0f;
 
     // create brdf texture
     {
@@ -199,11 +396,11 @@ liminal::renderer::renderer(
         GLuint capture_rbo_id;
 
         glGenFramebuffers(1, &capture_fbo_id);
-        glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
         {
             {
                 glGenTextures(1, &brdf_texture_id);
-                glBindTexture(GL_TEXTURE_2D, brdf_texture_id);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, brdf_texture_id);
                 {
                     glTexImage2D(
                         GL_TEXTURE_2D,
@@ -220,7 +417,7 @@ liminal::renderer::renderer(
                     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
                     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
                 }
-                glBindTexture(GL_TEXTURE_2D, 0);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
                 glFramebufferTexture2D(
                     GL_FRAMEBUFFER,
@@ -255,31 +452,31 @@ liminal::renderer::renderer(
                 return;
             }
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
         liminal::program *brdf_program = new liminal::program(
             "assets/shaders/brdf.vs",
             "assets/shaders/brdf.fs");
 
-        glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
         {
-            glViewport(0, 0, brdf_size, brdf_size);
+            liminal::gl_state::viewport(0, 0, brdf_size, brdf_size);
 
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             brdf_program->bind();
             {
-                glBindVertexArray(screen_vao_id);
+                liminal::gl_state::bind_vertex_array(screen_vao_id);
                 glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-                glBindVertexArray(0);
+                liminal::gl_state::bind_vertex_array(0);
             }
             brdf_program->unbind();
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
         delete brdf_program;
 
-        glDeleteFramebuffers(1, &capture_fbo_id);
+        liminal::gl_state::delete_framebuffers(1, &capture_fbo_id);
         glDeleteRenderbuffers(1, &capture_rbo_id);
     }
 
@@ -290,14 +487,47 @@ liminal::renderer::renderer(
     depth_skinned_mesh_program = new liminal::program(
         "assets/shaders/depth_skinned_mesh.vs",
         "assets/shaders/depth.fs");
-    depth_cube_mesh_program = new liminal::program(
-        "assets/shaders/depth_cube_mesh.vs",
-        "assets/shaders/depth_cube.gs",
-        "assets/shaders/depth_cube.fs");
-    depth_cube_skinned_mesh_program = new liminal::program(
-        "assets/shaders/depth_cube_skinned_mesh.vs",
-        "assets/shaders/depth_cube.gs",
-        "assets/shaders/depth_cube.fs");
+    // where the vertex shader can pick the viewport, the geometry shader is left out
+    if (GLEW_ARB_shader_viewport_layer_array)
+    {
+        depth_cube_mesh_program = new liminal::program(
+            "assets/shaders/depth_cube_mesh.vs",
+            "assets/shaders/depth_cube.fs");
+        depth_cube_skinned_mesh_program = new liminal::program(
+            "assets/shaders/depth_cube_skinned_mesh.vs",
+            "assets/shaders/depth_cube.fs");
+    }
+    else
+    {
+        depth_cube_mesh_program = new liminal::program(
+            "assets/shaders/depth_cube_mesh.vs",
+            "assets/shaders/depth_cube.gs",
+            "assets/shaders/depth_cube.fs");
+        depth_cube_skinned_mesh_program = new liminal::program(
+            "assets/shaders/depth_cube_skinned_mesh.vs",
+            "assets/shaders/depth_cube.gs",
+            "assets/shaders/depth_cube.fs");
+    }
+    if (GLEW_ARB_shader_viewport_layer_array)
+    {
+        depth_cascade_mesh_program = new liminal::program(
+            "assets/shaders/depth_cascade_mesh.vs",
+            "assets/shaders/depth.fs");
+        depth_cascade_skinned_mesh_program = new liminal::program(
+            "assets/shaders/depth_cascade_skinned_mesh.vs",
+            "assets/shaders/depth.fs");
+    }
+    else
+    {
+        depth_cascade_mesh_program = new liminal::program(
+            "assets/shaders/depth_cascade_mesh.vs",
+            "assets/shaders/depth_cascade.gs",
+            "assets/shaders/depth.fs");
+        depth_cascade_skinned_mesh_program = new liminal::program(
+            "assets/shaders/depth_cascade_skinned_mesh.vs",
+            "assets/shaders/depth_cascade.gs",
+            "assets/shaders/depth.fs");
+    }
     color_program = new liminal::program(
         "assets/shaders/color.vs",
         "assets/shaders/color.fs");
@@ -322,6 +552,12 @@ liminal::renderer::renderer(
     deferred_spot_program = new liminal::program(
         "assets/shaders/deferred.vs",
         "assets/shaders/deferred_spot.fs");
+    deferred_clustered_program = new liminal::program(
+        "assets/shaders/deferred.vs",
+        "assets/shaders/deferred_clustered.fs");
+    ssr_program = new liminal::program(
+        "assets/shaders/deferred.vs",
+        "assets/shaders/ssr.fs");
     skybox_program = new liminal::program(
         "assets/shaders/skybox.vs",
         "assets/shaders/skybox.fs");
@@ -331,15 +567,31 @@ liminal::renderer::renderer(
     sprite_program = new liminal::program(
         "assets/shaders/sprite.vs",
         "assets/shaders/sprite.fs");
-    gaussian_program = new liminal::program(
-        "assets/shaders/gaussian.vs",
-        "assets/shaders/gaussian.fs");
-    screen_program = new liminal::program(
-        "assets/shaders/screen.vs",
-        "assets/shaders/screen.fs");
+    cull_instances_program = new liminal::program("assets/shaders/cull_instances.cs");
+    compact_draws_program = new liminal::program("assets/shaders/compact_draws.cs");
+    hi_z_program = new liminal::program("assets/shaders/hi_z.cs");
+    depth_bounds_program = new liminal::program("assets/shaders/depth_bounds.cs");
+    bloom_downsample_program = new liminal::program("assets/shaders/bloom_downsample.cs");
+    bloom_upsample_program = new liminal::program("assets/shaders/bloom_upsample.cs");
+    color_lut_program = new liminal::program("assets/shaders/color_lut.cs");
+    cluster_lights_program = new liminal::program("assets/shaders/cluster_lights.cs");
 
     setup_samplers();
 
+    // setup color grading lut, only baked once there is some grading to do
+    glGenTextures(1, &color_lut_texture_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_3D, color_lut_texture_id);
+    {
+        glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA8, COLOR_LUT_SIZE, COLOR_LUT_SIZE, COLOR_LUT_SIZE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    liminal::gl_state::bind_texture(GL_TEXTURE_3D, 0);
+    color_grading_enabled = false;
+
     // create water textures
     water_dudv_texture = new liminal::texture("assets/images/water_dudv.png");
     water_normal_texture = new liminal::texture("assets/images/water_normal.png");
@@ -397,54 +649,77 @@ liminal::renderer::renderer(
             }
         }
 
-        std::vector<std::vector<liminal::texture *>> textures;
-
-        DEBUG_sphere_mesh = new liminal::mesh(vertices, indices, textures);
+        DEBUG_sphere_mesh = new liminal::mesh(vertices, indices);
     }
 }
 
 liminal::renderer::~renderer()
 {
-    glDeleteFramebuffers(1, &geometry_fbo_id);
-    glDeleteTextures(1, &geometry_position_texture_id);
-    glDeleteTextures(1, &geometry_normal_texture_id);
-    glDeleteTextures(1, &geometry_albedo_texture_id);
-    glDeleteTextures(1, &geometry_material_texture_id);
-    glDeleteRenderbuffers(1, &geometry_rbo_id);
-
-    glDeleteFramebuffers(1, &hdr_fbo_id);
-    glDeleteTextures(2, hdr_texture_ids);
+    liminal::gl_state::delete_framebuffers(1, &geometry_fbo_id);
+    liminal::gl_state::delete_textures(1, &geometry_position_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_normal_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_albedo_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_material_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_depth_texture_id);
+    liminal::gl_state::delete_textures(1, &hi_z_texture_id);
+    liminal::gl_state::delete_textures(1, &ssr_hi_z_texture_id);
+    liminal::gl_state::delete_textures(1, &ssr_color_texture_id);
+
+    liminal::gl_state::delete_framebuffers(1, &hdr_fbo_id);
+    liminal::gl_state::delete_textures(2, hdr_texture_ids);
     glDeleteRenderbuffers(1, &hdr_rbo_id);
 
-    glDeleteFramebuffers(1, &water_reflection_fbo_id);
+    liminal::gl_state::delete_framebuffers(1, &water_reflection_fbo_id);
     glDeleteRenderbuffers(1, &water_reflection_rbo_id);
-    glDeleteTextures(1, &water_reflection_color_texture_id);
+    liminal::gl_state::delete_textures(1, &water_reflection_color_texture_id);
+
+    liminal::gl_state::delete_textures(1, &water_refraction_color_texture_id);
+    liminal::gl_state::delete_textures(1, &water_refraction_depth_texture_id);
+
+    for (auto it = water_query_ids.begin(); it != water_query_ids.end(); it++)
+    {
+        glDeleteQueries(1, &it->second);
+    }
 
-    glDeleteFramebuffers(1, &water_refraction_fbo_id);
-    glDeleteTextures(1, &water_refraction_color_texture_id);
-    glDeleteTextures(1, &water_refraction_depth_texture_id);
+    liminal::gl_state::delete_textures(1, &bloom_texture_id);
 
-    glDeleteFramebuffers(2, bloom_fbo_ids);
-    glDeleteTextures(2, bloom_texture_ids);
+    liminal::gl_state::delete_textures(1, &color_lut_texture_id);
 
-    glDeleteVertexArrays(1, &water_vao_id);
+    liminal::gl_state::delete_vertex_arrays(1, &water_vao_id);
     glDeleteBuffers(1, &water_vbo_id);
 
-    glDeleteVertexArrays(1, &skybox_vao_id);
+    liminal::gl_state::delete_vertex_arrays(1, &skybox_vao_id);
     glDeleteBuffers(1, &skybox_vbo_id);
 
-    glDeleteVertexArrays(1, &sprite_vao_id);
+    liminal::gl_state::delete_vertex_arrays(1, &sprite_vao_id);
     glDeleteBuffers(1, &sprite_vbo_id);
 
-    glDeleteVertexArrays(1, &screen_vao_id);
+    liminal::gl_state::delete_vertex_arrays(1, &screen_vao_id);
     glDeleteBuffers(1, &screen_vbo_id);
 
-    glDeleteTextures(1, &brdf_texture_id);
-
+    liminal::gl_state::delete_textures(1, &brdf_texture_id);
+
+    liminal::gl_state::delete_framebuffers(1, &shadow_atlas_fbo_id);
+    liminal::gl_state::delete_textures(1, &shadow_atlas_texture_id);
+    liminal::gl_state::delete_framebuffers(1, &static_shadow_atlas_fbo_id);
+    liminal::gl_state::delete_textures(1, &static_shadow_atlas_texture_id);
+
+    glDeleteBuffers(1, &instance_ssbo_id);
+    glDeleteBuffers(1, &visible_instance_ssbo_id);
+    glDeleteBuffers(1, &view_ubo_id);
+    glDeleteBuffers(1, &lights_ubo_id);
+    glDeleteBuffers(1, &point_light_ssbo_id);
+    glDeleteBuffers(1, &spot_light_ssbo_id);
+    glDeleteBuffers(1, &cluster_ssbo_id);
+    glDeleteBuffers(1, &cluster_light_index_ssbo_id);
+    clear_depth_bounds();
+    glDeleteBuffers(NUM_DEPTH_BOUNDS_BUFFERS, depth_bounds_ssbo_ids);
     delete depth_mesh_program;
     delete depth_skinned_mesh_program;
     delete depth_cube_mesh_program;
     delete depth_cube_skinned_mesh_program;
+    delete depth_cascade_mesh_program;
+    delete depth_cascade_skinned_mesh_program;
     delete color_program;
     delete geometry_mesh_program;
     delete geometry_skinned_mesh_program;
@@ -453,41 +728,98 @@ liminal::renderer::~renderer()
     delete deferred_directional_program;
     delete deferred_point_program;
     delete deferred_spot_program;
+    delete deferred_clustered_program;
+    delete ssr_program;
     delete skybox_program;
     delete water_program;
     delete sprite_program;
-    delete gaussian_program;
-    delete screen_program;
+    for (auto it = screen_programs.begin(); it != screen_programs.end(); it++)
+    {
+        delete it->second;
+    }
+    delete cull_instances_program;
+    delete compact_draws_program;
+    delete hi_z_program;
+    delete depth_bounds_program;
+    delete bloom_downsample_program;
+    delete bloom_upsample_program;
+    delete color_lut_program;
+    delete cluster_lights_program;
 
     delete water_dudv_texture;
     delete water_normal_texture;
 
     delete DEBUG_sphere_mesh;
+
+    delete liminal::mesh::geometry_pool;
+    liminal::mesh::geometry_pool = nullptr;
+
+    delete liminal::mesh::material_library;
+    liminal::mesh::material_library = nullptr;
 }
 
 void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_height, float render_scale)
 {
     this->display_width = display_width;
     this->display_height = display_height;
+    this->render_scale = render_scale;
     render_width = (GLsizei)(display_width * render_scale);
     render_height = (GLsizei)(display_height * render_scale);
 
-    glDeleteFramebuffers(1, &geometry_fbo_id);
-    glDeleteTextures(1, &geometry_position_texture_id);
-    glDeleteTextures(1, &geometry_normal_texture_id);
-    glDeleteTextures(1, &geometry_albedo_texture_id);
-    glDeleteTextures(1, &geometry_material_texture_id);
-    glDeleteRenderbuffers(1, &geometry_rbo_id);
-
-    glDeleteFramebuffers(1, &hdr_fbo_id);
-    glDeleteTextures(2, hdr_texture_ids);
+    liminal::gl_state::delete_framebuffers(1, &geometry_fbo_id);
+    liminal::gl_state::delete_textures(1, &geometry_position_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_normal_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_albedo_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_material_texture_id);
+    liminal::gl_state::delete_textures(1, &geometry_depth_texture_id);
+    liminal::gl_state::delete_textures(1, &hi_z_texture_id);
+    liminal::gl_state::delete_textures(1, &ssr_hi_z_texture_id);
+    liminal::gl_state::delete_textures(1, &ssr_color_texture_id);
+    geometry_position_texture_id = 0; // the compact layout has none
+
+    liminal::gl_state::delete_framebuffers(1, &hdr_fbo_id);
+    liminal::gl_state::delete_textures(2, hdr_texture_ids);
     glDeleteRenderbuffers(1, &hdr_rbo_id);
 
-    glDeleteFramebuffers(2, bloom_fbo_ids);
-    glDeleteTextures(2, bloom_texture_ids);
+    liminal::gl_state::delete_textures(1, &bloom_texture_id);
+
+    liminal::gl_state::delete_textures(1, &water_refraction_color_texture_id);
+    liminal::gl_state::delete_textures(1, &water_refraction_depth_texture_id);
+
+    // setup water refraction textures
+    // copies of the camera pass's color and depth, taken before water is drawn over them
+    // formats have to match the hdr and depth textures for the copy
+    GLenum water_refraction_formats[] = {GL_RGBA16F, GL_DEPTH_COMPONENT32F};
+    GLenum water_refraction_pixel_formats[] = {GL_RGBA, GL_DEPTH_COMPONENT};
+    GLuint *water_refraction_texture_ids[] = {&water_refraction_color_texture_id, &water_refraction_depth_texture_id};
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        glGenTextures(1, water_refraction_texture_ids[i]);
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, *water_refraction_texture_ids[i]);
+        {
+            glTexImage2D(
+                GL_TEXTURE_2D,
+                0,
+                water_refraction_formats[i],
+                render_width,
+                render_height,
+                0,
+                water_refraction_pixel_formats[i],
+                GL_FLOAT,
+                nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    }
+
+    // the reflection is a fraction of the render size
+    set_reflection_scale(reflection_scale);
 
     // setup geometry fbo
-    // gbuffer:
+    // gbuffer, full layout:
     //      position - rgb16f
     //      normal - rgb16f
     //      albedo - rgb16f
@@ -496,12 +828,18 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
     //          roughness - g
     //          occlusion - b
     //          height - a
+    // compact layout, a third of the bytes per pixel:
+    //      position - none, reconstructed from depth
+    //      normal - rg16, octahedral
+    //      albedo - srgb8_alpha8
+    //      material - rgba8
     glGenFramebuffers(1, &geometry_fbo_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, geometry_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, geometry_fbo_id);
     {
+        if (!compact_gbuffer)
         {
             glGenTextures(1, &geometry_position_texture_id);
-            glBindTexture(GL_TEXTURE_2D, geometry_position_texture_id);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_position_texture_id);
             {
                 glTexImage2D(
                     GL_TEXTURE_2D,
@@ -516,7 +854,7 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
             glFramebufferTexture2D(
                 GL_FRAMEBUFFER,
@@ -528,22 +866,22 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
 
         {
             glGenTextures(1, &geometry_normal_texture_id);
-            glBindTexture(GL_TEXTURE_2D, geometry_normal_texture_id);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_normal_texture_id);
             {
                 glTexImage2D(
                     GL_TEXTURE_2D,
                     0,
-                    GL_RGB16F,
+                    compact_gbuffer ? GL_RG16 : GL_RGB16F,
                     render_width,
                     render_height,
                     0,
-                    GL_RGB,
-                    GL_FLOAT,
+                    compact_gbuffer ? GL_RG : GL_RGB,
+                    compact_gbuffer ? GL_UNSIGNED_SHORT : GL_FLOAT,
                     nullptr);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
             glFramebufferTexture2D(
                 GL_FRAMEBUFFER,
@@ -555,22 +893,22 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
 
         {
             glGenTextures(1, &geometry_albedo_texture_id);
-            glBindTexture(GL_TEXTURE_2D, geometry_albedo_texture_id);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_albedo_texture_id);
             {
                 glTexImage2D(
                     GL_TEXTURE_2D,
                     0,
-                    GL_RGB16F,
+                    compact_gbuffer ? GL_SRGB8_ALPHA8 : GL_RGB16F,
                     render_width,
                     render_height,
                     0,
-                    GL_RGB,
-                    GL_FLOAT,
+                    compact_gbuffer ? GL_RGBA : GL_RGB,
+                    compact_gbuffer ? GL_UNSIGNED_BYTE : GL_FLOAT,
                     nullptr);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
             glFramebufferTexture2D(
                 GL_FRAMEBUFFER,
@@ -582,22 +920,22 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
 
         {
             glGenTextures(1, &geometry_material_texture_id);
-            glBindTexture(GL_TEXTURE_2D, geometry_material_texture_id);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_material_texture_id);
             {
                 glTexImage2D(
                     GL_TEXTURE_2D,
                     0,
-                    GL_RGBA16F,
+                    compact_gbuffer ? GL_RGBA8 : GL_RGBA16F,
                     render_width,
                     render_height,
                     0,
                     GL_RGBA,
-                    GL_FLOAT,
+                    compact_gbuffer ? GL_UNSIGNED_BYTE : GL_FLOAT,
                     nullptr);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
             glFramebufferTexture2D(
                 GL_FRAMEBUFFER,
@@ -608,27 +946,37 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
         }
 
         {
-            glGenRenderbuffers(1, &geometry_rbo_id);
-            glBindRenderbuffer(GL_RENDERBUFFER, geometry_rbo_id);
+            // a texture instead of a renderbuffer so the hi-z pyramid can be built from it
+            glGenTextures(1, &geometry_depth_texture_id);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_depth_texture_id);
             {
-                glRenderbufferStorage(
-                    GL_RENDERBUFFER,
-                    GL_DEPTH_COMPONENT,
+                glTexImage2D(
+                    GL_TEXTURE_2D,
+                    0,
+                    GL_DEPTH_COMPONENT32F,
                     render_width,
-                    render_height);
+                    render_height,
+                    0,
+                    GL_DEPTH_COMPONENT,
+                    GL_FLOAT,
+                    nullptr);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             }
-            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
-            glFramebufferRenderbuffer(
+            glFramebufferTexture2D(
                 GL_FRAMEBUFFER,
                 GL_DEPTH_ATTACHMENT,
-                GL_RENDERBUFFER,
-                geometry_rbo_id);
+                GL_TEXTURE_2D,
+                geometry_depth_texture_id,
+                0);
         }
 
         {
+            // the geometry programs write the position to location 0 either way, the compact layout drops it
             GLenum geometry_color_attachments[] = {
-                GL_COLOR_ATTACHMENT0,
+                compact_gbuffer ? GL_NONE : GL_COLOR_ATTACHMENT0,
                 GL_COLOR_ATTACHMENT1,
                 GL_COLOR_ATTACHMENT2,
                 GL_COLOR_ATTACHMENT3};
@@ -641,17 +989,56 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
             return;
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+    // setup hi-z pyramid
+    // every texel holds the farthest depth of the texels it covers in the level below
+    hi_z_levels = 1;
+    while ((render_width >> hi_z_levels) > 0 || (render_height >> hi_z_levels) > 0)
+    {
+        hi_z_levels++;
+    }
+    glGenTextures(1, &hi_z_texture_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, hi_z_texture_id);
+    {
+        glTexStorage2D(GL_TEXTURE_2D, hi_z_levels, GL_R32F, render_width, render_height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    hi_z_valid = false;
+
+    // setup screen space reflection targets
+    // the same pyramid with the nearest depth instead, and a copy of the lit image whose mips blur rough reflections
+    GLuint *ssr_texture_ids[] = {&ssr_hi_z_texture_id, &ssr_color_texture_id};
+    GLenum ssr_formats[] = {GL_R32F, GL_RGBA16F};
+    GLenum ssr_min_filters[] = {GL_NEAREST_MIPMAP_NEAREST, GL_LINEAR_MIPMAP_LINEAR};
+    GLenum ssr_mag_filters[] = {GL_NEAREST, GL_LINEAR};
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        glGenTextures(1, ssr_texture_ids[i]);
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, *ssr_texture_ids[i]);
+        {
+            glTexStorage2D(GL_TEXTURE_2D, hi_z_levels, ssr_formats[i], render_width, render_height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, ssr_min_filters[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, ssr_mag_filters[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    }
 
     // setup hdr fbo
     glGenFramebuffers(1, &hdr_fbo_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
     {
         {
             glGenTextures(2, hdr_texture_ids);
             for (unsigned int i = 0; i < 2; i++)
             {
-                glBindTexture(GL_TEXTURE_2D, hdr_texture_ids[i]);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, hdr_texture_ids[i]);
                 {
                     glTexImage2D(
                         GL_TEXTURE_2D,
@@ -668,7 +1055,7 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
                     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
                     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
                 }
-                glBindTexture(GL_TEXTURE_2D, 0);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
                 glFramebufferTexture2D(
                     GL_FRAMEBUFFER,
@@ -683,11 +1070,12 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
             glGenRenderbuffers(1, &hdr_rbo_id);
             glBindRenderbuffer(GL_RENDERBUFFER, hdr_rbo_id);
             {
+                // same format and size as the gbuffer depth, which is blitted into it
                 glRenderbufferStorage(
                     GL_RENDERBUFFER,
-                    GL_DEPTH_STENCIL,
-                    display_width,
-                    display_height);
+                    GL_DEPTH_COMPONENT32F,
+                    render_width,
+                    render_height);
             }
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
@@ -711,69 +1099,54 @@ void liminal::renderer::set_screen_size(GLsizei display_width, GLsizei display_h
             return;
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
-    // setup bloom fbo
-    glGenFramebuffers(2, bloom_fbo_ids);
-    glGenTextures(2, bloom_texture_ids);
-    for (unsigned int i = 0; i < 2; i++)
+    // setup bloom mip chain
+    // half the render size at the top, each level is downsampled from the one above it and then gets the one below it added back on
+    bloom_levels = 1;
+    while (bloom_levels < MAX_BLOOM_LEVELS && ((render_width >> (bloom_levels + 1)) > 0 || (render_height >> (bloom_levels + 1)) > 0))
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, bloom_fbo_ids[i]);
-        {
-            {
-                glBindTexture(GL_TEXTURE_2D, bloom_texture_ids[i]);
-                {
-                    glTexImage2D(
-                        GL_TEXTURE_2D,
-                        0,
-                        GL_RGBA16F,
-                        display_width / 8,
-                        display_height / 8,
-                        0,
-                        GL_RGBA,
-                        GL_FLOAT,
-                        NULL);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                }
-                glBindTexture(GL_TEXTURE_2D, 0);
-
-                glFramebufferTexture2D(
-                    GL_FRAMEBUFFER,
-                    GL_COLOR_ATTACHMENT0,
-                    GL_TEXTURE_2D,
-                    bloom_texture_ids[i],
-                    0);
-            }
+        bloom_levels++;
+    }
+    glGenTextures(1, &bloom_texture_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, bloom_texture_id);
+    {
+        glTexStorage2D(GL_TEXTURE_2D, bloom_levels, GL_R11F_G11F_B10F, std::max(render_width / 2, 1), std::max(render_height / 2, 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+}
 
-            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            {
-                std::cerr << "Error: Failed to create bloom framebuffer" << std::endl;
-                return;
-            }
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void liminal::renderer::set_compact_gbuffer(bool compact_gbuffer)
+{
+    if (this->compact_gbuffer != compact_gbuffer)
+    {
+        this->compact_gbuffer = compact_gbuffer;
+        set_screen_size(display_width, display_height, render_scale);
     }
 }
 
-void liminal::renderer::set_reflection_size(GLsizei reflection_width, GLsizei reflection_height)
+void liminal::renderer::set_reflection_scale(float reflection_scale)
 {
-    this->reflection_width = reflection_width;
-    this->reflection_height = reflection_height;
+    // the reflection is drawn into a corner of the gbuffer, so it can't be any bigger
+    this->reflection_scale = glm::clamp(reflection_scale, 0.0f, 1.0f);
+    reflection_width = std::max((GLsizei)(render_width * this->reflection_scale), 1);
+    reflection_height = std::max((GLsizei)(render_height * this->reflection_scale), 1);
 
-    glDeleteFramebuffers(1, &water_reflection_fbo_id);
-    glDeleteTextures(1, &water_reflection_color_texture_id);
+    liminal::gl_state::delete_framebuffers(1, &water_reflection_fbo_id);
+    liminal::gl_state::delete_textures(1, &water_reflection_color_texture_id);
     glDeleteRenderbuffers(1, &water_reflection_rbo_id);
 
     // setup water reflection fbo
     glGenFramebuffers(1, &water_reflection_fbo_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, water_reflection_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, water_reflection_fbo_id);
     {
         {
             glGenTextures(1, &water_reflection_color_texture_id);
-            glBindTexture(GL_TEXTURE_2D, water_reflection_color_texture_id);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, water_reflection_color_texture_id);
             {
                 glTexImage2D(
                     GL_TEXTURE_2D,
@@ -788,7 +1161,7 @@ void liminal::renderer::set_reflection_size(GLsizei reflection_width, GLsizei re
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
             glFramebufferTexture2D(
                 GL_FRAMEBUFFER,
@@ -802,9 +1175,10 @@ void liminal::renderer::set_reflection_size(GLsizei reflection_width, GLsizei re
             glGenRenderbuffers(1, &water_reflection_rbo_id);
             glBindRenderbuffer(GL_RENDERBUFFER, water_reflection_rbo_id);
             {
+                // same format as the gbuffer depth, which is blitted into it
                 glRenderbufferStorage(
                     GL_RENDERBUFFER,
-                    GL_DEPTH_COMPONENT,
+                    GL_DEPTH_COMPONENT32F,
                     reflection_width,
                     reflection_height);
             }
@@ -823,85 +1197,48 @@ void liminal::renderer::set_reflection_size(GLsizei reflection_width, GLsizei re
             return;
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void liminal::renderer::set_refraction_size(GLsizei refraction_width, GLsizei refraction_height)
+void liminal::renderer::set_shadow_scale(float shadow_scale)
 {
-    this->refraction_width = refraction_width;
-    this->refraction_height = refraction_height;
-
-    glDeleteFramebuffers(1, &water_refraction_fbo_id);
-    glDeleteTextures(1, &water_refraction_color_texture_id);
-    glDeleteTextures(1, &water_refraction_depth_texture_id);
-
-    // setup water refraction fbo
-    glGenFramebuffers(1, &water_refraction_fbo_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, water_refraction_fbo_id);
-    {
-        {
-            glGenTextures(1, &water_refraction_color_texture_id);
-            glBindTexture(GL_TEXTURE_2D, water_refraction_color_texture_id);
-            {
-                glTexImage2D(
-                    GL_TEXTURE_2D,
-                    0,
-                    GL_RGBA16F,
-                    refraction_width,
-                    refraction_height,
-                    0,
-                    GL_RGBA,
-                    GL_FLOAT,
-                    nullptr);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            }
-            glBindTexture(GL_TEXTURE_2D, 0);
+    // tiles are handed out again every frame, lights whose tile changes size redraw their shadows
+    this->shadow_scale = glm::clamp(shadow_scale, 0.0f, 1.0f);
+}
 
-            glFramebufferTexture2D(
-                GL_FRAMEBUFFER,
-                GL_COLOR_ATTACHMENT0,
-                GL_TEXTURE_2D,
-                water_refraction_color_texture_id,
-                0);
-        }
+liminal::renderer::color_grading::color_grading()
+    : contrast(1.0f),
+      saturation(1.0f),
+      color_filter(1.0f)
+{
+}
 
-        {
-            glGenTextures(1, &water_refraction_depth_texture_id);
-            glBindTexture(GL_TEXTURE_2D, water_refraction_depth_texture_id);
-            {
-                glTexImage2D(
-                    GL_TEXTURE_2D,
-                    0,
-                    GL_DEPTH_COMPONENT,
-                    refraction_width,
-                    refraction_height,
-                    0,
-                    GL_DEPTH_COMPONENT,
-                    GL_FLOAT,
-                    nullptr);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            }
-            glBindTexture(GL_TEXTURE_2D, 0);
+bool liminal::renderer::color_grading::is_identity() const
+{
+    return contrast == 1.0f && saturation == 1.0f && color_filter == glm::vec3(1.0f);
+}
 
-            glFramebufferTexture2D(
-                GL_FRAMEBUFFER,
-                GL_DEPTH_ATTACHMENT,
-                GL_TEXTURE_2D,
-                water_refraction_depth_texture_id,
-                0);
-        }
+void liminal::renderer::set_color_grading(const liminal::renderer::color_grading &color_grading)
+{
+    // the screen pass is compiled without the lookup when there's nothing to grade
+    color_grading_enabled = !color_grading.is_identity();
+    if (!color_grading_enabled)
+    {
+        return;
+    }
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        {
-            std::cerr << "Error: Failed to create water refraction framebuffer" << std::endl;
-            return;
-        }
+    color_lut_program->bind();
+    {
+        color_lut_program->set_float("contrast", color_grading.contrast);
+        color_lut_program->set_float("saturation", color_grading.saturation);
+        color_lut_program->set_vec3("color_filter", color_grading.color_filter);
+
+        glBindImageTexture(0, color_lut_texture_id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute((COLOR_LUT_SIZE + 3) / 4, (COLOR_LUT_SIZE + 3) / 4, (COLOR_LUT_SIZE + 3) / 4);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    color_lut_program->unbind();
 }
 
 void liminal::renderer::reload_programs()
@@ -910,6 +1247,8 @@ void liminal::renderer::reload_programs()
     depth_skinned_mesh_program->reload();
     depth_cube_mesh_program->reload();
     depth_cube_skinned_mesh_program->reload();
+    depth_cascade_mesh_program->reload();
+    depth_cascade_skinned_mesh_program->reload();
     color_program->reload();
     geometry_mesh_program->reload();
     geometry_skinned_mesh_program->reload();
@@ -918,11 +1257,23 @@ void liminal::renderer::reload_programs()
     deferred_directional_program->reload();
     deferred_point_program->reload();
     deferred_spot_program->reload();
+    deferred_clustered_program->reload();
+    ssr_program->reload();
     skybox_program->reload();
     water_program->reload();
     sprite_program->reload();
-    gaussian_program->reload();
-    screen_program->reload();
+    for (auto it = screen_programs.begin(); it != screen_programs.end(); it++)
+    {
+        it->second->reload();
+    }
+    cull_instances_program->reload();
+    compact_draws_program->reload();
+    hi_z_program->reload();
+    depth_bounds_program->reload();
+    bloom_downsample_program->reload();
+    bloom_upsample_program->reload();
+    color_lut_program->reload();
+    cluster_lights_program->reload();
 
     setup_samplers();
 }
@@ -968,6 +1319,7 @@ void liminal::renderer::setup_samplers()
         deferred_ambient_program->set_int("geometry.normal_map", 1);
         deferred_ambient_program->set_int("geometry.albedo_map", 2);
         deferred_ambient_program->set_int("geometry.material_map", 3);
+        deferred_ambient_program->set_int("geometry.depth_map", 7);
         deferred_ambient_program->set_int("skybox.irradiance_cubemap", 4);
         deferred_ambient_program->set_int("skybox.prefilter_cubemap", 5);
         deferred_ambient_program->set_int("brdf_map", 6);
@@ -980,7 +1332,8 @@ void liminal::renderer::setup_samplers()
         deferred_directional_program->set_int("geometry.normal_map", 1);
         deferred_directional_program->set_int("geometry.albedo_map", 2);
         deferred_directional_program->set_int("geometry.material_map", 3);
-        deferred_directional_program->set_int("light.depth_map", 4);
+        deferred_directional_program->set_int("geometry.depth_map", 7);
+        deferred_directional_program->set_int("light_depth_map", 4);
     }
     deferred_directional_program->unbind();
 
@@ -990,7 +1343,8 @@ void liminal::renderer::setup_samplers()
         deferred_point_program->set_int("geometry.normal_map", 1);
         deferred_point_program->set_int("geometry.albedo_map", 2);
         deferred_point_program->set_int("geometry.material_map", 3);
-        deferred_point_program->set_int("light.depth_cubemap", 4);
+        deferred_point_program->set_int("geometry.depth_map", 7);
+        deferred_point_program->set_int("shadow_atlas", 4);
     }
     deferred_point_program->unbind();
 
@@ -1000,10 +1354,35 @@ void liminal::renderer::setup_samplers()
         deferred_spot_program->set_int("geometry.normal_map", 1);
         deferred_spot_program->set_int("geometry.albedo_map", 2);
         deferred_spot_program->set_int("geometry.material_map", 3);
-        deferred_spot_program->set_int("light.depth_map", 4);
+        deferred_spot_program->set_int("geometry.depth_map", 7);
+        deferred_spot_program->set_int("shadow_atlas", 4);
     }
     deferred_spot_program->unbind();
 
+    deferred_clustered_program->bind();
+    {
+        deferred_clustered_program->set_int("geometry.position_map", 0);
+        deferred_clustered_program->set_int("geometry.normal_map", 1);
+        deferred_clustered_program->set_int("geometry.albedo_map", 2);
+        deferred_clustered_program->set_int("geometry.material_map", 3);
+        deferred_clustered_program->set_int("geometry.depth_map", 7);
+    }
+    deferred_clustered_program->unbind();
+
+    ssr_program->bind();
+    {
+        ssr_program->set_int("geometry.position_map", 0);
+        ssr_program->set_int("geometry.normal_map", 1);
+        ssr_program->set_int("geometry.albedo_map", 2);
+        ssr_program->set_int("geometry.material_map", 3);
+        ssr_program->set_int("geometry.depth_map", 7);
+        ssr_program->set_int("hi_z_map", 4);
+        ssr_program->set_int("color_map", 5);
+        ssr_program->set_int("prefilter_cubemap", 6);
+        ssr_program->set_int("brdf_map", 8);
+    }
+    ssr_program->unbind();
+
     skybox_program->bind();
     {
         skybox_program->set_int("skybox.environment_cubemap", 0);
@@ -1017,6 +1396,8 @@ void liminal::renderer::setup_samplers()
         water_program->set_int("water.depth_map", 2);
         water_program->set_int("water.dudv_map", 3);
         water_program->set_int("water.normal_map", 4);
+        water_program->set_int("hi_z_map", 5);
+        water_program->set_int("environment_cubemap", 6);
     }
     water_program->unbind();
 
@@ -1026,477 +1407,1621 @@ void liminal::renderer::setup_samplers()
     }
     sprite_program->unbind();
 
-    gaussian_program->bind();
+    for (auto it = screen_programs.begin(); it != screen_programs.end(); it++)
+    {
+        set_screen_samplers(it->second);
+    }
+
+    cull_instances_program->bind();
+    {
+        cull_instances_program->set_int("hi_z_map", 0);
+    }
+    cull_instances_program->unbind();
+
+    hi_z_program->bind();
+    {
+        hi_z_program->set_int("input_map", 0);
+    }
+    hi_z_program->unbind();
+
+    depth_bounds_program->bind();
+    {
+        depth_bounds_program->set_int("depth_map", 0);
+    }
+    depth_bounds_program->unbind();
+
+    bloom_downsample_program->bind();
     {
-        gaussian_program->set_int("image", 0);
+        bloom_downsample_program->set_int("input_map", 0);
     }
-    gaussian_program->unbind();
+    bloom_downsample_program->unbind();
 
-    screen_program->bind();
+    bloom_upsample_program->bind();
     {
-        screen_program->set_int("hdr_map", 0);
-        screen_program->set_int("bloom_map", 1);
+        bloom_upsample_program->set_int("input_map", 0);
     }
-    screen_program->unbind();
+    bloom_upsample_program->unbind();
 }
 
 void liminal::renderer::flush(unsigned int current_time, float delta_time)
 {
+    liminal::gl_state::reset_counters();
+
     if (!camera)
     {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         return;
     }
 
-    // update animations
-    for (auto &object : objects)
+    stats.clear();
+
+    profiler.begin_frame();
+
+    // regroup objects if the scene changed
+    if (instance_batches_dirty)
+    {
+        update_instance_batches();
+    }
+
+    // update animations, once for every model that has them
+    for (auto &batch : instance_batches)
     {
-        if (object->model->has_animations())
+        if (batch.model->has_animations())
         {
-            object->model->update_bone_transformations(current_time);
+            batch.model->update_bone_transformations(current_time);
         }
     }
 
+    // upload model matrices that changed, after noting which static casters they affect
+    update_static_objects();
+    update_instances();
+
+    // upload every light once, passes only select one by index
+    update_lights();
+
+    // upload materials loaded since the last frame
+    liminal::mesh::material_library->update();
+
     // render everything
+    profiler.begin("shadows");
     render_shadows();
-    render_objects(hdr_fbo_id, render_width, render_height);
+    profiler.end();
+    render_objects("camera", hdr_fbo_id, render_width, render_height, true);
+    if (screen_space_reflections)
+    {
+        profiler.begin("reflections");
+        render_reflections();
+        profiler.end();
+    }
     if (waters.size() > 0)
     {
+        profiler.begin("waters");
         render_waters(current_time);
+        profiler.end();
     }
     if (sprites.size() > 0)
     {
+        profiler.begin("sprites");
         render_sprites();
+        profiler.end();
     }
     render_screen();
 
+    profiler.end_frame();
+
     // reset render state
     wireframe = false;
     greyscale = false;
+    bloom = false;
+    exposure = 1.0f;
+    vignette = 0.0f;
+    gpu_culling = false;
+    occlusion_culling = false;
+    sdsm = false;
+    screen_space_reflections = false;
+    water_reflection_shadows = false;
     camera = nullptr;
     skybox = nullptr;
-    objects.clear();
-    directional_lights.clear();
-    point_lights.clear();
-    spot_lights.clear();
     waters.clear();
     terrains.clear();
     sprites.clear();
-}
 
-void liminal::renderer::render_shadows()
-{
-    for (auto &directional_light : directional_lights)
-    {
-        directional_light->update_transformation_matrix(camera->position);
+    static_caster_changes.clear();
+    frame_index++;
 
-        for (unsigned int i = 0; i < NUM_CASCADES; i++)
+    // everything derived from the lights is up to date now
+    for (auto &proxy : directional_lights)
+    {
+        proxy.dirty = false;
+    }
+    for (auto &proxy : point_lights)
+    {
+        proxy.dirty = false;
+    }
+    for (auto &proxy : spot_lights)
+    {
+        proxy.dirty = false;
+    }
+}
+
+liminal::renderer::object_handle liminal::renderer::add_object(liminal::model *model, const glm::mat4 &transform)
+{
+    liminal::renderer::object_proxy proxy;
+    proxy.model = model;
+    proxy.transform = transform;
+    proxy.tree_proxy_id = liminal::aabb_tree::null_node;
+    proxy.dirty = true;
+    proxy.still_frames = 0;
+    liminal::renderer::object_handle handle = objects.insert(proxy);
+
+    objects.get(handle).tree_proxy_id = object_tree.create_proxy(model->aabb.transform(transform), (void *)(std::uintptr_t)handle.index);
+    instance_batches_dirty = true;
+
+    return handle;
+}
+
+void liminal::renderer::remove_object(liminal::renderer::object_handle handle)
+{
+    if (!objects.contains(handle))
+    {
+        return;
+    }
+
+    liminal::renderer::object_proxy &proxy = objects.get(handle);
+    if (is_static(proxy))
+    {
+        static_caster_changes.push_back(object_tree.get_fat_aabb(proxy.tree_proxy_id));
+    }
+
+    object_tree.destroy_proxy(proxy.tree_proxy_id);
+    objects.erase(handle);
+    instance_batches_dirty = true;
+}
+
+void liminal::renderer::set_object_transform(liminal::renderer::object_handle handle, const glm::mat4 &transform)
+{
+    if (!objects.contains(handle))
+    {
+        return;
+    }
+
+    // objects that are sleeping or static shouldn't cost an upload
+    liminal::renderer::object_proxy &proxy = objects.get(handle);
+    if (proxy.transform != transform)
+    {
+        proxy.transform = transform;
+        proxy.dirty = true;
+    }
+}
+
+void liminal::renderer::set_object_model(liminal::renderer::object_handle handle, liminal::model *model)
+{
+    if (!objects.contains(handle))
+    {
+        return;
+    }
+
+    liminal::renderer::object_proxy &proxy = objects.get(handle);
+    if (proxy.model != model)
+    {
+        proxy.model = model;
+        proxy.dirty = true;
+        instance_batches_dirty = true;
+    }
+}
+
+liminal::renderer::directional_light_handle liminal::renderer::add_light(liminal::directional_light *directional_light)
+{
+    if (directional_lights.size() >= MAX_DIRECTIONAL_LIGHTS)
+    {
+        std::cerr << "Error: Too many directional lights, only the first " << MAX_DIRECTIONAL_LIGHTS << " will be drawn" << std::endl;
+    }
+
+    return directional_lights.insert({directional_light, true, glm::vec4(0.0f)});
+}
+
+liminal::renderer::point_light_handle liminal::renderer::add_light(liminal::point_light *point_light)
+{
+    return point_lights.insert({point_light, true, glm::vec4(0.0f)});
+}
+
+liminal::renderer::spot_light_handle liminal::renderer::add_light(liminal::spot_light *spot_light)
+{
+    return spot_lights.insert({spot_light, true, glm::vec4(0.0f)});
+}
+
+void liminal::renderer::remove_light(liminal::renderer::directional_light_handle handle)
+{
+    directional_lights.erase(handle);
+}
+
+void liminal::renderer::remove_light(liminal::renderer::point_light_handle handle)
+{
+    point_lights.erase(handle);
+}
+
+void liminal::renderer::remove_light(liminal::renderer::spot_light_handle handle)
+{
+    spot_lights.erase(handle);
+}
+
+void liminal::renderer::update_light(liminal::renderer::directional_light_handle handle)
+{
+    if (directional_lights.contains(handle))
+    {
+        directional_lights.get(handle).dirty = true;
+    }
+}
+
+void liminal::renderer::update_light(liminal::renderer::point_light_handle handle)
+{
+    if (point_lights.contains(handle))
+    {
+        point_lights.get(handle).dirty = true;
+    }
+}
+
+void liminal::renderer::update_light(liminal::renderer::spot_light_handle handle)
+{
+    if (spot_lights.contains(handle))
+    {
+        spot_lights.get(handle).dirty = true;
+    }
+}
+
+void liminal::renderer::bind_geometry_textures() const
+{
+    liminal::gl_state::active_texture(GL_TEXTURE0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_position_texture_id);
+    liminal::gl_state::active_texture(GL_TEXTURE1);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_normal_texture_id);
+    liminal::gl_state::active_texture(GL_TEXTURE2);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_albedo_texture_id);
+    liminal::gl_state::active_texture(GL_TEXTURE3);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_material_texture_id);
+    liminal::gl_state::active_texture(GL_TEXTURE7);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_depth_texture_id);
+}
+
+void liminal::renderer::unbind_geometry_textures() const
+{
+    liminal::gl_state::active_texture(GL_TEXTURE0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::active_texture(GL_TEXTURE1);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::active_texture(GL_TEXTURE2);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::active_texture(GL_TEXTURE3);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::active_texture(GL_TEXTURE7);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+}
+
+void liminal::renderer::update_instance_batches()
+{
+    instance_batches.clear();
+
+    // group objects that share a model so each mesh is drawn once per pass with all of its instances
+    std::unordered_map<liminal::model *, std::size_t> batch_indices;
+    for (auto it = objects.begin(); it != objects.end(); ++it)
+    {
+        auto batch_index = batch_indices.find(it->model);
+        if (batch_index == batch_indices.end())
+        {
+            batch_index = batch_indices.insert({it->model, instance_batches.size()}).first;
+
+            instance_batch batch;
+            batch.model = it->model;
+            instance_batches.push_back(batch);
+        }
+
+        instance_batches[batch_index->second].instances.push_back((GLuint)it.get_index());
+    }
+
+    instance_batches_dirty = false;
+}
+
+void liminal::renderer::update_static_objects()
+{
+    for (auto &proxy : objects)
+    {
+        if (proxy.dirty)
+        {
+            // a static caster that moves has to be taken back out of the shadows it was drawn into
+            if (is_static(proxy))
+            {
+                static_caster_changes.push_back(object_tree.get_fat_aabb(proxy.tree_proxy_id));
+            }
+            proxy.still_frames = 0;
+        }
+        else if (proxy.still_frames < STATIC_SHADOW_FRAMES && !proxy.model->has_animations())
+        {
+            // one that has settled gets drawn into the static shadows around it
+            proxy.still_frames++;
+            if (is_static(proxy))
+            {
+                static_caster_changes.push_back(object_tree.get_fat_aabb(proxy.tree_proxy_id));
+            }
+        }
+    }
+}
+
+void liminal::renderer::update_instances()
+{
+    // the buffer has to be reallocated when objects were added past its end, or when there are more terrains
+    terrain_base_instance = (GLuint)objects.capacity();
+    std::size_t instance_count = objects.capacity() + terrains.size();
+    bool reallocate = (GLsizeiptr)(instance_count * sizeof(glm::mat4)) > instance_ssbo_size;
+    instance_models.resize(instance_count, glm::mat4(1.0f));
+
+    // skinned objects move with their animation even if their transform doesn't
+    for (auto &batch : instance_batches)
+    {
+        if (batch.model->has_animations())
+        {
+            for (auto instance : batch.instances)
+            {
+                liminal::renderer::object_proxy &proxy = objects.get(objects.get_handle(instance));
+                object_tree.move_proxy(proxy.tree_proxy_id, proxy.model->aabb.transform(proxy.transform));
+            }
+        }
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instance_ssbo_id);
+
+    if (reallocate)
+    {
+        instance_ssbo_size = (GLsizeiptr)(instance_count * sizeof(glm::mat4));
+        glBufferData(GL_SHADER_STORAGE_BUFFER, instance_ssbo_size, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // upload runs of changed objects, a new buffer needs every one of them
+    std::size_t run_start = 0;
+    std::size_t run_end = 0;
+    for (auto it = objects.begin(); it != objects.end(); ++it)
+    {
+        if (!it->dirty && !reallocate)
+        {
+            continue;
+        }
+
+        std::size_t instance = it.get_index();
+        instance_models[instance] = it->transform;
+        if (it->dirty)
+        {
+            object_tree.move_proxy(it->tree_proxy_id, it->model->aabb.transform(it->transform));
+            it->dirty = false;
+        }
+
+        if (instance != run_end)
+        {
+            if (run_end > run_start)
+            {
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, run_start * sizeof(glm::mat4), (run_end - run_start) * sizeof(glm::mat4), &instance_models[run_start]);
+            }
+            run_start = instance;
+        }
+        run_end = instance + 1;
+    }
+    if (run_end > run_start)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, run_start * sizeof(glm::mat4), (run_end - run_start) * sizeof(glm::mat4), &instance_models[run_start]);
+    }
+
+    // there are only ever a few terrains, so they are uploaded every frame and tested directly instead of going in the tree
+    std::vector<liminal::aabb> previous_terrain_aabbs;
+    previous_terrain_aabbs.swap(terrain_aabbs);
+    for (unsigned int i = 0; i < terrains.size(); i++)
+    {
+        glm::mat4 model = terrains[i]->calc_model();
+        terrain_aabbs.push_back(terrains[i]->mesh->aabb.transform(model));
+        instance_models[terrain_base_instance + i] = model;
+    }
+
+    // terrains are always static casters, one that appeared, moved or went away changes the shadows around it
+    for (std::size_t i = 0; i < std::max(terrain_aabbs.size(), previous_terrain_aabbs.size()); i++)
+    {
+        bool moved = i >= terrain_aabbs.size() || i >= previous_terrain_aabbs.size() ||
+                     terrain_aabbs[i].min != previous_terrain_aabbs[i].min || terrain_aabbs[i].max != previous_terrain_aabbs[i].max;
+        if (moved && i < terrain_aabbs.size())
+        {
+            static_caster_changes.push_back(terrain_aabbs[i]);
+        }
+        if (moved && i < previous_terrain_aabbs.size())
+        {
+            static_caster_changes.push_back(previous_terrain_aabbs[i]);
+        }
+    }
+    if (terrains.size() > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, terrain_base_instance * sizeof(glm::mat4), terrains.size() * sizeof(glm::mat4), &instance_models[terrain_base_instance]);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instance_ssbo_id);
+}
+
+void liminal::renderer::query_objects(const liminal::bounding_sphere &sphere, const std::function<void(liminal::renderer::object_handle)> &callback) const
+{
+    object_tree.query(
+        sphere,
+        [&](int proxy_id) {
+            callback(objects.get_handle((std::uintptr_t)object_tree.get_user_data(proxy_id)));
+        });
+}
+
+void liminal::renderer::query_objects(const liminal::ray &ray, const std::function<void(liminal::renderer::object_handle, float)> &callback) const
+{
+    object_tree.query(
+        ray,
+        [&](int proxy_id, float distance) {
+            callback(objects.get_handle((std::uintptr_t)object_tree.get_user_data(proxy_id)), distance);
+        });
+}
+
+void liminal::renderer::update_lights()
+{
+    // the cascades cover the shadow distance, or with sdsm only the depth range that was on screen last frame
+    float shadow_near = camera::near_plane;
+    float shadow_far = std::min(directional_light::shadow_distance, camera::far_plane);
+    if (sdsm)
+    {
+        read_depth_bounds();
+    }
+    if (sdsm && depth_bounds_valid)
+    {
+        // nothing was drawn if the bounds are still empty
+        if (depth_bounds[0] <= depth_bounds[1])
+        {
+            float nearest = glm::max(calc_view_distance(glm::uintBitsToFloat(depth_bounds[0])), shadow_near);
+            float farthest = glm::min(calc_view_distance(glm::uintBitsToFloat(depth_bounds[1])), shadow_far);
+            if (nearest < farthest)
+            {
+                shadow_near = nearest;
+                shadow_far = farthest;
+            }
+        }
+    }
+    glm::mat4 camera_view_projection = camera->calc_projection((float)render_width / (float)render_height) * camera->calc_view();
+
+    unsigned int light_index = 0;
+    for (auto it = directional_lights.begin(); it != directional_lights.end() && light_index < MAX_DIRECTIONAL_LIGHTS; ++it, light_index++)
+    {
+        liminal::directional_light *directional_light = it->light;
+
+        // follows the camera, so this can't wait for the light to change
+        directional_light->update_transformation_matrices(camera_view_projection, shadow_near, shadow_far);
+
+        liminal::directional_light_uniforms &uniforms = light_uniforms.directional_lights[light_index];
+        uniforms.direction = directional_light->direction;
+        uniforms.color = directional_light->color;
+        for (unsigned int j = 0; j < NUM_CASCADES; j++)
+        {
+            uniforms.transformation_matrices[j] = directional_light->transformation_matrices[j];
+        }
+    }
+    light_uniforms.num_directional_lights = light_index;
+
+    // every point and spot light is uploaded, the ones left without shadow tiles go to the clustered pass
+    point_light_data.clear();
+    for (auto &proxy : point_lights)
+    {
+        liminal::point_light *point_light = proxy.light;
+        if (proxy.dirty)
+        {
+            point_light->update_transformation_matrices();
+        }
+
+        liminal::point_light_uniforms uniforms;
+        uniforms.position = point_light->position;
+        uniforms.radius = point_light->radius;
+        uniforms.color = point_light->color;
+        uniforms.casts_shadows = 0;
+        for (unsigned int j = 0; j < 6; j++)
+        {
+            uniforms.transformation_matrices[j] = point_light->transformation_matrices[j];
+            uniforms.shadow_tiles[j] = glm::vec4(0.0f);
+        }
+        point_light_data.push_back(uniforms);
+    }
+    light_uniforms.num_point_lights = (GLuint)point_light_data.size();
+
+    spot_light_data.clear();
+    for (auto &proxy : spot_lights)
+    {
+        liminal::spot_light *spot_light = proxy.light;
+        if (proxy.dirty)
+        {
+            spot_light->update_transformation_matrix();
+        }
+
+        liminal::spot_light_uniforms uniforms;
+        uniforms.position = spot_light->position;
+        uniforms.inner_cutoff = spot_light->inner_cutoff;
+        uniforms.direction = spot_light->direction;
+        uniforms.outer_cutoff = spot_light->outer_cutoff;
+        uniforms.color = spot_light->color;
+        uniforms.radius = spot_light->radius;
+        uniforms.transformation_matrix = spot_light->transformation_matrix;
+        uniforms.shadow_tile = glm::vec4(0.0f);
+        uniforms.casts_shadows = 0;
+        uniforms.padding[0] = 0;
+        uniforms.padding[1] = 0;
+        uniforms.padding[2] = 0;
+        spot_light_data.push_back(uniforms);
+    }
+    light_uniforms.num_spot_lights = (GLuint)spot_light_data.size();
+
+    allocate_shadow_tiles();
+
+    num_clustered_lights = 0;
+    for (auto &uniforms : point_light_data)
+    {
+        num_clustered_lights += uniforms.casts_shadows ? 0 : 1;
+    }
+    for (auto &uniforms : spot_light_data)
+    {
+        num_clustered_lights += uniforms.casts_shadows ? 0 : 1;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, lights_ubo_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(liminal::lights_uniforms), &light_uniforms, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // never empty, so there is always something to bind
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, point_light_ssbo_id);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        std::max(point_light_data.size(), (std::size_t)1) * sizeof(liminal::point_light_uniforms),
+        point_light_data.empty() ? nullptr : point_light_data.data(),
+        GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, spot_light_ssbo_id);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        std::max(spot_light_data.size(), (std::size_t)1) * sizeof(liminal::spot_light_uniforms),
+        spot_light_data.empty() ? nullptr : spot_light_data.data(),
+        GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, point_light_ssbo_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, spot_light_ssbo_id);
+}
+
+bool liminal::renderer::is_static(const liminal::renderer::object_proxy &proxy) const
+{
+    return proxy.still_frames >= STATIC_SHADOW_FRAMES;
+}
+
+bool liminal::renderer::static_casters_changed(const liminal::bounding_sphere &sphere) const
+{
+    for (auto &aabb : static_caster_changes)
+    {
+        if (sphere.intersects(aabb))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void liminal::renderer::allocate_shadow_tiles()
+{
+    struct shadow_request
+    {
+        GLsizei size;
+        unsigned int num_tiles;
+        glm::vec4 *tiles;
+        GLuint *casts_shadows;
+    };
+
+    glm::mat4 camera_projection = camera->calc_projection((float)render_width / (float)render_height);
+    liminal::frustum camera_frustum(camera_projection * camera->calc_view());
+
+    // water reflects the scene from a mirrored camera, so with water lights off screen can still be seen
+    bool cull_lights = waters.empty();
+
+    // the biggest tile at the current shadow scale, never less than the smallest
+    GLsizei max_tile_size = MIN_SHADOW_TILE_SIZE;
+    while (max_tile_size < MAX_SHADOW_TILE_SIZE && (float)(max_tile_size * 2) <= MAX_SHADOW_TILE_SIZE * shadow_scale)
+    {
+        max_tile_size *= 2;
+    }
+
+    // roughly how many pixels tall the light's sphere is on screen, scaled and rounded up to a tile size
+    auto calc_tile_size = [&](glm::vec3 position, float radius) -> GLsizei {
+        if (cull_lights && !camera_frustum.intersects(liminal::bounding_sphere(position, radius)))
+        {
+            return 0;
+        }
+
+        float distance = glm::length(position - camera->position);
+        if (distance <= radius)
+        {
+            return max_tile_size;
+        }
+
+        float screen_size = radius / distance * camera_projection[1][1] * (float)render_height;
+        if (screen_size < MIN_SHADOW_SCREEN_SIZE)
+        {
+            return 0;
+        }
+
+        GLsizei size = MIN_SHADOW_TILE_SIZE;
+        while (size < max_tile_size && (float)size < screen_size * shadow_scale)
+        {
+            size *= 2;
+        }
+        return size;
+    };
+
+    std::vector<shadow_request> requests;
+    std::size_t light_index = 0;
+    for (auto &proxy : point_lights)
+    {
+        liminal::point_light_uniforms &uniforms = point_light_data[light_index++];
+        GLsizei size = proxy.light->casts_shadows ? calc_tile_size(proxy.light->position, proxy.light->radius) : 0;
+        if (size > 0)
+        {
+            requests.push_back({size, 6, uniforms.shadow_tiles, &uniforms.casts_shadows});
+        }
+    }
+    light_index = 0;
+    for (auto &proxy : spot_lights)
+    {
+        liminal::spot_light_uniforms &uniforms = spot_light_data[light_index++];
+        GLsizei size = proxy.light->casts_shadows ? calc_tile_size(proxy.light->position, proxy.light->radius) : 0;
+        if (size > 0)
+        {
+            requests.push_back({size, 1, &uniforms.shadow_tile, &uniforms.casts_shadows});
+        }
+    }
+
+    // biggest first, so when every tile is at the smallest size the lights that lose their shadows are the smallest
+    std::stable_sort(requests.begin(), requests.end(), [](const shadow_request &a, const shadow_request &b) {
+        return a.size > b.size;
+    });
+
+    // halve the biggest tiles until everything fits, then drop lights from the end
+    auto calc_area = [&]() {
+        std::size_t area = 0;
+        for (auto &request : requests)
+        {
+            area += request.num_tiles * (std::size_t)request.size * (std::size_t)request.size;
+        }
+        return area;
+    };
+    const std::size_t atlas_area = (std::size_t)SHADOW_ATLAS_SIZE * (std::size_t)SHADOW_ATLAS_SIZE;
+    while (!requests.empty() && calc_area() > atlas_area)
+    {
+        GLsizei biggest = requests.front().size;
+        if (biggest > MIN_SHADOW_TILE_SIZE)
+        {
+            for (auto &request : requests)
+            {
+                if (request.size == biggest)
+                {
+                    request.size /= 2;
+                }
+            }
+        }
+        else
+        {
+            requests.pop_back();
+        }
+    }
+
+    // every tile is a power of two and they're placed biggest first, so walking the atlas in morton order
+    // always lands each one on a free spot aligned to its own size
+    num_shadow_tiles = 0;
+    std::size_t cell = 0;
+    for (auto &request : requests)
+    {
+        GLsizei cells_per_side = request.size / MIN_SHADOW_TILE_SIZE;
+        for (unsigned int j = 0; j < request.num_tiles; j++)
+        {
+            GLuint x = 0;
+            GLuint y = 0;
+            for (unsigned int bit = 0; bit < 16; bit++)
+            {
+                x |= (GLuint)((cell >> (2 * bit)) & 1) << bit;
+                y |= (GLuint)((cell >> (2 * bit + 1)) & 1) << bit;
+            }
+            request.tiles[j] = glm::vec4(
+                (float)(x * MIN_SHADOW_TILE_SIZE) / (float)SHADOW_ATLAS_SIZE,
+                (float)(y * MIN_SHADOW_TILE_SIZE) / (float)SHADOW_ATLAS_SIZE,
+                (float)request.size / (float)SHADOW_ATLAS_SIZE,
+                0.0f);
+            cell += (std::size_t)(cells_per_side * cells_per_side);
+            num_shadow_tiles++;
+        }
+        *request.casts_shadows = 1;
+    }
+}
+
+void liminal::renderer::set_view(const glm::mat4 &view_projection, glm::vec4 clipping_plane, glm::vec3 position, float near_plane, float far_plane, glm::vec2 gbuffer_scale)
+{
+    liminal::view_uniforms uniforms;
+    uniforms.view_projection = view_projection;
+    uniforms.inverse_view_projection = glm::inverse(view_projection);
+    uniforms.clipping_plane = clipping_plane;
+    uniforms.position = position;
+    uniforms.near_plane = near_plane;
+    uniforms.far_plane = far_plane;
+    uniforms.compact_gbuffer = compact_gbuffer;
+    uniforms.gbuffer_scale = gbuffer_scale;
+
+    // orphan the previous pass's view instead of waiting for its draws
+    glBindBuffer(GL_UNIFORM_BUFFER, view_ubo_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(liminal::view_uniforms), &uniforms, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// clears one tile of whichever atlas is bound, the scissor keeps the clear off the other tiles
+static void clear_shadow_tile(const glm::vec4 &tile)
+{
+    glm::vec4 texels = tile * (float)SHADOW_ATLAS_SIZE;
+    liminal::gl_state::enable(GL_SCISSOR_TEST);
+    liminal::gl_state::scissor((GLint)texels.x, (GLint)texels.y, (GLsizei)texels.z, (GLsizei)texels.z);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    liminal::gl_state::disable(GL_SCISSOR_TEST);
+}
+
+static void copy_shadow_tile(GLuint source_texture_id, GLuint destination_texture_id, const glm::vec4 &tile)
+{
+    glm::vec4 texels = tile * (float)SHADOW_ATLAS_SIZE;
+    glCopyImageSubData(
+        source_texture_id, GL_TEXTURE_2D, 0, (GLint)texels.x, (GLint)texels.y, 0,
+        destination_texture_id, GL_TEXTURE_2D, 0, (GLint)texels.x, (GLint)texels.y, 0,
+        (GLsizei)texels.z, (GLsizei)texels.z, 1);
+}
+
+// small shadows whose static casters are cached only redraw their dynamic casters every few frames
+// the slot staggers them so they don't all land on the same frame
+static bool is_update_skipped(const glm::vec4 &tile, std::size_t slot, unsigned int frame_index)
+{
+    return tile.z * SHADOW_ATLAS_SIZE <= MAX_SLICED_SHADOW_TILE_SIZE && (frame_index + slot) % SHADOW_UPDATE_INTERVAL != 0;
+}
+
+void liminal::renderer::render_shadows()
+{
+    // shadow passes are indexed by the light's slot, which doesn't change while the light is in the scene
+    // the light's index is its place in the lights block
+    unsigned int light_index = 0;
+    for (auto it = directional_lights.begin(); it != directional_lights.end() && light_index < MAX_DIRECTIONAL_LIGHTS; ++it, light_index++)
+    {
+        std::size_t i = it.get_index();
+        liminal::directional_light *directional_light = it->light;
+        profiler.begin("directional light", (int)i);
+
+        // every cascade is drawn in one pass, each mesh only to the cascades it can cast into
+        liminal::frustum cascade_frustums[NUM_CASCADES];
+        for (unsigned int j = 0; j < NUM_CASCADES; j++)
+        {
+            cascade_frustums[j] = liminal::frustum(directional_light->caster_matrices[j]);
+        }
+        cull_instances(cascade_frustums, NUM_CASCADES);
+        queue_objects(
+            "directional light",
+            (int)i,
+            depth_cascade_mesh_program,
+            depth_cascade_skinned_mesh_program,
+            depth_cascade_mesh_program,
+            camera->position,
+            directional_light::shadow_distance,
+            nullptr,
+            cascade_frustums,
+            NUM_CASCADES);
+
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, directional_light->depth_map_fbo_id);
+        {
+            liminal::gl_state::viewport(0, 0, directional_light->depth_map_size, directional_light->depth_map_size);
+            liminal::gl_state::enable(GL_CULL_FACE);
+
+            // casters between a cascade and the light are flattened onto its near plane instead of clipped
+            liminal::gl_state::enable(GL_DEPTH_CLAMP);
+
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            // the cascade matrices are already in the lights block
+            object_queue.submit(
+                false,
+                [&](liminal::program *program) {
+                    program->set_unsigned_int(light_index_uniform, light_index);
+                });
+
+            liminal::gl_state::disable(GL_DEPTH_CLAMP);
+            liminal::gl_state::disable(GL_CULL_FACE);
+        }
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+        profiler.end();
+    }
+
+    // every point and spot light shadow goes to its tiles in the atlas
+    // which lights got tiles, and where, was decided when the lights were uploaded
+    // static casters are drawn into the same tiles of the static atlas, and only again when something near them changed
+    // each frame the static tiles are copied over and the dynamic casters drawn on top
+    light_index = 0;
+    for (auto it = point_lights.begin(); it != point_lights.end(); ++it, light_index++)
+    {
+        std::size_t i = it.get_index();
+        liminal::point_light *point_light = it->light;
+        const liminal::point_light_uniforms &uniforms = point_light_data[light_index];
+        if (!uniforms.casts_shadows)
+        {
+            it->shadow_tile = glm::vec4(0.0f);
+            continue;
+        }
+
+        // the six faces are allocated together and have the same size, so the first one says where all of them went
+        // the faces together cover every direction, so the light's radius is all that limits it
+        liminal::bounding_sphere sphere(point_light->position, point_light->radius);
+        bool cached = !it->dirty && it->shadow_tile == uniforms.shadow_tiles[0] && !static_casters_changed(sphere);
+        if (cached && is_update_skipped(uniforms.shadow_tiles[0], i, frame_index))
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, directional_light->depth_map_fbo_id);
+            continue;
+        }
+        profiler.begin("point light", (int)i);
+
+        // each mesh is only drawn to the faces it's in, which are sent to viewports 1 to 6
+        // viewport 0 is left to the state cache
+        liminal::frustum face_frustums[6];
+        for (unsigned int j = 0; j < 6; j++)
+        {
+            face_frustums[j] = liminal::frustum(point_light->transformation_matrices[j]);
+
+            glm::vec4 tile = uniforms.shadow_tiles[j] * (float)SHADOW_ATLAS_SIZE;
+            glViewportIndexedf(j + 1, tile.x, tile.y, tile.z, tile.z);
+        }
+
+        liminal::gl_state::enable(GL_CULL_FACE);
+
+        if (!cached)
+        {
+            cull_instances(sphere);
+            filter_instances(true);
+            queue_objects(
+                "point light static",
+                (int)i,
+                depth_cube_mesh_program,
+                depth_cube_skinned_mesh_program,
+                depth_cube_mesh_program,
+                point_light->position,
+                point_light->radius,
+                nullptr,
+                face_frustums,
+                6);
+
+            liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, static_shadow_atlas_fbo_id);
+            {
+                for (unsigned int j = 0; j < 6; j++)
+                {
+                    clear_shadow_tile(uniforms.shadow_tiles[j]);
+                }
+
+                // the face matrices are already in the lights block
+                object_queue.submit(
+                    false,
+                    [&](liminal::program *program) {
+                        program->set_unsigned_int(light_index_uniform, light_index);
+                    });
+            }
+
+            it->shadow_tile = uniforms.shadow_tiles[0];
+        }
+
+        for (unsigned int j = 0; j < 6; j++)
+        {
+            copy_shadow_tile(static_shadow_atlas_texture_id, shadow_atlas_texture_id, uniforms.shadow_tiles[j]);
+        }
+
+        cull_instances(sphere);
+        filter_instances(false);
+        queue_objects(
+            "point light dynamic",
+            (int)i,
+            depth_cube_mesh_program,
+            depth_cube_skinned_mesh_program,
+            depth_cube_mesh_program,
+            point_light->position,
+            point_light->radius,
+            nullptr,
+            face_frustums,
+            6);
+
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, shadow_atlas_fbo_id);
+        {
+            object_queue.submit(
+                false,
+                [&](liminal::program *program) {
+                    program->set_unsigned_int(light_index_uniform, light_index);
+                });
+        }
+
+        liminal::gl_state::disable(GL_CULL_FACE);
+
+        profiler.end();
+    }
+
+    light_index = 0;
+    for (auto it = spot_lights.begin(); it != spot_lights.end(); ++it, light_index++)
+    {
+        std::size_t i = it.get_index();
+        liminal::spot_light *spot_light = it->light;
+        const liminal::spot_light_uniforms &uniforms = spot_light_data[light_index];
+        if (!uniforms.casts_shadows)
+        {
+            it->shadow_tile = glm::vec4(0.0f);
+            continue;
+        }
+
+        bool cached = !it->dirty && it->shadow_tile == uniforms.shadow_tile && !static_casters_changed(liminal::bounding_sphere(spot_light->position, spot_light->radius));
+        if (cached && is_update_skipped(uniforms.shadow_tile, i, frame_index))
+        {
+            continue;
+        }
+        profiler.begin("spot light", (int)i);
+
+        set_view(spot_light->transformation_matrix, glm::vec4(0.0f), spot_light->position, spot_light::near_plane, spot_light->radius);
+
+        // only what the cone lights can cast a visible shadow, which is tighter than the shadow map's frustum
+        // so the cone is the only test, queueing without a frustum keeps the gpu from culling the survivors again
+        liminal::cone cone(spot_light->position, spot_light->direction, acosf(spot_light->outer_cutoff), spot_light->radius);
+
+        glm::vec4 tile = uniforms.shadow_tile * (float)SHADOW_ATLAS_SIZE;
+        liminal::gl_state::viewport((GLint)tile.x, (GLint)tile.y, (GLsizei)tile.z, (GLsizei)tile.z);
+        liminal::gl_state::enable(GL_CULL_FACE);
+
+        if (!cached)
+        {
+            cull_instances(cone);
+            filter_instances(true);
+            queue_objects(
+                "spot light static",
+                (int)i,
+                depth_mesh_program,
+                depth_skinned_mesh_program,
+                depth_mesh_program,
+                spot_light->position,
+                spot_light->radius,
+                nullptr);
+
+            liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, static_shadow_atlas_fbo_id);
             {
-                glViewport(0, 0, directional_light->depth_map_size, directional_light->depth_map_size);
-                glEnable(GL_CULL_FACE);
+                clear_shadow_tile(uniforms.shadow_tile);
+
+                object_queue.submit(false, [](liminal::program *) {});
+            }
+
+            it->shadow_tile = uniforms.shadow_tile;
+        }
+
+        copy_shadow_tile(static_shadow_atlas_texture_id, shadow_atlas_texture_id, uniforms.shadow_tile);
+
+        cull_instances(cone);
+        filter_instances(false);
+        queue_objects(
+            "spot light dynamic",
+            (int)i,
+            depth_mesh_program,
+            depth_skinned_mesh_program,
+            depth_mesh_program,
+            spot_light->position,
+            spot_light->radius,
+            nullptr);
+
+        liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, shadow_atlas_fbo_id);
+        {
+            object_queue.submit(false, [](liminal::program *) {});
+        }
+
+        liminal::gl_state::disable(GL_CULL_FACE);
+
+        profiler.end();
+    }
+
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void liminal::renderer::cull_instances(const liminal::frustum &frustum)
+{
+    // everything is a candidate, the compute pass does the testing
+    if (gpu_culling)
+    {
+        instance_visibility.assign(instance_models.size(), 1);
+        return;
+    }
+
+    instance_visibility.assign(instance_models.size(), 0);
+
+    object_tree.query(
+        frustum,
+        [&](int proxy_id) {
+            mark_visible(proxy_id);
+        });
+
+    for (unsigned int i = 0; i < terrains.size(); i++)
+    {
+        instance_visibility[terrain_base_instance + i] = frustum.intersects(terrain_aabbs[i]);
+    }
+}
+
+void liminal::renderer::cull_instances(const liminal::bounding_sphere &sphere)
+{
+    instance_visibility.assign(instance_models.size(), 0);
+
+    object_tree.query(
+        sphere,
+        [&](int proxy_id) {
+            mark_visible(proxy_id);
+        });
+
+    for (unsigned int i = 0; i < terrains.size(); i++)
+    {
+        instance_visibility[terrain_base_instance + i] = sphere.intersects(terrain_aabbs[i]);
+    }
+}
+
+void liminal::renderer::cull_instances(const liminal::cone &cone)
+{
+    instance_visibility.assign(instance_models.size(), 0);
+
+    object_tree.query(
+        cone,
+        [&](int proxy_id) {
+            mark_visible(proxy_id);
+        });
+
+    for (unsigned int i = 0; i < terrains.size(); i++)
+    {
+        instance_visibility[terrain_base_instance + i] = cone.intersects(terrain_aabbs[i]);
+    }
+}
+
+void liminal::renderer::cull_instances(const liminal::frustum *frustums, unsigned int num_frustums)
+{
+    instance_visibility.assign(instance_models.size(), 0);
+
+    for (unsigned int i = 0; i < num_frustums; i++)
+    {
+        object_tree.query(
+            frustums[i],
+            [&](int proxy_id) {
+                mark_visible(proxy_id);
+            });
+    }
+
+    for (unsigned int i = 0; i < terrains.size(); i++)
+    {
+        for (unsigned int j = 0; j < num_frustums; j++)
+        {
+            if (frustums[j].intersects(terrain_aabbs[i]))
+            {
+                instance_visibility[terrain_base_instance + i] = 1;
+            }
+        }
+    }
+}
+
+void liminal::renderer::mark_visible(int proxy_id)
+{
+    instance_visibility[(std::uintptr_t)object_tree.get_user_data(proxy_id)] = 1;
+}
+
+void liminal::renderer::filter_instances(bool static_casters)
+{
+    for (auto it = objects.begin(); it != objects.end(); ++it)
+    {
+        if (is_static(*it) != static_casters)
+        {
+            instance_visibility[it.get_index()] = 0;
+        }
+    }
 
-                glFramebufferTexture2D(
-                    GL_FRAMEBUFFER,
-                    GL_DEPTH_ATTACHMENT,
-                    GL_TEXTURE_2D,
-                    directional_light->depth_map_texture_ids[i],
-                    0);
+    if (!static_casters)
+    {
+        for (unsigned int i = 0; i < terrains.size(); i++)
+        {
+            instance_visibility[terrain_base_instance + i] = 0;
+        }
+    }
+}
 
-                glClear(GL_DEPTH_BUFFER_BIT);
+bool liminal::renderer::push_views(GLuint instance, const liminal::aabb &aabb, const liminal::frustum *view_frustums, unsigned int num_view_frustums)
+{
+    bool pushed = false;
+    for (GLuint view = 0; view < num_view_frustums; view++)
+    {
+        if (view_frustums[view].intersects(aabb))
+        {
+            visible_instances.push_back(instance | (view << INSTANCE_VIEW_SHIFT));
+            pushed = true;
+        }
+    }
+    return pushed;
+}
 
-                for (auto &object : objects)
-                {
-                    glm::mat4 object_model = object->calc_model();
-                    if (object->model->has_animations())
-                    {
-                        depth_skinned_mesh_program->bind();
-                        {
-                            depth_skinned_mesh_program->set_mat4("mvp", directional_light->transformation_matrix * object_model);
-                            depth_skinned_mesh_program->set_mat4_vector("bone_transformations", object->model->bone_transformations);
+const liminal::gpu_cull *liminal::renderer::queue_objects(
+    const char *pass_name,
+    int pass_index,
+    liminal::program *mesh_program,
+    liminal::program *skinned_mesh_program,
+    liminal::program *terrain_program,
+    glm::vec3 eye,
+    float far_plane,
+    const liminal::frustum *frustum,
+    const liminal::frustum *view_frustums,
+    unsigned int num_view_frustums)
+{
+    object_queue.clear();
+    visible_instances.clear();
+    instance_queued.assign(instance_visibility.size(), 0);
 
-                            object->model->draw_meshes(depth_skinned_mesh_program);
-                        }
-                        depth_skinned_mesh_program->unbind();
-                    }
-                    else
-                    {
-                        depth_mesh_program->bind();
-                        {
-                            depth_mesh_program->set_mat4("mvp", directional_light->transformation_matrix * object_model);
+    bool cull_on_gpu = gpu_culling && frustum;
 
-                            object->model->draw_meshes(depth_mesh_program);
-                        }
-                        depth_mesh_program->unbind();
-                    }
-                }
+    // cull the meshes of visible instances whose model has more than one, all at once
+    // this has to visit them in the same order as the loop below
+    mesh_aabbs.clear();
+    if (frustum && !cull_on_gpu)
+    {
+        for (auto &batch : instance_batches)
+        {
+            if (batch.model->meshes.size() < 2)
+            {
+                continue;
+            }
 
-                depth_mesh_program->bind();
+            for (auto &mesh : batch.model->meshes)
+            {
+                for (auto i : batch.instances)
                 {
-
-                    for (auto &terrain : terrains)
+                    if (instance_visibility[i])
                     {
-                        glm::mat4 terrain_model = terrain->calc_model();
-
-                        depth_mesh_program->set_mat4("mvp", directional_light->transformation_matrix * terrain_model);
-
-                        terrain->mesh->draw(depth_mesh_program);
+                        mesh_aabbs.push(mesh->aabb.transform(instance_models[i]));
                     }
                 }
-                depth_mesh_program->unbind();
             }
-
-            glDisable(GL_CULL_FACE);
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        mesh_visibility.assign(mesh_aabbs.size(), 0);
+        mesh_aabbs.cull(*frustum, mesh_visibility);
     }
 
-    for (auto &point_light : point_lights)
+    std::size_t mesh_index = 0;
+    for (auto &batch : instance_batches)
     {
-        point_light->update_transformation_matrices();
+        bool skinned = batch.model->has_animations();
+        liminal::program *program = skinned ? skinned_mesh_program : mesh_program;
+        const std::vector<glm::mat4> *bone_transformations = skinned ? &batch.model->bone_transformations : nullptr;
+        bool cull_meshes = frustum && !cull_on_gpu && batch.model->meshes.size() > 1;
 
-        glBindFramebuffer(GL_FRAMEBUFFER, point_light->depth_cubemap_fbo_id);
+        for (auto &mesh : batch.model->meshes)
         {
-            glViewport(0, 0, point_light->depth_cube_size, point_light->depth_cube_size);
-            glEnable(GL_CULL_FACE);
-
-            glClear(GL_DEPTH_BUFFER_BIT);
-
-            for (auto &object : objects)
+            // gather the visible instances of this mesh, sorting it by its closest one
+            GLuint base_instance = (GLuint)visible_instances.size();
+            float depth = 1.0f;
+            for (auto i : batch.instances)
             {
-                glm::mat4 object_model = object->calc_model();
-                if (object->model->has_animations())
+                if (!instance_visibility[i] || (cull_meshes && !mesh_visibility[mesh_index++]))
                 {
-                    depth_cube_skinned_mesh_program->bind();
-                    {
-                        depth_cube_skinned_mesh_program->set_mat4("model", object_model);
-                        depth_cube_skinned_mesh_program->set_mat4_vector("bone_transformations", object->model->bone_transformations);
-
-                        for (unsigned int i = 0; i < 6; i++)
-                        {
-                            depth_cube_skinned_mesh_program->set_mat4("light.transformation_matrices[" + std::to_string(i) + "]", point_light->transformation_matrices[i]);
-                        }
-
-                        depth_cube_skinned_mesh_program->set_float("light.far_plane", point_light::far_plane);
-                        depth_cube_skinned_mesh_program->set_vec3("light.position", point_light->position);
+                    continue;
+                }
 
-                        object->model->draw_meshes(depth_cube_skinned_mesh_program);
+                if (view_frustums)
+                {
+                    if (!push_views(i, mesh->aabb.transform(instance_models[i]), view_frustums, num_view_frustums))
+                    {
+                        continue;
                     }
-                    depth_cube_skinned_mesh_program->unbind();
                 }
                 else
                 {
-                    depth_cube_mesh_program->bind();
-                    {
-                        depth_cube_mesh_program->set_mat4("model", object_model);
-
-                        for (unsigned int i = 0; i < 6; i++)
-                        {
-                            depth_cube_mesh_program->set_mat4("light.transformation_matrices[" + std::to_string(i) + "]", point_light->transformation_matrices[i]);
-                        }
+                    visible_instances.push_back(i);
+                }
+                instance_queued[i] = 1;
+                depth = glm::min(depth, glm::length(glm::vec3(instance_models[i][3]) - eye) / far_plane);
+            }
 
-                        depth_cube_mesh_program->set_float("light.far_plane", point_light::far_plane);
-                        depth_cube_mesh_program->set_vec3("light.position", point_light->position);
+            GLsizei instance_count = (GLsizei)(visible_instances.size() - base_instance);
+            if (instance_count > 0)
+            {
+                object_queue.push(program, mesh, base_instance, instance_count, bone_transformations, depth);
+            }
+        }
+    }
 
-                        object->model->draw_meshes(depth_cube_mesh_program);
-                    }
-                    depth_cube_mesh_program->unbind();
-                }
+    for (unsigned int i = 0; i < terrains.size(); i++)
+    {
+        if (instance_visibility[terrain_base_instance + i])
+        {
+            float depth = glm::min(glm::length(terrains[i]->position - eye) / far_plane, 1.0f);
+            GLuint base_instance = (GLuint)visible_instances.size();
+            if (view_frustums)
+            {
+                push_views(terrain_base_instance + i, terrain_aabbs[i], view_frustums, num_view_frustums);
+            }
+            else
+            {
+                visible_instances.push_back(terrain_base_instance + i);
             }
 
-            depth_cube_mesh_program->bind();
+            GLsizei instance_count = (GLsizei)(visible_instances.size() - base_instance);
+            if (instance_count > 0)
             {
-                for (unsigned int i = 0; i < 6; i++)
-                {
-                    depth_cube_mesh_program->set_mat4("light.transformation_matrices[" + std::to_string(i) + "]", point_light->transformation_matrices[i]);
-                }
+                instance_queued[terrain_base_instance + i] = 1;
+                object_queue.push(terrain_program, terrains[i]->mesh, base_instance, instance_count, nullptr, depth, terrains[i]->size);
+            }
+        }
+    }
 
-                depth_cube_mesh_program->set_float("light.far_plane", point_light::far_plane);
-                depth_cube_mesh_program->set_vec3("light.position", point_light->position);
+    object_queue.sort();
 
-                for (auto &terrain : terrains)
-                {
-                    glm::mat4 terrain_model = terrain->calc_model();
+    liminal::renderer::pass_stats pass;
+    pass.name = pass_name;
+    pass.index = pass_index;
+    pass.tested = (unsigned int)(objects.size() + terrains.size());
+    pass.visible = (unsigned int)std::count(instance_queued.begin(), instance_queued.end(), 1);
+    pass.draws = (unsigned int)visible_instances.size();
+    pass.gpu_culled = cull_on_gpu;
+    stats.push_back(pass);
 
-                    depth_cube_mesh_program->set_mat4("model", terrain_model);
+    // orphan the previous pass's list, it may still be in use by draws in flight
+    GLsizeiptr size = (GLsizeiptr)(visible_instances.size() * sizeof(GLuint));
+    visible_instance_ssbo_size = std::max(visible_instance_ssbo_size, size);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, visible_instance_ssbo_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, visible_instance_ssbo_size, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, visible_instances.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-                    terrain->mesh->draw(depth_cube_mesh_program);
-                }
-            }
-            depth_cube_mesh_program->unbind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visible_instance_ssbo_id);
 
-            glDisable(GL_CULL_FACE);
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!cull_on_gpu)
+    {
+        return nullptr;
     }
 
-    for (auto &spot_light : spot_lights)
+    // the list just uploaded becomes the candidates, the render queue binds the survivors in its place
+    object_gpu_cull.cull_program = cull_instances_program;
+    object_gpu_cull.compact_program = compact_draws_program;
+    object_gpu_cull.frustum = *frustum;
+    object_gpu_cull.candidate_ssbo_id = visible_instance_ssbo_id;
+    object_gpu_cull.candidate_count = (GLsizei)visible_instances.size();
+    object_gpu_cull.occlusion_phase = 0;
+    object_gpu_cull.hi_z_texture_id = 0;
+    return &object_gpu_cull;
+}
+
+void liminal::renderer::build_hi_z(GLuint texture_id, bool nearest)
+{
+    hi_z_program->bind();
     {
-        spot_light->update_transformation_matrix();
+        hi_z_program->set_int("nearest", nearest);
+        liminal::gl_state::active_texture(GL_TEXTURE0);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, spot_light->depth_map_fbo_id);
+        for (GLint level = 0; level < hi_z_levels; level++)
         {
-            glViewport(0, 0, spot_light->depth_map_size, spot_light->depth_map_size);
-            glEnable(GL_CULL_FACE);
+            // the first level is a copy of the depth buffer, the rest reduce the level before them
+            GLsizei level_width = std::max(render_width >> level, 1);
+            GLsizei level_height = std::max(render_height >> level, 1);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, level == 0 ? geometry_depth_texture_id : texture_id);
+            glBindImageTexture(0, texture_id, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
 
-            glClear(GL_DEPTH_BUFFER_BIT);
+            hi_z_program->set_int("input_level", std::max(level - 1, 0));
+            hi_z_program->set_int("first_level", level == 0);
 
-            for (auto &object : objects)
-            {
-                glm::mat4 object_model = object->calc_model();
-                if (object->model->has_animations())
-                {
-                    depth_skinned_mesh_program->bind();
-                    {
-                        depth_skinned_mesh_program->set_mat4("mvp", spot_light->transformation_matrix * object_model);
-                        depth_skinned_mesh_program->set_mat4_vector("bone_transformations", object->model->bone_transformations);
+            glDispatchCompute((level_width + 7) / 8, (level_height + 7) / 8, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
 
-                        object->model->draw_meshes(depth_skinned_mesh_program);
-                    }
-                    depth_skinned_mesh_program->unbind();
-                }
-                else
-                {
-                    depth_mesh_program->bind();
-                    {
-                        depth_mesh_program->set_mat4("mvp", spot_light->transformation_matrix * object_model);
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    }
+    hi_z_program->unbind();
+}
 
-                        object->model->draw_meshes(depth_mesh_program);
-                    }
-                    depth_mesh_program->unbind();
-                }
-            }
+void liminal::renderer::build_clusters(const glm::mat4 &camera_view, const glm::mat4 &camera_projection)
+{
+    // near and far plane come from the view block, which already holds this camera
+    cluster_lights_program->bind();
+    {
+        cluster_lights_program->set_mat4("view_matrix", camera_view);
+        cluster_lights_program->set_mat4("inverse_projection", glm::inverse(camera_projection));
 
-            depth_mesh_program->bind();
-            {
+        glDispatchCompute((NUM_CLUSTERS + 63) / 64, 1, 1);
+    }
+    cluster_lights_program->unbind();
 
-                for (auto &terrain : terrains)
-                {
-                    glm::mat4 terrain_model = terrain->calc_model();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
 
-                    depth_mesh_program->set_mat4("mvp", spot_light->transformation_matrix * terrain_model);
+void liminal::renderer::reduce_depth_bounds(GLsizei width, GLsizei height)
+{
+    // starts out empty, the shader only ever widens it
+    // a buffer still in flight after this many frames is overwritten, its bounds would be too old to use anyway
+    if (depth_bounds_fences[depth_bounds_index])
+    {
+        glDeleteSync(depth_bounds_fences[depth_bounds_index]);
+        depth_bounds_fences[depth_bounds_index] = nullptr;
+    }
 
-                    terrain->mesh->draw(depth_mesh_program);
-                }
-            }
-            depth_mesh_program->unbind();
+    GLuint depth_bounds_ssbo_id = depth_bounds_ssbo_ids[depth_bounds_index];
+    GLuint empty_bounds[2] = {0xffffffff, 0};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, depth_bounds_ssbo_id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(empty_bounds), empty_bounds);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, depth_bounds_ssbo_id);
+
+    depth_bounds_program->bind();
+    {
+        liminal::gl_state::active_texture(GL_TEXTURE0);
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, geometry_depth_texture_id);
+
+        glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+    }
+    depth_bounds_program->unbind();
+
+    depth_bounds_fences[depth_bounds_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    depth_bounds_index = (depth_bounds_index + 1) % NUM_DEPTH_BOUNDS_BUFFERS;
+}
 
-            glDisable(GL_CULL_FACE);
+void liminal::renderer::read_depth_bounds()
+{
+    // oldest first, so the newest finished one is read last, stopping at the first that isn't done since later ones can't be either
+    for (unsigned int i = 0; i < NUM_DEPTH_BOUNDS_BUFFERS; i++)
+    {
+        unsigned int index = (depth_bounds_index + i) % NUM_DEPTH_BOUNDS_BUFFERS;
+        if (!depth_bounds_fences[index])
+        {
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(depth_bounds_fences[index], 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, depth_bounds_ssbo_ids[index]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(depth_bounds), depth_bounds);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glDeleteSync(depth_bounds_fences[index]);
+        depth_bounds_fences[index] = nullptr;
+        depth_bounds_valid = true;
+    }
+}
+
+void liminal::renderer::clear_depth_bounds()
+{
+    // bounds from before sdsm was turned off would fit the cascades to a view that's long gone
+    for (unsigned int i = 0; i < NUM_DEPTH_BOUNDS_BUFFERS; i++)
+    {
+        if (depth_bounds_fences[i])
+        {
+            glDeleteSync(depth_bounds_fences[i]);
+            depth_bounds_fences[i] = nullptr;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
+    depth_bounds_valid = false;
 }
 
-void liminal::renderer::render_objects(GLuint fbo_id, GLsizei width, GLsizei height, glm::vec4 clipping_plane)
+void liminal::renderer::render_objects(const char *pass_name, GLuint fbo_id, GLsizei width, GLsizei height, bool occlusion_cull, glm::vec4 clipping_plane, bool shadows)
 {
+    profiler.begin(pass_name);
+
     // camera
     glm::mat4 camera_projection = camera->calc_projection((float)width / (float)height);
     glm::mat4 camera_view = camera->calc_view();
+    glm::vec2 gbuffer_scale((float)width / (float)render_width, (float)height / (float)render_height);
+    set_view(camera_projection * camera_view, clipping_plane, camera->position, camera::near_plane, camera::far_plane, gbuffer_scale);
 
     // draw to gbuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, geometry_fbo_id);
+    profiler.begin("geometry");
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, geometry_fbo_id);
     {
-        glViewport(0, 0, width, height);
-        glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_CLIP_DISTANCE0);
+        liminal::gl_state::viewport(0, 0, width, height);
+        liminal::gl_state::polygon_mode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+        liminal::gl_state::enable(GL_CULL_FACE);
+        liminal::gl_state::enable(GL_CLIP_DISTANCE0);
+
+        // albedo is written as linear and stored as srgb in the compact layout, nothing else here is srgb
+        liminal::gl_state::enable(GL_FRAMEBUFFER_SRGB);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        for (auto &object : objects)
+        // nothing behind the clipping plane is drawn, so it can stand in for the far plane
+        liminal::frustum frustum(camera_projection * camera_view);
+        if (clipping_plane != glm::vec4(0.0f))
+        {
+            frustum.planes[5] = clipping_plane;
+        }
+        cull_instances(frustum);
+        const liminal::gpu_cull *gpu_cull = queue_objects(
+            pass_name,
+            -1,
+            geometry_mesh_program,
+            geometry_skinned_mesh_program,
+            geometry_terrain_program,
+            camera->position,
+            camera::far_plane,
+            &frustum);
+        auto on_program = [](liminal::program *) {};
+
+        bool use_hi_z = occlusion_cull && occlusion_culling && gpu_cull;
+        if (use_hi_z && hi_z_valid)
+        {
+            // draw what last frame's depth didn't hide, reprojected with last frame's camera
+            object_gpu_cull.occlusion_phase = 1;
+            object_gpu_cull.hi_z_texture_id = hi_z_texture_id;
+            object_gpu_cull.occlusion_view_projection = hi_z_view_projection;
+            object_queue.submit(true, on_program, gpu_cull);
+
+            // then retest what it did hide against what has been drawn so far, catching anything disoccluded
+            build_hi_z(hi_z_texture_id, false);
+            object_gpu_cull.occlusion_phase = 2;
+            object_gpu_cull.occlusion_view_projection = camera_projection * camera_view;
+            object_queue.submit(true, on_program, gpu_cull);
+        }
+        else
+        {
+            object_queue.submit(true, on_program, gpu_cull);
+        }
+
+        // keep the finished depth around for next frame
+        if (occlusion_cull)
         {
-            glm::mat4 object_model = object->calc_model();
-            if (object->model->has_animations())
+            if (use_hi_z)
             {
-                geometry_skinned_mesh_program->bind();
-                {
-                    geometry_skinned_mesh_program->set_mat4("mvp", camera_projection * camera_view * object_model);
-                    geometry_skinned_mesh_program->set_mat4_vector("bone_transformations", object->model->bone_transformations);
-                    geometry_skinned_mesh_program->set_mat4("model", object_model);
-                    geometry_skinned_mesh_program->set_vec4("clipping_plane", clipping_plane);
+                build_hi_z(hi_z_texture_id, false);
+                hi_z_view_projection = camera_projection * camera_view;
+            }
+            hi_z_valid = use_hi_z;
 
-                    object->model->draw_meshes(geometry_skinned_mesh_program);
-                }
-                geometry_skinned_mesh_program->unbind();
+            if (sdsm)
+            {
+                reduce_depth_bounds(width, height);
             }
             else
             {
-                geometry_mesh_program->bind();
-                {
-                    geometry_mesh_program->set_mat4("mvp", camera_projection * camera_view * object_model);
-                    geometry_mesh_program->set_mat4("model", object_model);
-                    geometry_mesh_program->set_vec4("clipping_plane", clipping_plane);
-
-                    object->model->draw_meshes(geometry_mesh_program);
-                }
-                geometry_mesh_program->unbind();
+                clear_depth_bounds();
             }
         }
 
-        geometry_terrain_program->bind();
-        {
-            geometry_terrain_program->set_vec4("clipping_plane", clipping_plane);
-
-            for (auto &terrain : terrains)
-            {
-                glm::mat4 terrain_model = terrain->calc_model();
-
-                geometry_terrain_program->set_mat4("mvp", camera_projection * camera_view * terrain_model);
-                geometry_terrain_program->set_mat4("model", terrain_model);
-                geometry_terrain_program->set_float("tiling", terrain->size);
-
-                terrain->mesh->draw(geometry_terrain_program);
-            }
-        }
-        geometry_terrain_program->unbind();
+        liminal::gl_state::polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+        liminal::gl_state::disable(GL_CULL_FACE);
+        liminal::gl_state::disable(GL_CLIP_DISTANCE0);
+        liminal::gl_state::disable(GL_FRAMEBUFFER_SRGB);
+    }
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+    profiler.end();
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDisable(GL_CULL_FACE);
-        glDisable(GL_CLIP_DISTANCE0);
+    // assign lights without shadows to the clusters of this camera
+    if (num_clustered_lights > 0)
+    {
+        profiler.begin("clusters");
+        build_clusters(camera_view, camera_projection);
+        profiler.end();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // deferred lighting
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_id);
+    profiler.begin("lighting");
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, fbo_id);
     {
-        glViewport(0, 0, width, height);
-        glDisable(GL_DEPTH_TEST);
+        liminal::gl_state::viewport(0, 0, width, height);
+        liminal::gl_state::disable(GL_DEPTH_TEST);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // IBL
         deferred_ambient_program->bind();
         {
-            deferred_ambient_program->set_vec3("camera.position", camera->position);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, geometry_position_texture_id);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, geometry_normal_texture_id);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, geometry_albedo_texture_id);
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, geometry_material_texture_id);
-            glActiveTexture(GL_TEXTURE4);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skybox ? skybox->irradiance_cubemap_id : 0);
-            glActiveTexture(GL_TEXTURE5);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skybox ? skybox->prefilter_cubemap_id : 0);
-            glActiveTexture(GL_TEXTURE6);
-            glBindTexture(GL_TEXTURE_2D, brdf_texture_id);
-
-            glBindVertexArray(screen_vao_id);
+            bind_geometry_textures();
+            liminal::gl_state::active_texture(GL_TEXTURE4);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, skybox ? skybox->irradiance_cubemap_id : 0);
+            liminal::gl_state::active_texture(GL_TEXTURE5);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, skybox ? skybox->prefilter_cubemap_id : 0);
+            liminal::gl_state::active_texture(GL_TEXTURE6);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, brdf_texture_id);
+
+            liminal::gl_state::bind_vertex_array(screen_vao_id);
             glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-            glBindVertexArray(0);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glActiveTexture(GL_TEXTURE4);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-            glActiveTexture(GL_TEXTURE5);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-            glActiveTexture(GL_TEXTURE6);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_vertex_array(0);
+
+            unbind_geometry_textures();
+            liminal::gl_state::active_texture(GL_TEXTURE4);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE5);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE6);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
         }
         deferred_ambient_program->unbind();
 
         // blend the rest of the lights
         {
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ONE);
-            glDepthMask(GL_FALSE);
-            glDepthFunc(GL_EQUAL);
+            liminal::gl_state::enable(GL_BLEND);
+            liminal::gl_state::blend_func(GL_ONE, GL_ONE);
+            liminal::gl_state::depth_mask(GL_FALSE);
+            liminal::gl_state::depth_func(GL_EQUAL);
 
             if (directional_lights.size() > 0)
             {
                 deferred_directional_program->bind();
                 {
-                    deferred_directional_program->set_vec3("camera.position", camera->position);
-
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, geometry_position_texture_id);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, geometry_normal_texture_id);
-                    glActiveTexture(GL_TEXTURE2);
-                    glBindTexture(GL_TEXTURE_2D, geometry_albedo_texture_id);
-                    glActiveTexture(GL_TEXTURE3);
-                    glBindTexture(GL_TEXTURE_2D, geometry_material_texture_id);
-
-                    for (auto &directional_light : directional_lights)
+                    deferred_directional_program->set_int("shadows", shadows);
+                    bind_geometry_textures();
+
+                    unsigned int light_index = 0;
+                    for (auto it = directional_lights.begin(); it != directional_lights.end() && light_index < MAX_DIRECTIONAL_LIGHTS; ++it, light_index++)
                     {
-                        deferred_directional_program->set_vec3("light.direction", directional_light->direction);
-                        deferred_directional_program->set_vec3("light.color", directional_light->color);
-                        deferred_directional_program->set_mat4("light.transformation_matrix", directional_light->transformation_matrix);
+                        liminal::directional_light *directional_light = it->light;
+                        deferred_directional_program->set_unsigned_int(light_index_uniform, light_index);
 
-                        glActiveTexture(GL_TEXTURE4);
-                        glBindTexture(GL_TEXTURE_2D, directional_light->depth_map_texture_ids[0]);
+                        liminal::gl_state::active_texture(GL_TEXTURE4);
+                        liminal::gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, directional_light->depth_map_texture_id);
 
-                        glBindVertexArray(screen_vao_id);
+                        liminal::gl_state::bind_vertex_array(screen_vao_id);
                         glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-                        glBindVertexArray(0);
+                        liminal::gl_state::bind_vertex_array(0);
 
-                        glActiveTexture(GL_TEXTURE4);
-                        glBindTexture(GL_TEXTURE_2D, 0);
+                        liminal::gl_state::active_texture(GL_TEXTURE4);
+                        liminal::gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, 0);
                     }
 
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE2);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE3);
-                    glBindTexture(GL_TEXTURE_2D, 0);
+                    unbind_geometry_textures();
                 }
                 deferred_directional_program->unbind();
             }
 
+            // lights that reach nothing on screen are skipped, the rest only shade the pixels their radius covers
+            glm::mat4 camera_view_projection = camera_projection * camera_view;
+            liminal::frustum light_frustum(camera_view_projection);
+            GLint scissor_rect[4];
+
             if (point_lights.size() > 0)
             {
                 deferred_point_program->bind();
                 {
-                    deferred_point_program->set_vec3("camera.position", camera->position);
-                    deferred_point_program->set_float("light.far_plane", point_light::far_plane);
-
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, geometry_position_texture_id);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, geometry_normal_texture_id);
-                    glActiveTexture(GL_TEXTURE2);
-                    glBindTexture(GL_TEXTURE_2D, geometry_albedo_texture_id);
-                    glActiveTexture(GL_TEXTURE3);
-                    glBindTexture(GL_TEXTURE_2D, geometry_material_texture_id);
-
-                    for (auto &point_light : point_lights)
+                    deferred_point_program->set_int("shadows", shadows);
+                    bind_geometry_textures();
+                    liminal::gl_state::active_texture(GL_TEXTURE4);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, shadow_atlas_texture_id);
+
+                    unsigned int light_index = 0;
+                    for (auto it = point_lights.begin(); it != point_lights.end(); ++it, light_index++)
                     {
-                        deferred_point_program->set_vec3("light.position", point_light->position);
-                        deferred_point_program->set_vec3("light.color", point_light->color);
+                        liminal::point_light *point_light = it->light;
+                        if (!point_light_data[light_index].casts_shadows ||
+                            !light_frustum.intersects(liminal::bounding_sphere(point_light->position, point_light->radius)))
+                        {
+                            continue;
+                        }
+
+                        if (calc_light_scissor(camera_view_projection, point_light->position, point_light->radius, width, height, scissor_rect))
+                        {
+                            liminal::gl_state::enable(GL_SCISSOR_TEST);
+                            liminal::gl_state::scissor(scissor_rect[0], scissor_rect[1], scissor_rect[2], scissor_rect[3]);
+                        }
+                        else
+                        {
+                            liminal::gl_state::disable(GL_SCISSOR_TEST);
+                        }
 
-                        glActiveTexture(GL_TEXTURE4);
-                        glBindTexture(GL_TEXTURE_CUBE_MAP, point_light->depth_cubemap_texture_id);
+                        deferred_point_program->set_unsigned_int(light_index_uniform, light_index);
 
-                        glBindVertexArray(screen_vao_id);
+                        liminal::gl_state::bind_vertex_array(screen_vao_id);
                         glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-                        glBindVertexArray(0);
-
-                        glActiveTexture(GL_TEXTURE4);
-                        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                        liminal::gl_state::bind_vertex_array(0);
                     }
+                    liminal::gl_state::disable(GL_SCISSOR_TEST);
 
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE2);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE3);
-                    glBindTexture(GL_TEXTURE_2D, 0);
+                    unbind_geometry_textures();
+                    liminal::gl_state::active_texture(GL_TEXTURE4);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
                 }
                 deferred_point_program->unbind();
             }
@@ -1505,75 +3030,94 @@ void liminal::renderer::render_objects(GLuint fbo_id, GLsizei width, GLsizei hei
             {
                 deferred_spot_program->bind();
                 {
-                    deferred_spot_program->set_vec3("camera.position", camera->position);
-
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, geometry_position_texture_id);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, geometry_normal_texture_id);
-                    glActiveTexture(GL_TEXTURE2);
-                    glBindTexture(GL_TEXTURE_2D, geometry_albedo_texture_id);
-                    glActiveTexture(GL_TEXTURE3);
-                    glBindTexture(GL_TEXTURE_2D, geometry_material_texture_id);
-
-                    for (auto &spot_light : spot_lights)
+                    deferred_spot_program->set_int("shadows", shadows);
+                    bind_geometry_textures();
+                    liminal::gl_state::active_texture(GL_TEXTURE4);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, shadow_atlas_texture_id);
+
+                    unsigned int light_index = 0;
+                    for (auto it = spot_lights.begin(); it != spot_lights.end(); ++it, light_index++)
                     {
-                        deferred_spot_program->set_vec3("light.position", spot_light->position);
-                        deferred_spot_program->set_vec3("light.direction", spot_light->direction);
-                        deferred_spot_program->set_vec3("light.color", spot_light->color);
-                        deferred_spot_program->set_float("light.inner_cutoff", spot_light->inner_cutoff);
-                        deferred_spot_program->set_float("light.outer_cutoff", spot_light->outer_cutoff);
-                        deferred_spot_program->set_mat4("light.transformation_matrix", spot_light->transformation_matrix);
+                        liminal::spot_light *spot_light = it->light;
+                        if (!spot_light_data[light_index].casts_shadows ||
+                            !light_frustum.intersects(liminal::bounding_sphere(spot_light->position, spot_light->radius)))
+                        {
+                            continue;
+                        }
+
+                        if (calc_light_scissor(camera_view_projection, spot_light->position, spot_light->radius, width, height, scissor_rect))
+                        {
+                            liminal::gl_state::enable(GL_SCISSOR_TEST);
+                            liminal::gl_state::scissor(scissor_rect[0], scissor_rect[1], scissor_rect[2], scissor_rect[3]);
+                        }
+                        else
+                        {
+                            liminal::gl_state::disable(GL_SCISSOR_TEST);
+                        }
 
-                        glActiveTexture(GL_TEXTURE4);
-                        glBindTexture(GL_TEXTURE_2D, spot_light->depth_map_texture_id);
+                        deferred_spot_program->set_unsigned_int(light_index_uniform, light_index);
 
-                        glBindVertexArray(screen_vao_id);
+                        liminal::gl_state::bind_vertex_array(screen_vao_id);
                         glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-                        glBindVertexArray(0);
-
-                        glActiveTexture(GL_TEXTURE4);
-                        glBindTexture(GL_TEXTURE_2D, 0);
+                        liminal::gl_state::bind_vertex_array(0);
                     }
+                    liminal::gl_state::disable(GL_SCISSOR_TEST);
 
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE2);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glActiveTexture(GL_TEXTURE3);
-                    glBindTexture(GL_TEXTURE_2D, 0);
+                    unbind_geometry_textures();
+                    liminal::gl_state::active_texture(GL_TEXTURE4);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
                 }
                 deferred_spot_program->unbind();
             }
 
-            glDisable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ZERO);
-            glDepthMask(GL_TRUE);
-            glDepthFunc(GL_LESS);
+            // every light without shadows in one pass, each pixel only loops over the lights of its cluster
+            if (num_clustered_lights > 0)
+            {
+                deferred_clustered_program->bind();
+                {
+                    deferred_clustered_program->set_mat4("view_matrix", camera_view);
+                    deferred_clustered_program->set_vec2("screen_size", glm::vec2((float)width, (float)height));
+
+                    bind_geometry_textures();
+
+                    liminal::gl_state::bind_vertex_array(screen_vao_id);
+                    glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
+                    liminal::gl_state::bind_vertex_array(0);
+
+                    unbind_geometry_textures();
+                }
+                deferred_clustered_program->unbind();
+            }
+
+            liminal::gl_state::disable(GL_BLEND);
+            liminal::gl_state::blend_func(GL_ONE, GL_ZERO);
+            liminal::gl_state::depth_mask(GL_TRUE);
+            liminal::gl_state::depth_func(GL_LESS);
         }
 
-        glEnable(GL_DEPTH_TEST);
+        liminal::gl_state::enable(GL_DEPTH_TEST);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+    profiler.end();
 
     // copy depth info
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, geometry_fbo_id);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_id);
+    profiler.begin("forward");
+    liminal::gl_state::bind_framebuffer(GL_READ_FRAMEBUFFER, geometry_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_DRAW_FRAMEBUFFER, fbo_id);
     glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     // forward render everything else
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, fbo_id);
     {
-        glViewport(0, 0, width, height);
-        glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+        liminal::gl_state::viewport(0, 0, width, height);
+        liminal::gl_state::polygon_mode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
 
         // draw skybox
         if (skybox)
         {
-            glDepthFunc(GL_LEQUAL);
+            liminal::gl_state::depth_func(GL_LEQUAL);
 
             glm::mat4 camera_view_no_translate = camera_view;
             camera_view_no_translate[3][0] = 0.0f;
@@ -1584,150 +3128,297 @@ void liminal::renderer::render_objects(GLuint fbo_id, GLsizei width, GLsizei hei
             {
                 skybox_program->set_mat4("mvp", camera_projection * camera_view_no_translate);
 
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->environment_cubemap_id);
+                liminal::gl_state::active_texture(GL_TEXTURE0);
+                liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, skybox->environment_cubemap_id);
 
-                glBindVertexArray(skybox_vao_id);
+                liminal::gl_state::bind_vertex_array(skybox_vao_id);
                 glDrawArrays(GL_TRIANGLES, 0, skybox_vertices_size);
-                glBindVertexArray(0);
+                liminal::gl_state::bind_vertex_array(0);
 
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                liminal::gl_state::active_texture(GL_TEXTURE0);
+                liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
             }
             skybox_program->unbind();
 
-            glDepthFunc(GL_LESS);
+            liminal::gl_state::depth_func(GL_LESS);
         }
 
         // DEBUG: draw point lights as a sphere
         {
-            glEnable(GL_CLIP_DISTANCE0);
+            liminal::gl_state::enable(GL_CLIP_DISTANCE0);
 
-            for (auto &point_light : point_lights)
+            for (auto &proxy : point_lights)
             {
+                liminal::point_light *point_light = proxy.light;
                 color_program->bind();
                 {
                     glm::mat4 model(1.0f);
                     model = glm::translate(model, point_light->position);
                     model = glm::scale(model, {0.25f, 0.25f, 0.25f});
 
-                    color_program->set_mat4("mvp", camera_projection * camera_view * model);
                     color_program->set_mat4("model", model);
-                    color_program->set_vec4("clipping_plane", clipping_plane);
                     color_program->set_vec3("color", point_light->color);
 
-                    DEBUG_sphere_mesh->draw(color_program);
+                    DEBUG_sphere_mesh->draw();
                 }
                 color_program->unbind();
             }
 
-            glDisable(GL_CLIP_DISTANCE0);
+            liminal::gl_state::disable(GL_CLIP_DISTANCE0);
+        }
+
+        liminal::gl_state::polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+    profiler.end();
+
+    profiler.end();
+}
+
+void liminal::renderer::render_reflections()
+{
+    // the camera pass's depth is still in the gbuffer
+    build_hi_z(ssr_hi_z_texture_id, true);
+
+    // the lit image can't be read while it's drawn to
+    glCopyImageSubData(
+        hdr_texture_ids[0], GL_TEXTURE_2D, 0, 0, 0, 0,
+        ssr_color_texture_id, GL_TEXTURE_2D, 0, 0, 0, 0,
+        render_width, render_height, 1);
+    liminal::gl_state::active_texture(GL_TEXTURE5);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, ssr_color_texture_id);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glm::mat4 camera_projection = camera->calc_projection((float)render_width / (float)render_height);
+    glm::mat4 camera_view = camera->calc_view();
+    set_view(camera_projection * camera_view, glm::vec4(0.0f), camera->position, camera::near_plane, camera::far_plane);
+
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
+    {
+        liminal::gl_state::viewport(0, 0, render_width, render_height);
+        liminal::gl_state::disable(GL_DEPTH_TEST);
+        liminal::gl_state::enable(GL_BLEND);
+        liminal::gl_state::blend_func(GL_ONE, GL_ONE);
+
+        ssr_program->bind();
+        {
+            bind_geometry_textures();
+            liminal::gl_state::active_texture(GL_TEXTURE4);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, ssr_hi_z_texture_id);
+            liminal::gl_state::active_texture(GL_TEXTURE6);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, skybox ? skybox->prefilter_cubemap_id : 0);
+            liminal::gl_state::active_texture(GL_TEXTURE8);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, brdf_texture_id);
+
+            liminal::gl_state::bind_vertex_array(screen_vao_id);
+            glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
+            liminal::gl_state::bind_vertex_array(0);
+
+            unbind_geometry_textures();
+            liminal::gl_state::active_texture(GL_TEXTURE4);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE5);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE6);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE8);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
         }
+        ssr_program->unbind();
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        liminal::gl_state::disable(GL_BLEND);
+        liminal::gl_state::blend_func(GL_ONE, GL_ZERO);
+        liminal::gl_state::enable(GL_DEPTH_TEST);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void liminal::renderer::render_waters(unsigned int current_time)
 {
+    glm::mat4 camera_projection = camera->calc_projection((float)render_width / (float)render_height);
+    glm::mat4 camera_view = camera->calc_view();
+    liminal::frustum frustum(camera_projection * camera_view);
+
+    // waters off screen cost nothing, not even a reflection
+    std::vector<liminal::water *> visible_waters;
     for (auto &water : waters)
     {
-        // reflection
-        glm::vec4 reflection_clipping_plane = {0.0f, 1.0f, 0.0f, -water->position.y};
-        if (camera->position.y < water->position.y) // flip reflection clipping plane if under the water
+        liminal::aabb water_aabb = liminal::aabb(glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 1.0f)).transform(water->calc_model());
+        if (frustum.intersects(water_aabb))
+        {
+            visible_waters.push_back(water);
+        }
+    }
+
+    // queries of waters that aren't drawn this frame would be stale by the time they are again
+    for (auto it = water_query_ids.begin(); it != water_query_ids.end();)
+    {
+        if (std::find(visible_waters.begin(), visible_waters.end(), it->first) == visible_waters.end())
+        {
+            glDeleteQueries(1, &it->second);
+            it = water_query_ids.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    if (visible_waters.size() == 0)
+    {
+        return;
+    }
+
+    // refraction is what the camera pass drew behind the water, copied before the reflections overwrite the gbuffer
+    glCopyImageSubData(
+        hdr_texture_ids[0], GL_TEXTURE_2D, 0, 0, 0, 0,
+        water_refraction_color_texture_id, GL_TEXTURE_2D, 0, 0, 0, 0,
+        render_width, render_height, 1);
+    glCopyImageSubData(
+        geometry_depth_texture_id, GL_TEXTURE_2D, 0, 0, 0, 0,
+        water_refraction_depth_texture_id, GL_TEXTURE_2D, 0, 0, 0, 0,
+        render_width, render_height, 1);
+
+    // waters at the same height mirror the scene the same way, so they share a reflection
+    std::sort(
+        visible_waters.begin(),
+        visible_waters.end(),
+        [](const liminal::water *a, const liminal::water *b) { return a->position.y < b->position.y; });
+
+    for (std::size_t first = 0; first < visible_waters.size();)
+    {
+        float water_height = visible_waters[first]->position.y;
+        std::size_t last = first + 1;
+        while (last < visible_waters.size() && visible_waters[last]->position.y == water_height)
+        {
+            last++;
+        }
+
+        // skip the reflection when every water of the plane was hidden last frame, only results that are ready are used so this never waits
+        // the waters are still drawn and queried, so they get their reflection back a frame after coming into view
+        // with screen space reflections the water shader traces its own, and there is nothing to draw for it
+        bool occluded = !screen_space_reflections;
+        for (std::size_t i = first; i < last && occluded; i++)
         {
-            reflection_clipping_plane *= -1;
+            auto it = water_query_ids.find(visible_waters[i]);
+            GLuint available = GL_FALSE;
+            if (it != water_query_ids.end())
+            {
+                glGetQueryObjectuiv(it->second, GL_QUERY_RESULT_AVAILABLE, &available);
+            }
+            if (!available)
+            {
+                occluded = false;
+                break;
+            }
+
+            GLuint any_samples_passed;
+            glGetQueryObjectuiv(it->second, GL_QUERY_RESULT, &any_samples_passed);
+            occluded = !any_samples_passed;
         }
-        float previous_camera_y = camera->position.y;
-        float previous_camera_pitch = camera->pitch;
-        float previous_camera_roll = camera->roll;
-        camera->position.y -= 2 * (camera->position.y - water->position.y);
-        camera->pitch = -camera->pitch;
-        camera->roll = -camera->roll;
-        render_objects(water_reflection_fbo_id, reflection_width, reflection_height, reflection_clipping_plane);
-        camera->position.y = previous_camera_y;
-        camera->pitch = previous_camera_pitch;
-        camera->roll = previous_camera_roll;
 
-        // refraction
-        glm::vec4 refraction_clipping_plane = {0.0f, -1.0f, 0.0f, water->position.y};
-        if (camera->position.y < water->position.y) // flip refraction clipping plane if under the water
+        if (!screen_space_reflections && !occluded)
         {
-            refraction_clipping_plane *= -1;
+            glm::vec4 reflection_clipping_plane = {0.0f, 1.0f, 0.0f, -water_height};
+            if (camera->position.y < water_height) // flip reflection clipping plane if under the water
+            {
+                reflection_clipping_plane *= -1;
+            }
+            float previous_camera_y = camera->position.y;
+            float previous_camera_pitch = camera->pitch;
+            float previous_camera_roll = camera->roll;
+            camera->position.y -= 2 * (camera->position.y - water_height);
+            camera->pitch = -camera->pitch;
+            camera->roll = -camera->roll;
+            render_objects("water reflection", water_reflection_fbo_id, reflection_width, reflection_height, false, reflection_clipping_plane, water_reflection_shadows);
+            camera->position.y = previous_camera_y;
+            camera->pitch = previous_camera_pitch;
+            camera->roll = previous_camera_roll;
         }
-        render_objects(water_refraction_fbo_id, refraction_width, refraction_height, refraction_clipping_plane);
 
         // draw water meshes
-        glBindFramebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
+        set_view(camera_projection * camera_view, glm::vec4(0.0f), camera->position, camera::near_plane, camera::far_plane);
+
+        for (std::size_t i = first; i < last; i++)
         {
-            glViewport(0, 0, render_width, render_height);
-            glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            liminal::water *water = visible_waters[i];
 
-            water_program->bind();
+            GLuint &query_id = water_query_ids[water];
+            if (query_id == 0)
             {
-                glm::mat4 camera_projection = camera->calc_projection((float)render_width / (float)render_height);
-                glm::mat4 camera_view = camera->calc_view();
-
-                glm::mat4 water_model = water->calc_model();
-
-                water_program->set_mat4("mvp", camera_projection * camera_view * water_model);
-                water_program->set_mat4("model", water_model);
-                water_program->set_float("tiling", water->size / 10);
-                water_program->set_float("camera.near_plane", camera::near_plane);
-                water_program->set_float("camera.far_plane", camera::far_plane);
-                water_program->set_vec3("camera.position", camera->position);
-                if (directional_lights.size() > 0)
+                glGenQueries(1, &query_id);
+            }
+
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, query_id);
+            liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
+            {
+                liminal::gl_state::viewport(0, 0, render_width, render_height);
+                liminal::gl_state::polygon_mode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+                liminal::gl_state::enable(GL_BLEND);
+                liminal::gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+                water_program->bind();
                 {
-                    // TODO: specular reflections for all lights
-                    water_program->set_vec3("light.direction", directional_lights[0]->direction);
-                    water_program->set_vec3("light.color", directional_lights[0]->color);
+                    glm::mat4 water_model = water->calc_model();
+
+                    water_program->set_mat4("model", water_model);
+                    water_program->set_float("tiling", water->size / 10);
+                    water_program->set_unsigned_int("current_time", current_time);
+                    water_program->set_int("screen_space_reflections", screen_space_reflections);
+
+                    liminal::gl_state::active_texture(GL_TEXTURE0);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, water_reflection_color_texture_id);
+                    liminal::gl_state::active_texture(GL_TEXTURE1);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, water_refraction_color_texture_id);
+                    liminal::gl_state::active_texture(GL_TEXTURE2);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, water_refraction_depth_texture_id);
+                    liminal::gl_state::active_texture(GL_TEXTURE3);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, water_dudv_texture ? water_dudv_texture->texture_id : 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE4);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, water_normal_texture ? water_normal_texture->texture_id : 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE5);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, ssr_hi_z_texture_id);
+                    liminal::gl_state::active_texture(GL_TEXTURE6);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, skybox ? skybox->environment_cubemap_id : 0);
+
+                    liminal::gl_state::bind_vertex_array(water_vao_id);
+                    glDrawArrays(GL_TRIANGLES, 0, water_vertices_size);
+                    liminal::gl_state::bind_vertex_array(0);
+
+                    liminal::gl_state::active_texture(GL_TEXTURE0);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE1);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE2);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE3);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE4);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE5);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+                    liminal::gl_state::active_texture(GL_TEXTURE6);
+                    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
                 }
-                water_program->set_unsigned_int("current_time", current_time);
-
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, water_reflection_color_texture_id);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, water_refraction_color_texture_id);
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, water_refraction_depth_texture_id);
-                glActiveTexture(GL_TEXTURE3);
-                glBindTexture(GL_TEXTURE_2D, water_dudv_texture ? water_dudv_texture->texture_id : 0);
-                glActiveTexture(GL_TEXTURE4);
-                glBindTexture(GL_TEXTURE_2D, water_normal_texture ? water_normal_texture->texture_id : 0);
-
-                glBindVertexArray(water_vao_id);
-                glDrawArrays(GL_TRIANGLES, 0, water_vertices_size);
-                glBindVertexArray(0);
-
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                glActiveTexture(GL_TEXTURE3);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                glActiveTexture(GL_TEXTURE4);
-                glBindTexture(GL_TEXTURE_2D, 0);
-            }
-            water_program->unbind();
+                water_program->unbind();
 
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glDisable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ZERO);
+                liminal::gl_state::polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+                liminal::gl_state::disable(GL_BLEND);
+                liminal::gl_state::blend_func(GL_ONE, GL_ZERO);
+            }
+            liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        first = last;
     }
 }
 
 void liminal::renderer::render_sprites()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, hdr_fbo_id);
     {
-        glViewport(0, 0, display_width, display_height);
+        liminal::gl_state::viewport(0, 0, display_width, display_height);
 
         sprite_program->bind();
         {
@@ -1739,91 +3430,146 @@ void liminal::renderer::render_sprites()
                 sprite_program->set_mat4("mvp", projection * sprite_model);
                 sprite_program->set_vec3("sprite.color", sprite->color);
 
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, sprite->texture->texture_id);
+                liminal::gl_state::active_texture(GL_TEXTURE0);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, sprite->texture->texture_id);
 
-                glBindVertexArray(sprite_vao_id);
+                liminal::gl_state::bind_vertex_array(sprite_vao_id);
                 glDrawArrays(GL_TRIANGLES, 0, sprite_vertices_size);
-                glBindVertexArray(0);
+                liminal::gl_state::bind_vertex_array(0);
 
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, 0);
+                liminal::gl_state::active_texture(GL_TEXTURE0);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
             }
         }
         sprite_program->unbind();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void liminal::renderer::render_screen()
+liminal::program *liminal::renderer::get_screen_program(unsigned int effects)
 {
-    // apply gaussian blur to brightness map
-    bool horizontal = true;
+    auto it = screen_programs.find(effects);
+    if (it != screen_programs.end())
     {
-        glViewport(0, 0, display_width / 8, display_height / 8);
+        return it->second;
+    }
+
+    // compiled the first time a combination is used, and kept
+    std::vector<std::string> defines;
+    for (unsigned int i = 0; i < num_screen_effects; i++)
+    {
+        if (effects & (1 << i))
+        {
+            defines.push_back(screen_effect_defines[i]);
+        }
+    }
+    liminal::program *program = new liminal::program(
+        "assets/shaders/screen.vs",
+        "assets/shaders/screen.fs",
+        defines);
+    set_screen_samplers(program);
+    screen_programs[effects] = program;
+    return program;
+}
 
-        gaussian_program->bind();
+void liminal::renderer::render_screen()
+{
+    // bloom the brightness map down the mip chain and back up
+    // every level adds a wider blur, so the top ends up with all of them at the cost of a few small passes
+    if (bloom)
+    {
+        profiler.begin("bloom");
+        liminal::gl_state::active_texture(GL_TEXTURE0);
+        bloom_downsample_program->bind();
         {
-            bool first_iteration = true;
-            for (unsigned int i = 0; i < 10; i++)
+            for (GLint level = 0; level < bloom_levels; level++)
             {
-                glBindFramebuffer(GL_FRAMEBUFFER, bloom_fbo_ids[horizontal]);
-                {
-                    gaussian_program->set_int("horizontal", horizontal);
+                GLsizei level_width = std::max((render_width / 2) >> level, 1);
+                GLsizei level_height = std::max((render_height / 2) >> level, 1);
+                liminal::gl_state::bind_texture(GL_TEXTURE_2D, level == 0 ? hdr_texture_ids[1] : bloom_texture_id);
+                glBindImageTexture(0, bloom_texture_id, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
 
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, first_iteration ? hdr_texture_ids[1] : bloom_texture_ids[!horizontal]);
+                bloom_downsample_program->set_int("input_level", std::max(level - 1, 0));
+                bloom_downsample_program->set_int("first_level", level == 0);
 
-                    glBindVertexArray(screen_vao_id);
-                    glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-                    glBindVertexArray(0);
+                glDispatchCompute((level_width + 7) / 8, (level_height + 7) / 8, 1);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            }
+        }
+        bloom_downsample_program->unbind();
 
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                }
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        bloom_upsample_program->bind();
+        {
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, bloom_texture_id);
+
+            for (GLint level = bloom_levels - 2; level >= 0; level--)
+            {
+                GLsizei level_width = std::max((render_width / 2) >> level, 1);
+                GLsizei level_height = std::max((render_height / 2) >> level, 1);
+                glBindImageTexture(0, bloom_texture_id, level, GL_FALSE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
 
-                horizontal = !horizontal;
+                bloom_upsample_program->set_int("input_level", level + 1);
 
-                first_iteration = false;
+                glDispatchCompute((level_width + 7) / 8, (level_height + 7) / 8, 1);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
             }
+
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
         }
-        gaussian_program->unbind();
+        bloom_upsample_program->unbind();
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+        profiler.end();
     }
 
     // final pass
+    profiler.begin("screen");
     {
-        glViewport(0, 0, display_width, display_height);
-        glDisable(GL_DEPTH_TEST);
+        liminal::gl_state::viewport(0, 0, display_width, display_height);
+        liminal::gl_state::disable(GL_DEPTH_TEST);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // every enabled effect is applied in this one pass
+        unsigned int effects = 0;
+        effects |= bloom ? SCREEN_EFFECT_BLOOM : 0;
+        effects |= vignette > 0.0f ? SCREEN_EFFECT_VIGNETTE : 0;
+        effects |= color_grading_enabled ? SCREEN_EFFECT_COLOR_GRADING : 0;
+        effects |= greyscale ? SCREEN_EFFECT_GREYSCALE : 0;
+        liminal::program *screen_program = get_screen_program(effects);
+
         screen_program->bind();
         {
-            screen_program->set_unsigned_int("greyscale", greyscale);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, hdr_texture_ids[0]);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, bloom_texture_ids[!horizontal]);
-
-            glBindVertexArray(screen_vao_id);
+            screen_program->set_float("exposure", exposure);
+            screen_program->set_float("bloom_strength", 1.0f / (float)bloom_levels);
+            screen_program->set_float("vignette", vignette);
+
+            liminal::gl_state::active_texture(GL_TEXTURE0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, hdr_texture_ids[0]);
+            liminal::gl_state::active_texture(GL_TEXTURE1);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, bloom_texture_id);
+            liminal::gl_state::active_texture(GL_TEXTURE2);
+            liminal::gl_state::bind_texture(GL_TEXTURE_3D, color_lut_texture_id);
+
+            liminal::gl_state::bind_vertex_array(screen_vao_id);
             glDrawArrays(GL_TRIANGLES, 0, screen_vertices_size);
-            glBindVertexArray(0);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::bind_vertex_array(0);
+
+            liminal::gl_state::active_texture(GL_TEXTURE0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE1);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
+            liminal::gl_state::active_texture(GL_TEXTURE2);
+            liminal::gl_state::bind_texture(GL_TEXTURE_3D, 0);
         }
         screen_program->unbind();
 
-        glEnable(GL_DEPTH_TEST);
+        liminal::gl_state::enable(GL_DEPTH_TEST);
     }
+    profiler.end();
 
     // DEBUG: draw fbos
     // {
-    //     glViewport(0, 0, display_width, display_height);
+    //     liminal::gl_state::viewport(0, 0, display_width, display_height);
 
     //     glm::mat4 projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, 0.0f, 100.0f);
 
@@ -1840,16 +3586,16 @@ void liminal::renderer::render_screen()
 
     //             sprite_program->set_mat4("mvp", projection * model);
 
-    //             glActiveTexture(GL_TEXTURE0);
-    //             glBindTexture(GL_TEXTURE_2D, directional_lights[0]->depth_map_texture_id);
+    //             liminal::gl_state::active_texture(GL_TEXTURE0);
+    //             liminal::gl_state::bind_texture(GL_TEXTURE_2D, directional_lights[0]->depth_map_texture_id);
 
-    //             glBindVertexArray(sprite_vao_id);
+    //             liminal::gl_state::bind_vertex_array(sprite_vao_id);
     //             glDrawArrays(GL_TRIANGLES, 0, sprite_vertices_size);
-    //             glBindVertexArray(0);
+    //             liminal::gl_state::bind_vertex_array(0);
     //         }
 
-    //         glActiveTexture(GL_TEXTURE0);
-    //         glBindTexture(GL_TEXTURE_2D, 0);
+    //         liminal::gl_state::active_texture(GL_TEXTURE0);
+    //         liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
     //     }
     //     sprite_program->unbind();
     // }
@@ -2,71 +2,206 @@
 #define RENDERER_HPP
 
 #include <GL/glew.h>
+#include <unordered_map>
 
+#include "aabb_tree.hpp"
+#include "bounds.hpp"
 #include "camera.hpp"
 #include "cubemap.hpp"
 #include "directional_light.hpp"
+#include "gpu_profiler.hpp"
 #include "mesh.hpp"
 #include "model.hpp"
 #include "object.hpp"
 #include "point_light.hpp"
 #include "program.hpp"
+#include "render_queue.hpp"
 #include "skybox.hpp"
+#include "slot_map.hpp"
 #include "sound.hpp"
 #include "source.hpp"
 #include "spot_light.hpp"
 #include "sprite.hpp"
 #include "terrain.hpp"
 #include "texture.hpp"
+#include "uniforms.hpp"
 #include "water.hpp"
 
+// froxel grid the clustered lights are assigned to, must match assets/shaders/glsl/clusters.glsl
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+#define NUM_CLUSTERS (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+
+// point and spot light shadows share one depth texture, handed out again every frame as square power of two tiles
+// a light's tiles are about as big as the light is on screen, lights smaller than the threshold (in pixels) get none
+#define SHADOW_ATLAS_SIZE 4096
+#define MIN_SHADOW_TILE_SIZE 64
+#define MAX_SHADOW_TILE_SIZE 1024
+#define MIN_SHADOW_SCREEN_SIZE 32.0f
+
+// objects that haven't moved for this many flushes, and aren't animated, are static shadow casters
+// a light's static casters are kept in a second atlas, and only drawn again when something they depend on changes
+// lights with tiles this small are far away, and only get their shadows redrawn every few frames
+#define STATIC_SHADOW_FRAMES 60
+#define MAX_SLICED_SHADOW_TILE_SIZE 256
+#define SHADOW_UPDATE_INTERVAL 4
+
+// depth bounds reductions that can be in flight, the newest finished one is read without waiting on the rest
+#define NUM_DEPTH_BOUNDS_BUFFERS 4
+
+// passes that draw to several views at once (cube faces, cascades) draw an instance once for each view it touches
+// with the view in the top bits of its index, must match assets/shaders/glsl/instance_models.glsl
+#define INSTANCE_VIEW_SHIFT 29
+
+// levels of the bloom mip chain, the last one is 1/64 of the render size
+#define MAX_BLOOM_LEVELS 6
+
+// size of each side of the color grading lookup
+#define COLOR_LUT_SIZE 32
+
 namespace liminal
 {
     class renderer
     {
     public:
+        struct pass_stats
+        {
+            const char *name;
+            int index; // the light's slot for shadow passes, -1 for the rest
+            unsigned int tested;
+            unsigned int visible; // instances drawn at least once
+            unsigned int draws; // instances drawn, once for every mesh and view they're in
+            bool gpu_culled; // visible and draws are what was sent to the gpu to be culled, not what survived
+        };
+
+        struct object_proxy
+        {
+            liminal::model *model;
+            glm::mat4 transform;
+            int tree_proxy_id;
+            bool dirty; // the transform hasn't been uploaded yet
+            unsigned int still_frames; // flushes since the transform or model changed
+        };
+
+        template <typename T>
+        struct light_proxy
+        {
+            T *light;
+            bool dirty; // changed since the last flush
+            glm::vec4 shadow_tile; // where the light's shadow was last drawn, only still there while its tile stays the same
+        };
+
+        // applied to the tonemapped image through a baked lookup, so it costs the same however much is graded
+        struct color_grading
+        {
+            float contrast;
+            float saturation;
+            glm::vec3 color_filter;
+
+            color_grading();
+
+            bool is_identity() const;
+        };
+
+        typedef liminal::handle<liminal::renderer::object_proxy> object_handle;
+        typedef liminal::handle<liminal::renderer::light_proxy<liminal::directional_light>> directional_light_handle;
+        typedef liminal::handle<liminal::renderer::light_proxy<liminal::point_light>> point_light_handle;
+        typedef liminal::handle<liminal::renderer::light_proxy<liminal::spot_light>> spot_light_handle;
+
         bool wireframe;
         bool greyscale;
+        bool gpu_culling;
+        bool occlusion_culling; // only with gpu_culling, tests the camera pass against a hi-z pyramid
+        bool sdsm; // fits the shadow cascades to the depth range on screen a few frames ago, instead of the whole shadow distance
+        bool screen_space_reflections; // traces glossy reflections against the lit image, waters use it in place of drawing the scene mirrored
+        bool water_reflection_shadows; // reflections are lit without shadows when off
+        bool bloom;
+        float exposure;
+        float vignette; // strength of the darkening towards the corners, off at 0
         liminal::camera *camera;
         liminal::skybox *skybox;
-        std::vector<liminal::object *> objects;
-        std::vector<liminal::directional_light *> directional_lights;
-        std::vector<liminal::point_light *> point_lights;
-        std::vector<liminal::spot_light *> spot_lights;
         std::vector<liminal::water *> waters;
         std::vector<liminal::terrain *> terrains;
         std::vector<liminal::sprite *> sprites;
 
+        // culling results of every pass of the last flush
+        std::vector<liminal::renderer::pass_stats> stats;
+
+        // gpu time of every pass, and of each light's shadows
+        liminal::gpu_profiler profiler;
+
         renderer(
             GLsizei display_width, GLsizei display_height, float render_scale,
-            GLsizei reflection_width, GLsizei reflection_height,
-            GLsizei refraction_width, GLsizei refraction_height);
+            float reflection_scale);
         ~renderer();
 
         void set_screen_size(GLsizei display_width, GLsizei display_height, float render_scale);
-        void set_reflection_size(GLsizei reflection_width, GLsizei reflection_height);
-        void set_refraction_size(GLsizei refraction_width, GLsizei refraction_height);
+        // the compact gbuffer reconstructs position from depth and packs the rest into 8 and 16 bit targets
+        // the full one is kept around to compare against, switching reallocates the gbuffer
+        void set_compact_gbuffer(bool compact_gbuffer);
+        // water reflections are drawn at a fraction of the render size, at most all of it
+        void set_reflection_scale(float reflection_scale);
+        // shadow tiles are sized for this fraction of the light's size on screen, lights keep their shadows at any scale
+        void set_shadow_scale(float shadow_scale);
+        // bakes the grading into the lookup, the screen pass skips it while it's the identity
+        void set_color_grading(const liminal::renderer::color_grading &color_grading);
 
         void reload_programs();
 
+        // objects and lights stay in the scene until removed, only what changed is uploaded again
+        // lights are owned by the caller, who has to call update_light after changing one
+        liminal::renderer::object_handle add_object(liminal::model *model, const glm::mat4 &transform);
+        void remove_object(liminal::renderer::object_handle handle);
+        void set_object_transform(liminal::renderer::object_handle handle, const glm::mat4 &transform);
+        void set_object_model(liminal::renderer::object_handle handle, liminal::model *model);
+
+        liminal::renderer::directional_light_handle add_light(liminal::directional_light *directional_light);
+        liminal::renderer::point_light_handle add_light(liminal::point_light *point_light);
+        liminal::renderer::spot_light_handle add_light(liminal::spot_light *spot_light);
+        void remove_light(liminal::renderer::directional_light_handle handle);
+        void remove_light(liminal::renderer::point_light_handle handle);
+        void remove_light(liminal::renderer::spot_light_handle handle);
+        void update_light(liminal::renderer::directional_light_handle handle);
+        void update_light(liminal::renderer::point_light_handle handle);
+        void update_light(liminal::renderer::spot_light_handle handle);
+
+        // scene queries against the objects of the last flush, conservative since the tree stores fattened boxes
+        void query_objects(const liminal::bounding_sphere &sphere, const std::function<void(liminal::renderer::object_handle)> &callback) const;
+        void query_objects(const liminal::ray &ray, const std::function<void(liminal::renderer::object_handle, float)> &callback) const;
+
         void flush(unsigned int current_time, float delta_time);
 
     private:
         GLsizei display_width;
         GLsizei display_height;
+        float render_scale;
         GLsizei render_width;
         GLsizei render_height;
+        float reflection_scale;
+        float shadow_scale;
         GLsizei reflection_width;
         GLsizei reflection_height;
-        GLsizei refraction_width;
-        GLsizei refraction_height;
 
         GLuint geometry_fbo_id;
         GLuint geometry_position_texture_id;
         GLuint geometry_normal_texture_id;
         GLuint geometry_albedo_texture_id;
         GLuint geometry_material_texture_id;
-        GLuint geometry_rbo_id;
+        GLuint geometry_depth_texture_id;
+        bool compact_gbuffer;
+
+        // farthest depth of the camera pass per mip, with the camera it was drawn from
+        GLuint hi_z_texture_id;
+        GLint hi_z_levels;
+        glm::mat4 hi_z_view_projection;
+        bool hi_z_valid;
+
+        // nearest depth per mip to trace reflections against, and the lit image they are read from
+        GLuint ssr_hi_z_texture_id;
+        GLuint ssr_color_texture_id;
 
         GLuint hdr_fbo_id;
         GLuint hdr_texture_ids[2];
@@ -76,12 +211,18 @@ namespace liminal
         GLuint water_reflection_color_texture_id;
         GLuint water_reflection_rbo_id;
 
-        GLuint water_refraction_fbo_id;
+        // copied from the camera pass instead of drawing the scene again
         GLuint water_refraction_color_texture_id;
         GLuint water_refraction_depth_texture_id;
 
-        GLuint bloom_fbo_ids[2];
-        GLuint bloom_texture_ids[2];
+        // whether each water was visible when last drawn, reflections of waters that weren't are skipped
+        std::unordered_map<const liminal::water *, GLuint> water_query_ids;
+
+        GLuint bloom_texture_id;
+        GLint bloom_levels;
+
+        GLuint color_lut_texture_id;
+        bool color_grading_enabled;
 
         GLsizei water_vertices_size;
         GLuint water_vao_id;
@@ -101,10 +242,31 @@ namespace liminal
 
         GLuint brdf_texture_id;
 
+        GLuint shadow_atlas_fbo_id;
+        GLuint shadow_atlas_texture_id;
+        unsigned int num_shadow_tiles; // handed out this frame
+
+        // same layout as the shadow atlas, holding only static casters, copied under the dynamic ones every frame
+        GLuint static_shadow_atlas_fbo_id;
+        GLuint static_shadow_atlas_texture_id;
+
+        // bounds of static casters that appeared, moved or went away this frame
+        std::vector<liminal::aabb> static_caster_changes;
+        unsigned int frame_index;
+
+        // nearest and farthest depth of the camera pass, each buffer fenced so it's only read once the gpu is done with it
+        GLuint depth_bounds_ssbo_ids[NUM_DEPTH_BOUNDS_BUFFERS];
+        GLsync depth_bounds_fences[NUM_DEPTH_BOUNDS_BUFFERS]; // null when there's nothing to read
+        unsigned int depth_bounds_index; // the next buffer written
+        GLuint depth_bounds[2]; // the newest bounds read back, kept until a newer reduction finishes
+        bool depth_bounds_valid; // bounds were read back since sdsm was last turned on
+
         liminal::program *depth_mesh_program;
         liminal::program *depth_skinned_mesh_program;
         liminal::program *depth_cube_mesh_program;
         liminal::program *depth_cube_skinned_mesh_program;
+        liminal::program *depth_cascade_mesh_program;
+        liminal::program *depth_cascade_skinned_mesh_program;
         liminal::program *color_program;
         liminal::program *geometry_mesh_program;
         liminal::program *geometry_skinned_mesh_program;
@@ -113,23 +275,148 @@ namespace liminal
         liminal::program *deferred_directional_program;
         liminal::program *deferred_point_program;
         liminal::program *deferred_spot_program;
+        liminal::program *deferred_clustered_program;
+        liminal::program *ssr_program;
         liminal::program *skybox_program;
         liminal::program *water_program;
         liminal::program *sprite_program;
-        liminal::program *gaussian_program;
-        liminal::program *screen_program;
+        // one for each combination of screen effects used so far, keyed by the effect bits
+        std::unordered_map<unsigned int, liminal::program *> screen_programs;
+        liminal::program *cull_instances_program;
+        liminal::program *compact_draws_program;
+        liminal::program *hi_z_program;
+        liminal::program *depth_bounds_program;
+        liminal::program *bloom_downsample_program;
+        liminal::program *bloom_upsample_program;
+        liminal::program *color_lut_program;
+        liminal::program *cluster_lights_program;
 
         liminal::texture *water_dudv_texture;
         liminal::texture *water_normal_texture;
 
         liminal::mesh *DEBUG_sphere_mesh;
 
+        struct instance_batch
+        {
+            liminal::model *model;
+            std::vector<GLuint> instances;
+        };
+
+        // an object's instance is its slot, so it keeps the same place in the instance buffer while it exists
+        // terrains are pushed every frame and go after every object slot
+        liminal::slot_map<liminal::renderer::object_proxy> objects;
+        liminal::slot_map<liminal::renderer::light_proxy<liminal::directional_light>> directional_lights;
+        liminal::slot_map<liminal::renderer::light_proxy<liminal::point_light>> point_lights;
+        liminal::slot_map<liminal::renderer::light_proxy<liminal::spot_light>> spot_lights;
+
+        GLuint instance_ssbo_id;
+        GLsizeiptr instance_ssbo_size;
+        std::vector<glm::mat4> instance_models;
+        GLuint terrain_base_instance;
+
+        // objects grouped by model, only rebuilt when objects are added, removed or change model
+        std::vector<instance_batch> instance_batches;
+        bool instance_batches_dirty;
+
+        // every object is a leaf of the tree, refit incrementally as objects move
+        // the leaves' user data is the object's slot
+        liminal::aabb_tree object_tree;
+        std::vector<liminal::aabb> terrain_aabbs;
+
+        // visibility of every instance in the current pass, objects first and then terrains
+        std::vector<std::uint8_t> instance_visibility;
+
+        // meshes of the visible instances of models with more than one mesh, culled on their own
+        liminal::aabb_list mesh_aabbs;
+        std::vector<std::uint8_t> mesh_visibility;
+
+        // instances queued at least once in the current pass, for its stats
+        std::vector<std::uint8_t> instance_queued;
+
+        // instances that survived culling in the current pass, draws index this list instead of the instance buffer
+        GLuint visible_instance_ssbo_id;
+        GLsizeiptr visible_instance_ssbo_size;
+        std::vector<GLuint> visible_instances;
+
+        liminal::render_queue object_queue;
+        liminal::gpu_cull object_gpu_cull;
+
+        // uniform blocks shared by every program, see assets/shaders/glsl/view.glsl and lights.glsl
+        // lights are laid out in the order their slot maps iterate, past the maximum directional lights aren't drawn
+        // point and spot lights are unbounded, so they live in storage buffers instead
+        GLuint view_ubo_id;
+        GLuint lights_ubo_id;
+        liminal::lights_uniforms light_uniforms;
+        GLuint point_light_ssbo_id;
+        GLuint spot_light_ssbo_id;
+        std::vector<liminal::point_light_uniforms> point_light_data;
+        std::vector<liminal::spot_light_uniforms> spot_light_data;
+
+        // lights without shadows are assigned to a froxel grid every pass, and drawn together in one pass
+        GLuint cluster_ssbo_id;
+        GLuint cluster_light_index_ssbo_id;
+        unsigned int num_clustered_lights;
+
         void setup_samplers();
 
+        // the gbuffer targets go to units 0 to 3 and depth to 7, every deferred program expects them there
+        void bind_geometry_textures() const;
+        void unbind_geometry_textures() const;
+
+        void update_instance_batches();
+        void update_static_objects();
+        void update_instances();
+        bool is_static(const liminal::renderer::object_proxy &proxy) const;
+        bool static_casters_changed(const liminal::bounding_sphere &sphere) const;
+
+        void update_lights();
+        void allocate_shadow_tiles();
+        void set_view(const glm::mat4 &view_projection, glm::vec4 clipping_plane, glm::vec3 position, float near_plane, float far_plane, glm::vec2 gbuffer_scale = glm::vec2(1.0f));
+
+        void cull_instances(const liminal::frustum &frustum);
+        void cull_instances(const liminal::bounding_sphere &sphere);
+        void cull_instances(const liminal::cone &cone);
+        void cull_instances(const liminal::frustum *frustums, unsigned int num_frustums);
+        void mark_visible(int proxy_id);
+
+        // keeps only the static or only the dynamic instances left visible by the last cull_instances
+        void filter_instances(bool static_casters);
+
+        // queues the instance for each view whose frustum the box touches, returns whether there were any
+        bool push_views(GLuint instance, const liminal::aabb &aabb, const liminal::frustum *view_frustums, unsigned int num_view_frustums);
+
+        // queues the instances left visible by the last cull_instances
+        // meshes of models with several meshes are also culled against the frustum, if there is one
+        // when culling on the gpu, returns what the queue has to be submitted with
+        // given the frustums of several views (a point light's faces, a directional light's cascades), each mesh is queued once for every view it touches
+        const liminal::gpu_cull *queue_objects(
+            const char *pass_name,
+            int pass_index,
+            liminal::program *mesh_program,
+            liminal::program *skinned_mesh_program,
+            liminal::program *terrain_program,
+            glm::vec3 eye,
+            float far_plane,
+            const liminal::frustum *frustum,
+            const liminal::frustum *view_frustums = nullptr,
+            unsigned int num_view_frustums = 0);
+
         void render_shadows();
-        void render_objects(GLuint fbo_id, GLsizei width, GLsizei height, glm::vec4 clipping_plane = glm::vec4(0.0f));
+        // fills the pyramid from the gbuffer depth, each texel holding the farthest or nearest of the ones below
+        void build_hi_z(GLuint texture_id, bool nearest);
+        void reduce_depth_bounds(GLsizei width, GLsizei height);
+        // reads the newest reduction that has finished, if any did since the last call
+        void read_depth_bounds();
+        void clear_depth_bounds();
+        void build_clusters(const glm::mat4 &camera_view, const glm::mat4 &camera_projection);
+        // passes smaller than the render size draw into a corner of the gbuffer
+        void render_objects(const char *pass_name, GLuint fbo_id, GLsizei width, GLsizei height, bool occlusion_cull, glm::vec4 clipping_plane = glm::vec4(0.0f), bool shadows = true);
+        // only after the camera pass, replaces the skybox's reflection where a ray hits something on screen
+        void render_reflections();
         void render_waters(unsigned int current_time);
         void render_sprites();
+        // compiled with only the effects in the bits set, the first time they're used together
+        liminal::program *get_screen_program(unsigned int effects);
         void render_screen();
     };
 } // namespace liminal
@@ -6,6 +6,7 @@
 #include <stb_image.h>
 #include <vector>
 
+#include "gl_state.hpp"
 #include "program.hpp"
 
 constexpr GLsizei environment_size = 4096;
@@ -22,16 +23,16 @@ liminal::skybox::skybox(const std::string &filename)
 
 liminal::skybox::~skybox()
 {
-    glDeleteTextures(1, &environment_cubemap_id);
-    glDeleteTextures(1, &irradiance_cubemap_id);
-    glDeleteTextures(1, &prefilter_cubemap_id);
+    liminal::gl_state::delete_textures(1, &environment_cubemap_id);
+    liminal::gl_state::delete_textures(1, &irradiance_cubemap_id);
+    liminal::gl_state::delete_textures(1, &prefilter_cubemap_id);
 }
 
 void liminal::skybox::set_cubemap(const std::string &filename)
 {
-    glDeleteTextures(1, &environment_cubemap_id);
-    glDeleteTextures(1, &irradiance_cubemap_id);
-    glDeleteTextures(1, &prefilter_cubemap_id);
+    liminal::gl_state::delete_textures(1, &environment_cubemap_id);
+    liminal::gl_state::delete_textures(1, &irradiance_cubemap_id);
+    liminal::gl_state::delete_textures(1, &prefilter_cubemap_id);
 
     // setup capture mesh
     std::vector<float> capture_vertices =
@@ -81,7 +82,7 @@ void liminal::skybox::set_cubemap(const std::string &filename)
     GLuint capture_vbo_id;
 
     glGenVertexArrays(1, &capture_vao_id);
-    glBindVertexArray(capture_vao_id);
+    liminal::gl_state::bind_vertex_array(capture_vao_id);
     {
         glGenBuffers(1, &capture_vbo_id);
         glBindBuffer(GL_ARRAY_BUFFER, capture_vbo_id);
@@ -91,7 +92,7 @@ void liminal::skybox::set_cubemap(const std::string &filename)
 
         glEnableVertexAttribArray(0);
     }
-    glBindVertexArray(0);
+    liminal::gl_state::bind_vertex_array(0);
 
     // setup capture matrices
     glm::mat4 capture_projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
@@ -108,7 +109,7 @@ void liminal::skybox::set_cubemap(const std::string &filename)
     GLuint capture_rbo_id;
 
     glGenFramebuffers(1, &capture_fbo_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
     {
         {
             glGenRenderbuffers(1, &capture_rbo_id);
@@ -135,13 +136,13 @@ void liminal::skybox::set_cubemap(const std::string &filename)
             return;
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     // create environment cubemap from equirectangular texture
     GLuint equirectangular_texture_id;
 
     glGenTextures(1, &equirectangular_texture_id);
-    glBindTexture(GL_TEXTURE_2D, equirectangular_texture_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, equirectangular_texture_id);
     {
         stbi_set_flip_vertically_on_load(true);
         int width, height, num_components;
@@ -169,10 +170,10 @@ void liminal::skybox::set_cubemap(const std::string &filename)
 
         stbi_image_free(image);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
     glGenTextures(1, &environment_cubemap_id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
     {
         for (unsigned int i = 0; i < 6; i++)
         {
@@ -193,22 +194,22 @@ void liminal::skybox::set_cubemap(const std::string &filename)
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
 
     liminal::program *equirectangular_to_cubemap_program = new liminal::program(
         "assets/shaders/cubemap.vs",
         "assets/shaders/equirectangular_to_cubemap.fs");
 
-    glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
     {
-        glViewport(0, 0, environment_size, environment_size);
+        liminal::gl_state::viewport(0, 0, environment_size, environment_size);
 
         equirectangular_to_cubemap_program->bind();
         {
             equirectangular_to_cubemap_program->set_int("equirectangular_map", 0);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, equirectangular_texture_id);
+            liminal::gl_state::active_texture(GL_TEXTURE0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_2D, equirectangular_texture_id);
 
             for (unsigned int i = 0; i < 6; i++)
             {
@@ -223,28 +224,28 @@ void liminal::skybox::set_cubemap(const std::string &filename)
 
                 equirectangular_to_cubemap_program->set_mat4("mvp", capture_mvps[i]);
 
-                glBindVertexArray(capture_vao_id);
+                liminal::gl_state::bind_vertex_array(capture_vao_id);
                 glDrawArrays(GL_TRIANGLES, 0, capture_vertices_size);
-                glBindVertexArray(0);
+                liminal::gl_state::bind_vertex_array(0);
             }
         }
         equirectangular_to_cubemap_program->unbind();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     delete equirectangular_to_cubemap_program;
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
     {
         glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     }
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
 
-    glDeleteTextures(1, &equirectangular_texture_id);
+    liminal::gl_state::delete_textures(1, &equirectangular_texture_id);
 
     // create irradiance cubemap from environment cubemap
     glGenTextures(1, &irradiance_cubemap_id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradiance_cubemap_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, irradiance_cubemap_id);
     {
         for (unsigned int i = 0; i < 6; i++)
         {
@@ -265,9 +266,9 @@ void liminal::skybox::set_cubemap(const std::string &filename)
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
     {
         glBindRenderbuffer(GL_RENDERBUFFER, capture_rbo_id);
         {
@@ -280,22 +281,22 @@ void liminal::skybox::set_cubemap(const std::string &filename)
         }
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     liminal::program *irradiance_convolution_program = new liminal::program(
         "assets/shaders/cubemap.vs",
         "assets/shaders/irradiance_convolution.fs");
 
-    glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
     {
-        glViewport(0, 0, irradiance_size, irradiance_size);
+        liminal::gl_state::viewport(0, 0, irradiance_size, irradiance_size);
 
         irradiance_convolution_program->bind();
         {
             irradiance_convolution_program->set_int("environment_cubemap", 0);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
+            liminal::gl_state::active_texture(GL_TEXTURE0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
 
             for (unsigned int i = 0; i < 6; i++)
             {
@@ -310,20 +311,20 @@ void liminal::skybox::set_cubemap(const std::string &filename)
 
                 irradiance_convolution_program->set_mat4("mvp", capture_mvps[i]);
 
-                glBindVertexArray(capture_vao_id);
+                liminal::gl_state::bind_vertex_array(capture_vao_id);
                 glDrawArrays(GL_TRIANGLES, 0, capture_vertices_size);
-                glBindVertexArray(0);
+                liminal::gl_state::bind_vertex_array(0);
             }
         }
         irradiance_convolution_program->unbind();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     delete irradiance_convolution_program;
 
     // create prefilter cubemap from environment cubemap
     glGenTextures(1, &prefilter_cubemap_id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilter_cubemap_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, prefilter_cubemap_id);
     {
         for (unsigned int i = 0; i < 6; i++)
         {
@@ -346,21 +347,21 @@ void liminal::skybox::set_cubemap(const std::string &filename)
 
         glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     }
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
 
     liminal::program *prefilter_convolution_program = new liminal::program(
         "assets/shaders/cubemap.vs",
         "assets/shaders/prefilter_convolution.fs");
 
-    glBindFramebuffer(GL_FRAMEBUFFER, capture_fbo_id);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, capture_fbo_id);
     {
         prefilter_convolution_program->bind();
         {
             prefilter_convolution_program->set_mat4("capture.projection", capture_projection);
             prefilter_convolution_program->set_int("environment_cubemap", 0);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
+            liminal::gl_state::active_texture(GL_TEXTURE0);
+            liminal::gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, environment_cubemap_id);
 
             const unsigned int max_mip_levels = 5;
             for (unsigned int mip_level = 0; mip_level < max_mip_levels; mip_level++)
@@ -379,7 +380,7 @@ void liminal::skybox::set_cubemap(const std::string &filename)
                 }
                 glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-                glViewport(0, 0, mip_width, mip_height);
+                liminal::gl_state::viewport(0, 0, mip_width, mip_height);
 
                 prefilter_convolution_program->set_float("roughness", (float)mip_level / (float)(max_mip_levels - 1));
 
@@ -396,22 +397,22 @@ void liminal::skybox::set_cubemap(const std::string &filename)
 
                     prefilter_convolution_program->set_mat4("mvp", capture_mvps[i]);
 
-                    glBindVertexArray(capture_vao_id);
+                    liminal::gl_state::bind_vertex_array(capture_vao_id);
                     glDrawArrays(GL_TRIANGLES, 0, capture_vertices_size);
-                    glBindVertexArray(0);
+                    liminal::gl_state::bind_vertex_array(0);
                 }
             }
         }
         prefilter_convolution_program->unbind();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    liminal::gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     delete prefilter_convolution_program;
 
     // cleanup
-    glDeleteFramebuffers(1, &capture_fbo_id);
+    liminal::gl_state::delete_framebuffers(1, &capture_fbo_id);
     glDeleteRenderbuffers(1, &capture_rbo_id);
 
-    glDeleteVertexArrays(1, &capture_vao_id);
+    liminal::gl_state::delete_vertex_arrays(1, &capture_vao_id);
     glDeleteBuffers(1, &capture_vbo_id);
 }
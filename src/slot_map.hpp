@@ -0,0 +1,220 @@
+#ifndef SLOT_MAP_HPP
+#define SLOT_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace liminal
+{
+    // refers to a value in a slot_map until that value is erased
+    // the generation tells a stale handle apart from one to a value that reused the same slot
+    template <typename T>
+    struct handle
+    {
+        std::uint32_t index;
+        std::uint32_t generation;
+
+        handle()
+            : index(0xffffffff),
+              generation(0)
+        {
+        }
+
+        handle(std::uint32_t index, std::uint32_t generation)
+            : index(index),
+              generation(generation)
+        {
+        }
+
+        bool operator==(const liminal::handle<T> &other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+
+        bool operator!=(const liminal::handle<T> &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    // values never move from the slot they were inserted into, so a handle's index can key other per-value arrays
+    // iterating visits only the slots in use, in index order
+    template <typename T>
+    class slot_map
+    {
+    private:
+        struct slot
+        {
+            T value;
+            std::uint32_t generation;
+            bool used;
+
+            slot()
+                : value(),
+                  generation(0),
+                  used(false)
+            {
+            }
+        };
+
+    public:
+        template <typename S, typename V>
+        class basic_iterator
+        {
+        public:
+            basic_iterator(S *slots, std::size_t index, std::size_t capacity)
+                : slots(slots),
+                  index(index),
+                  capacity(capacity)
+            {
+                skip_unused();
+            }
+
+            V &operator*() const
+            {
+                return slots[index].value;
+            }
+
+            V *operator->() const
+            {
+                return &slots[index].value;
+            }
+
+            basic_iterator &operator++()
+            {
+                index++;
+                skip_unused();
+                return *this;
+            }
+
+            bool operator!=(const basic_iterator &other) const
+            {
+                return index != other.index;
+            }
+
+            std::size_t get_index() const
+            {
+                return index;
+            }
+
+        private:
+            S *slots;
+            std::size_t index;
+            std::size_t capacity;
+
+            void skip_unused()
+            {
+                while (index < capacity && !slots[index].used)
+                {
+                    index++;
+                }
+            }
+        };
+
+        typedef basic_iterator<slot, T> iterator;
+        typedef basic_iterator<const slot, const T> const_iterator;
+
+        slot_map()
+            : count(0)
+        {
+        }
+
+        liminal::handle<T> insert(const T &value)
+        {
+            std::uint32_t index;
+            if (free_indices.empty())
+            {
+                index = (std::uint32_t)slots.size();
+                slots.push_back(slot());
+            }
+            else
+            {
+                index = free_indices.back();
+                free_indices.pop_back();
+            }
+
+            slots[index].value = value;
+            slots[index].used = true;
+            count++;
+
+            return liminal::handle<T>(index, slots[index].generation);
+        }
+
+        void erase(liminal::handle<T> handle)
+        {
+            if (!contains(handle))
+            {
+                return;
+            }
+
+            slots[handle.index].value = T();
+            slots[handle.index].used = false;
+            slots[handle.index].generation++;
+            free_indices.push_back(handle.index);
+            count--;
+        }
+
+        bool contains(liminal::handle<T> handle) const
+        {
+            return handle.index < slots.size() &&
+                   slots[handle.index].used &&
+                   slots[handle.index].generation == handle.generation;
+        }
+
+        T &get(liminal::handle<T> handle)
+        {
+            return slots[handle.index].value;
+        }
+
+        const T &get(liminal::handle<T> handle) const
+        {
+            return slots[handle.index].value;
+        }
+
+        // the handle of the value in a slot that is in use
+        liminal::handle<T> get_handle(std::size_t index) const
+        {
+            return liminal::handle<T>((std::uint32_t)index, slots[index].generation);
+        }
+
+        iterator begin()
+        {
+            return iterator(slots.data(), 0, slots.size());
+        }
+
+        iterator end()
+        {
+            return iterator(slots.data(), slots.size(), slots.size());
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(slots.data(), 0, slots.size());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(slots.data(), slots.size(), slots.size());
+        }
+
+        // values in use
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        // slots, including unused ones, every index is below this
+        std::size_t capacity() const
+        {
+            return slots.size();
+        }
+
+    private:
+        std::vector<slot> slots;
+        std::vector<std::uint32_t> free_indices;
+        std::size_t count;
+    };
+} // namespace liminal
+
+#endif
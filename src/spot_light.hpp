@@ -3,35 +3,34 @@
 
 #include <glm/matrix.hpp>
 #include <glm/vec3.hpp>
-#include <GL/glew.h>
 
 namespace liminal
 {
     struct spot_light
     {
         static float near_plane;
-        static float far_plane;
 
         glm::vec3 position;
         glm::vec3 direction;
         glm::vec3 color;
+        float radius; // the light fades out to nothing here, and only casts shadows from objects inside it
         float inner_cutoff;
         float outer_cutoff;
-        GLsizei depth_map_size;
-        GLuint depth_map_fbo_id;
-        GLuint depth_map_texture_id;
+
+        // the renderer gives the light a tile in its shadow atlas every frame it's big enough on screen
+        // the rest of the time, or without this, it's drawn with the clustered lights instead
+        bool casts_shadows;
+
         glm::mat4 transformation_matrix;
 
         spot_light(
             glm::vec3 position,
             glm::vec3 direction,
             glm::vec3 color,
+            float radius,
             float inner_cutoff,
             float outer_cutoff,
-            GLsizei depth_map_size);
-        ~spot_light();
-
-        void set_depth_map_size(GLsizei depth_map_size);
+            bool casts_shadows);
 
         void update_transformation_matrix();
     };
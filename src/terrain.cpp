@@ -1,12 +1,11 @@
 #include "terrain.hpp"
 
-#include <assimp/scene.h>
 #include <bullet/BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <SDL2/SDL_image.h>
 
-#include "texture.hpp"
+#include "material.hpp"
 
 // TODO: read from heightmap image file
 
@@ -70,44 +69,16 @@ liminal::terrain::terrain(const std::string &heightmap_filename, glm::vec3 posit
 
     SDL_FreeSurface(heightmap_surface);
 
-    std::vector<std::vector<liminal::texture *>> textures;
-    for (aiTextureType type = aiTextureType_NONE; type <= AI_TEXTURE_TYPE_MAX; type = (aiTextureType)(type + 1))
-    {
-        std::vector<liminal::texture *> textures_for_type;
-        textures.push_back(textures_for_type);
-    }
-    // TODO: cleanup textures in destructor
-    textures[aiTextureType_DIFFUSE].push_back(new liminal::texture("assets/images/grass1-albedo3.png"));
-    // textures[aiTextureType_DIFFUSE].push_back(new liminal::texture(""));
-    // textures[aiTextureType_DIFFUSE].push_back(new liminal::texture(""));
-    // textures[aiTextureType_DIFFUSE].push_back(new liminal::texture(""));
-
-    textures[aiTextureType_NORMALS].push_back(new liminal::texture("assets/images/grass1-normal1-ogl.png"));
-    // textures[aiTextureType_NORMALS].push_back(new liminal::texture(""));
-    // textures[aiTextureType_NORMALS].push_back(new liminal::texture(""));
-    // textures[aiTextureType_NORMALS].push_back(new liminal::texture(""));
-
-    textures[aiTextureType_SHININESS].push_back(new liminal::texture("assets/images/grass1-metal.png"));
-    // textures[aiTextureType_SHININESS].push_back(new liminal::texture(""));
-    // textures[aiTextureType_SHININESS].push_back(new liminal::texture(""));
-    // textures[aiTextureType_SHININESS].push_back(new liminal::texture(""));
-
-    textures[aiTextureType_OPACITY].push_back(new liminal::texture("assets/images/grass1-rough.png"));
-    // textures[aiTextureType_OPACITY].push_back(new liminal::texture(""));
-    // textures[aiTextureType_OPACITY].push_back(new liminal::texture(""));
-    // textures[aiTextureType_OPACITY].push_back(new liminal::texture(""));
-
-    textures[aiTextureType_AMBIENT].push_back(new liminal::texture("assets/images/grass1-ao.png"));
-    // textures[aiTextureType_AMBIENT].push_back(new liminal::texture(""));
-    // textures[aiTextureType_AMBIENT].push_back(new liminal::texture(""));
-    // textures[aiTextureType_AMBIENT].push_back(new liminal::texture(""));
-
-    textures[aiTextureType_HEIGHT].push_back(new liminal::texture("assets/images/grass1-height.png"));
-    // textures[aiTextureType_HEIGHT].push_back(new liminal::texture(""));
-    // textures[aiTextureType_HEIGHT].push_back(new liminal::texture(""));
-    // textures[aiTextureType_HEIGHT].push_back(new liminal::texture(""));
-
-    mesh = new liminal::mesh(vertices, indices, textures);
+    // the library owns the textures, and shares the material with every terrain that uses the same ones
+    liminal::material material;
+    material.textures[MATERIAL_ALBEDO_MAP] = liminal::mesh::material_library->load_texture("assets/images/grass1-albedo3.png");
+    material.textures[MATERIAL_NORMAL_MAP] = liminal::mesh::material_library->load_texture("assets/images/grass1-normal1-ogl.png");
+    material.textures[MATERIAL_METALLIC_MAP] = liminal::mesh::material_library->load_texture("assets/images/grass1-metal.png");
+    material.textures[MATERIAL_ROUGHNESS_MAP] = liminal::mesh::material_library->load_texture("assets/images/grass1-rough.png");
+    material.textures[MATERIAL_OCCLUSION_MAP] = liminal::mesh::material_library->load_texture("assets/images/grass1-ao.png");
+    material.textures[MATERIAL_HEIGHT_MAP] = liminal::mesh::material_library->load_texture("assets/images/grass1-height.png");
+
+    mesh = new liminal::mesh(vertices, indices, liminal::mesh::material_library->get_material(material));
 
     btTransform transform;
     transform.setIdentity();
@@ -4,6 +4,8 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "gl_state.hpp"
+
 liminal::texture::texture(const std::string &filename, bool srgb)
 {
     SDL_Surface *surface = IMG_Load(filename.c_str());
@@ -31,7 +33,7 @@ liminal::texture::texture(const std::string &filename, bool srgb)
     }
 
     glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, texture_id);
     {
         glTexImage2D(
             GL_TEXTURE_2D,
@@ -50,18 +52,18 @@ liminal::texture::texture(const std::string &filename, bool srgb)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -0.4f);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, 0);
 
     SDL_FreeSurface(surface);
 }
 
 liminal::texture::~texture()
 {
-    glDeleteTextures(1, &texture_id);
+    liminal::gl_state::delete_textures(1, &texture_id);
 }
 
 void liminal::texture::bind(unsigned int index) const
 {
-    glActiveTexture(GL_TEXTURE0 + index);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    liminal::gl_state::active_texture(GL_TEXTURE0 + index);
+    liminal::gl_state::bind_texture(GL_TEXTURE_2D, texture_id);
 }
@@ -0,0 +1,74 @@
+#ifndef UNIFORMS_HPP
+#define UNIFORMS_HPP
+
+#include <glm/matrix.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <GL/glew.h>
+
+#include "directional_light.hpp"
+
+// must match the defines in assets/shaders/glsl/lights.glsl
+#define MAX_DIRECTIONAL_LIGHTS 4
+
+namespace liminal
+{
+    // std140 layouts of the uniform blocks in assets/shaders/glsl/, a vec3 followed by a float shares one vec4
+    // the point and spot lights are std430 storage buffers, which lay these structs out the same way
+
+    struct view_uniforms
+    {
+        glm::mat4 view_projection;
+        glm::mat4 inverse_view_projection;
+        glm::vec4 clipping_plane;
+        glm::vec3 position;
+        float near_plane;
+        float far_plane;
+        GLuint compact_gbuffer;
+        glm::vec2 gbuffer_scale;
+    };
+
+    struct directional_light_uniforms
+    {
+        glm::vec3 direction;
+        float padding0;
+        glm::vec3 color;
+        float padding1;
+        glm::mat4 transformation_matrices[NUM_CASCADES];
+    };
+
+    struct point_light_uniforms
+    {
+        glm::vec3 position;
+        float radius;
+        glm::vec3 color;
+        GLuint casts_shadows; // has tiles in the shadow atlas this frame
+        glm::mat4 transformation_matrices[6];
+        glm::vec4 shadow_tiles[6]; // xy is the corner and z the size, in shadow atlas uv
+    };
+
+    struct spot_light_uniforms
+    {
+        glm::vec3 position;
+        float inner_cutoff;
+        glm::vec3 direction;
+        float outer_cutoff;
+        glm::vec3 color;
+        float radius;
+        glm::mat4 transformation_matrix;
+        glm::vec4 shadow_tile;
+        GLuint casts_shadows;
+        GLuint padding[3];
+    };
+
+    struct lights_uniforms
+    {
+        liminal::directional_light_uniforms directional_lights[MAX_DIRECTIONAL_LIGHTS];
+        GLuint num_directional_lights;
+        GLuint num_point_lights;
+        GLuint num_spot_lights;
+        GLuint padding;
+    };
+} // namespace liminal
+
+#endif